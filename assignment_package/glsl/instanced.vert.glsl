@@ -9,9 +9,15 @@
 
 //uniform int uTime;
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
+// Per frame values shared by every program, std140 to match FrameData in frameuniforms.h
+layout(std140) uniform FrameData {
+    mat4 u_ViewProj;        // The matrix that defines the camera's transformation.
+    mat4 u_InvViewProj;
+    vec4 u_Eye;             // Camera position
+    vec4 u_SunDir;          // Toward the sun, or the moon when w is 1
+    vec4 u_SunColor;
+    int uTime;
+};
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
@@ -15,6 +15,8 @@ uniform vec4 u_Color; // The color with which to render this instance of geometr
 
 uniform sampler2D u_Texture; // The texture to be read from by this shader
 
+uniform vec4 u_Tiles[64]; // atlas rect (x, y, width, height) per block face, for chunk faces
+
 
 // These are the interpolated values out of the rasterizer, so you can't know
 // their specific values without knowing the vertices that contributed to them
@@ -22,19 +24,22 @@ in vec4 fs_Pos;
 in vec4 fs_Nor;
 
 in vec4 fs_UV;
-
-uniform int uTime;
+flat in int fs_Tile;
+
+// Per frame values shared by every program, std140 to match FrameData in frameuniforms.h
+layout(std140) uniform FrameData {
+    mat4 u_ViewProj;        // The matrix that defines the camera's transformation.
+    mat4 u_InvViewProj;
+    vec4 u_Eye;             // Camera position
+    vec4 u_SunDir;          // Toward the sun, or the moon when w is 1
+    vec4 u_SunColor;
+    int uTime;
+};
 
 out vec4 out_Col; // This is the final output color that you will see on your
                   // screen for the pixel that is currently being processed.
 
 
-const vec3 sunColorDawn = vec3(255, 246, 79) / 255.0;
-const vec3 sunColorDusk = vec3(255, 246, 79) / 255.0;
-const vec3 sunColorDay = vec3(255, 249, 196) / 255.0;
-
-const vec3 moonColor = vec3(200.0, 233.0, 248.0) / 255.0;
-
 
 float random1(vec3 p) {
     return fract(sin(dot(p,vec3(127.1, 311.7, 191.999)))
@@ -83,29 +88,12 @@ float random1(vec3 p) {
 
 void main()
 {
-    int modVal = 20000;
-    float time = mod(uTime, modVal) / modVal;
-    float time2 = mod(uTime, (modVal*2)) / (modVal*2);
-    float time4 = mod(uTime, (modVal*4)) / (modVal*4);
-    vec3 sunMotion = vec3(0, time, -time);
-    vec3 sunDirRise = normalize(vec3(0, 0, 1.f) + sunMotion);
-    sunMotion = vec3(0, -time, -time);
-    vec3 sunDirSet = normalize(vec3(0, 1, 0.f) + sunMotion);
-
-    vec3 sunDir = sunDirRise;
-    vec3 sunColor = vec3(255, 255, 190) / 255.0;
-
-    if (time2 > 0.5) {
-        sunDir = sunDirSet;
-        sunColor = mix(sunColorDay, sunColorDusk, time);
-    } else {
-        sunColor = mix(sunColorDawn, sunColorDay, time);
-    }
-    //Night so we have a moon instead
-    if (time4 >= 0.5) {
-        vec3 moonDir = normalize(vec3(0.f, 1.f, 1.f));
-        sunDir = moonDir;
-        sunColor = 0.25 * moonColor;
+    //the day cycle is worked out once per frame on the cpu, see FrameUniforms
+    vec3 sunDir = u_SunDir.xyz;
+    vec3 sunColor = u_SunColor.rgb;
+    //Night so we have a dimmer moon instead
+    if (u_SunDir.w > 0.5) {
+        sunColor *= 0.25;
     }
     vec4 fs_LightVec = vec4(sunDir, 0.f);  // Compute the direction in which the light source lies
 
@@ -115,14 +103,20 @@ void main()
 
     vec2 uv = vec2(fs_UV);
 
+    //chunk faces carry block repeat coordinates, wrap them into their tile
+    if (fs_Tile > 0) {
+        vec4 tile = u_Tiles[fs_Tile - 1];
+        uv = tile.xy + fract(uv) * tile.zw;
+    }
+
     if (fs_UV.z == 1.f) {
-        uv.x = fs_UV.x + t/64.f;
+        uv.x += t/64.f;
     }
 
     // Material base color (before shading)
     vec4 diffuseColor = texture(u_Texture, vec2(uv));
 
-    if (fs_UV.z == 1.f && fs_UV.y <= 944.f/1024.f) {
+    if (fs_UV.z == 1.f && uv.y <= 944.f/1024.f) {
         diffuseColor += vec4(0.f, 0.3f, 0.8f, 0.f);
     }
 
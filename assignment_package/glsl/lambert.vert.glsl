@@ -16,36 +16,61 @@ uniform mat4 u_ModelInvTr;  // The inverse transpose of the model matrix.
                             // This allows us to transform the object's normals properly
                             // if the object has been non-uniformly scaled.
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
+// Per frame values shared by every program, std140 to match FrameData in frameuniforms.h
+layout(std140) uniform FrameData {
+    mat4 u_ViewProj;        // The matrix that defines the camera's transformation.
+    mat4 u_InvViewProj;
+    vec4 u_Eye;             // Camera position
+    vec4 u_SunDir;          // Toward the sun, or the moon when w is 1
+    vec4 u_SunColor;
+    int uTime;
+};
 
 uniform vec4 u_Color;       // When drawing the cube instance, we'll set our uniform color to represent different block types.
 
-uniform int uTime;
+uniform int u_Packed;       // 1 when drawing a chunk, whose vertices are a single PackedVertex (see chunk.h)
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shaders
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
 in vec4 vs_UV;              //The array of vertex uv coords passed to the shader
+in uvec2 vs_Packed;         //Chunk vertices, 8 bytes each instead of the three vec4s above
+in ivec2 vs_ChunkPos;       //World space corner of the chunk being drawn, one per draw (see ChunkArena)
 
 out vec4 fs_Pos;
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_UV;             //The UV of each vertex, passed to the fragment shader
+flat out int fs_Tile;       //1 + index into u_Tiles for chunk faces, 0 for atlas uvs
+
+// indexed by Direction
+const vec3 normals[6] = vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+                               vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
 
 void main()
 {
-    fs_Pos = vs_Pos;                     // Pass the vertex colors to the fragment shader for interpolation
+    vec4 pos = vs_Pos;
+    vec4 nor = vs_Nor;
     fs_UV = vs_UV;
+    fs_Tile = 0;
+    if (u_Packed != 0) {
+        uint p = vs_Packed.x;
+        uint t = vs_Packed.y;
+        pos = vec4(float(p & 31u) + float(vs_ChunkPos.x), float((p >> 5) & 511u),
+                   float((p >> 14) & 31u) + float(vs_ChunkPos.y), 1);
+        nor = vec4(normals[(p >> 19) & 7u], 0);
+        fs_UV = vec4(float(t & 31u), float((t >> 5) & 31u), float((p >> 22) & 1u), 0);
+        fs_Tile = int((t >> 10) & 63u) + 1;
+    }
+    fs_Pos = pos;                     // Pass the vertex colors to the fragment shader for interpolation
 
     mat3 invTranspose = mat3(u_ModelInvTr);
-    fs_Nor = vec4(invTranspose * vec3(vs_Nor), 0);          // Pass the vertex normals to the fragment shader for interpolation.
+    fs_Nor = vec4(invTranspose * vec3(nor), 0);          // Pass the vertex normals to the fragment shader for interpolation.
                                                             // Transform the geometry's normals by the inverse transpose of the
                                                             // model matrix. This is necessary to ensure the normals remain
                                                             // perpendicular to the surface after the surface is transformed by
                                                             // the model matrix.
 
 
-    vec4 modelposition = u_Model * vs_Pos;   // Temporarily store the transformed vertex positions for use below
+    vec4 modelposition = u_Model * pos;   // Temporarily store the transformed vertex positions for use below
 
     gl_Position = u_ViewProj * modelposition;// gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
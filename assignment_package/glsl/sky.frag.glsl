@@ -1,14 +1,14 @@
 #version 150
 
-uniform mat4 u_ViewProj;    // We're actually passing the inverse of the viewproj
-                            // from our CPU, but it's named u_ViewProj so we don't
-                            // have to bother rewriting our ShaderProgram class
-
-uniform ivec2 u_Dimensions; // Screen dimensions
-
-uniform vec3 u_Eye; // Camera pos
-
-uniform int uTime;
+// Per frame values shared by every program, std140 to match FrameData in frameuniforms.h
+layout(std140) uniform FrameData {
+    mat4 u_ViewProj;        // The matrix that defines the camera's transformation.
+    mat4 u_InvViewProj;
+    vec4 u_Eye;             // Camera position
+    vec4 u_SunDir;          // Toward the sun, or the moon when w is 1
+    vec4 u_SunColor;
+    int uTime;
+};
 
 in vec4 fs_Pos;
 out vec3 out_Col;
@@ -32,11 +32,6 @@ const vec3 dusk[5] = vec3[](vec3(144, 96, 144) / 255.0,
 const vec3 nightSky = vec3(2.0/255.0, 1.0/255.0, 78.0/255.0);
 const vec3 daySky = vec3(0.37f, 0.74f, 1.0f);
 
-const vec3 sunColorDawn = vec3(255, 246, 79) / 255.0;
-const vec3 sunColorDusk = vec3(255, 246, 79) / 255.0;
-const vec3 sunColorDay = vec3(255, 249, 196) / 255.0;
-
-const vec3 moonColor = vec3(200.0, 233.0, 248.0) / 255.0;
 
 vec2 sphereToUV(vec3 p) {
     float phi = atan(p.z, p.x);
@@ -144,8 +139,6 @@ void main()
 {
     //times for day and night cycles
     int modVal = 20000;
-    float time = mod(uTime, modVal) / modVal;
-    float time2 = mod(uTime, (modVal*2)) / (modVal*2);
     float time4 = mod(uTime, (modVal*4)) / (modVal*4);
 
     //use the screen space coordinate from the vertex shader
@@ -153,9 +146,9 @@ void main()
 
     vec4 p = vec4(ndc.xy, 1, 1); // Pixel at the far clip plane
     p *= 1000.0; // Times far clip plane value
-    p = /*Inverse of*/ u_ViewProj * p; // Convert from unhomogenized screen to world
+    p = u_InvViewProj * p; // Convert from unhomogenized screen to world
 
-    vec3 rayDir = normalize(p.xyz - u_Eye);
+    vec3 rayDir = normalize(p.xyz - u_Eye.xyz);
 
     vec2 uv = sphereToUV(rayDir);
 
@@ -167,8 +160,6 @@ void main()
     offset *= 2.0;
     offset -= vec2(1.0);
 
-    vec3 sunColor = sunColorDay;
-
     // Compute a gradient from the bottom of the sky-sphere to the top
     vec3 sunsetColor = uvToSunset(uv + offset * 0.1);
     vec3 duskColor = uvToDusk(uv + offset * 0.1);
@@ -179,25 +170,10 @@ void main()
         skyColor = nightSky;
     }
 
-    // Add a glowing sun in the sky
-    vec3 sunMotion = vec3(0, time, -time);
-    vec3 sunDirRise = normalize(vec3(0, 0, 1.f) + sunMotion);
-    sunMotion = vec3(0, -time, -time);
-    vec3 sunDirSet = normalize(vec3(0, 1, 0.f) + sunMotion);
-
-    vec3 sunDir = sunDirRise;
-    if (time2 >= 0.5) {
-        sunDir = sunDirSet;
-        sunColor = mix(sunColorDay, sunColorDusk, time);
-    } else {
-        sunColor = mix(sunColorDawn, sunColorDay, time);
-    }
-    //Night so we have a moon instead
-    if (time4 >= 0.5) {
-        vec3 moonDir = normalize(vec3(0.f, 1.f, 1.f));
-        sunDir = moonDir;
-        sunColor = moonColor;
-    } else {
+    // Add a glowing sun in the sky, or the moon at night (see FrameUniforms)
+    vec3 sunDir = u_SunDir.xyz;
+    vec3 sunColor = u_SunColor.rgb;
+    if (time4 < 0.5) {
         float raySunDot = dot(rayDir, sunDir);
         float SUNSET_THRESHOLD = 0.9;
         float DUSK_THRESHOLD = -0.1;
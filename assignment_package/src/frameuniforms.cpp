@@ -0,0 +1,60 @@
+#include "frameuniforms.h"
+
+static const glm::vec3 sunColorDawn = glm::vec3(255, 246, 79) / 255.f;
+static const glm::vec3 sunColorDusk = glm::vec3(255, 246, 79) / 255.f;
+static const glm::vec3 sunColorDay = glm::vec3(255, 249, 196) / 255.f;
+static const glm::vec3 moonColor = glm::vec3(200, 233, 248) / 255.f;
+
+// the day cycle both lambert and the sky used to work out per fragment
+static void sunLight(int time, FrameData &f) {
+    int modVal = 20000;
+    float t = (time % modVal) / float(modVal);
+    float t2 = (time % (modVal * 2)) / float(modVal * 2);
+    float t4 = (time % (modVal * 4)) / float(modVal * 4);
+
+    glm::vec3 dir = glm::normalize(glm::vec3(0, 0, 1) + glm::vec3(0, t, -t));
+    glm::vec3 color = glm::mix(sunColorDawn, sunColorDay, t);
+    if(t2 >= 0.5f) {
+        dir = glm::normalize(glm::vec3(0, 1, 0) + glm::vec3(0, -t, -t));
+        color = glm::mix(sunColorDay, sunColorDusk, t);
+    }
+    //night so we have a moon instead
+    bool night = t4 >= 0.5f;
+    if(night) {
+        dir = glm::normalize(glm::vec3(0, 1, 1));
+        color = moonColor;
+    }
+    f.sunDir = glm::vec4(dir, night ? 1 : 0);
+    f.sunColor = glm::vec4(color, 1);
+}
+
+FrameUniforms::FrameUniforms(OpenGLContext *context)
+    : context(context), m_buf(0), m_data()
+{}
+
+FrameUniforms::~FrameUniforms() {
+    if(m_buf) context->glDeleteBuffers(1, &m_buf);
+}
+
+void FrameUniforms::create() {
+    context->glGenBuffers(1, &m_buf);
+    context->glBindBuffer(GL_UNIFORM_BUFFER, m_buf);
+    context->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+    //stays bound here, programs attach their block to the binding point in ShaderProgram::create
+    context->glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, m_buf);
+    context->printGLErrorLog();
+}
+
+void FrameUniforms::update(const glm::mat4 &viewProj, glm::vec3 eye, int time) {
+    m_data.viewProj = viewProj;
+    m_data.invViewProj = glm::inverse(viewProj);
+    m_data.eye = glm::vec4(eye, 1);
+    m_data.time = time;
+    sunLight(time, m_data);
+    context->glBindBuffer(GL_UNIFORM_BUFFER, m_buf);
+    context->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_data);
+}
+
+const FrameData& FrameUniforms::data() const {
+    return m_data;
+}
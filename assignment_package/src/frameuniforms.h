@@ -0,0 +1,37 @@
+#pragma once
+
+#include <openglcontext.h>
+#include <glm_includes.h>
+
+// uniform buffer binding point every program's FrameData block is attached to
+#define FRAME_DATA_BINDING 0
+
+// What every program needs once per frame, laid out std140 to match the
+// FrameData block in lambert, instanced and sky. Keep them in sync
+struct FrameData {
+    glm::mat4 viewProj;
+    glm::mat4 invViewProj;  //the sky turns screen positions back into rays with this
+    glm::vec4 eye;          //xyz camera position
+    glm::vec4 sunDir;       //xyz toward whatever lights the world, w is 1 at night when that's the moon
+    glm::vec4 sunColor;
+    GLint time;             //tick count, drives the day cycle and animated tiles
+    GLint pad[3];
+};
+
+// The buffer behind FrameData, uploaded once per frame and shared by every
+// program instead of setting the same uniforms on each of them
+class FrameUniforms {
+public:
+    FrameUniforms(OpenGLContext* context);
+    ~FrameUniforms();
+
+    void create();
+    // fills in the sun from time and uploads the lot
+    void update(const glm::mat4 &viewProj, glm::vec3 eye, int time);
+    const FrameData& data() const;
+
+private:
+    OpenGLContext* context;
+    GLuint m_buf;
+    FrameData m_data;
+};
@@ -29,6 +29,11 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendServerIP(QString)), &playerInfoWindow, SLOT(slot_setServerIP(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendChunkMemory(QString)), &playerInfoWindow, SLOT(slot_setChunkMemoryText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendMeshStats(QString)), &playerInfoWindow, SLOT(slot_setMeshStatsText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendRenderStats(QString)), &playerInfoWindow, SLOT(slot_setRenderStatsText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendGLStats(QString)), &playerInfoWindow, SLOT(slot_setGLStatsText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendLoadStats(QString)), &playerInfoWindow, SLOT(slot_setLoadStatsText(QString)));
 }
 
 MainWindow::~MainWindow()
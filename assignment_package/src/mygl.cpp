@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
@@ -14,6 +16,8 @@
 #include "algo/perlin.h"
 #include "algo/seed.h"
 #include "scene/biome.h"
+#include "scene/blockcursor.h"
+#include "scene/chunkmap.h"
 #include "scene/font.h"
 #include "scene/inventory.h"
 #include "scene/runnables.h"
@@ -26,8 +30,9 @@ MyGL::MyGL(QWidget *parent)
     : OpenGLContext(parent),
       m_worldAxes(this),
       m_progLambert(this), m_progFlat(this), m_progOverlay(this), m_progInstanced(this), m_progPostProcess(this), m_progSky(this),
-      m_terrain(this), m_player(glm::vec3(48.f, 129.f, 48.f), m_terrain, this, QString("Player")),
-      m_time(0), m_block_texture(this), m_font_texture(this), m_inventory_texture(this), m_icon_texture(this), m_currentMSecsSinceEpoch(QDateTime::currentMSecsSinceEpoch()),
+      m_frameUniforms(this),
+      m_terrain(this), m_horizon(this), m_player(glm::vec3(48.f, 129.f, 48.f), m_terrain, this, QString("Player")),
+      m_time(0), m_frameMs(0), m_frameTimes(FRAME_TIME_SAMPLES, 0.f), m_frameTimesAt(0), m_glCalls{0, 0, 0}, m_block_texture(this), m_font_texture(this), m_inventory_texture(this), m_icon_texture(this), m_currentMSecsSinceEpoch(QDateTime::currentMSecsSinceEpoch()),
       ip("localhost"),
       m_frame(this, this->width(), this->height(), this->devicePixelRatio()), m_quad(this), m_sky(this),
       m_rectangle(this), m_crosshair(this), m_mychat(this), m_heart(this),
@@ -50,6 +55,7 @@ void MyGL::start(bool joinServer, QString username) {
     overlayTransform = glm::scale(glm::mat4(1), glm::vec3(1.f/width(), 1.f/height(), 1.f));
     m_crosshair.createVBOdata();
     m_rectangle.createVBOdata();
+    m_horizon.createVBOdata();
     m_heart.createVBOdata();
     m_halfheart.createVBOdata();
     m_fullheart.createVBOdata();
@@ -63,9 +69,15 @@ void MyGL::start(bool joinServer, QString username) {
     //noise function distribution tests
     //distTest();
     //biomeDist();
+    //chunkMapBench();
+    //blockCursorBench();
+    //chunkFillBench();
+    //meshMemoryBench();
 
     //check if we need to host a server
     if(!joinServer) {
+        //same world as the server we host, so read its saved chunks instead of generating them
+        m_terrain.enablePersistence(WORLD_DIR, true);
         SERVER = mkU<Server>(2, port);
         while(!SERVER->setup);
         ip = getIP().data();
@@ -143,6 +155,7 @@ void MyGL::initializeGL()
     // Create an OpenGL context using Qt's QOpenGLFunctions_3_2_Core class
     // If you were programming in a non-Qt context you might use GLEW (GL Extension Wrangler)instead
     initializeOpenGLFunctions();
+    loadDrawFunctions();
     // Print out some information about the current OpenGL context
     debugContextVersion();
 
@@ -184,8 +197,10 @@ void MyGL::initializeGL()
     //Create the instance of the world axes
     m_worldAxes.createVBOdata();
 
+    m_frameUniforms.create();
     // Create and set up the diffuse shader
     m_progLambert.create(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
+    m_progLambert.setTiles(blockTiles());
     // Create and set up the flat lighting shader
     m_progFlat.create(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
     m_progInstanced.create(":/glsl/instanced.vert.glsl", ":/glsl/instanced.frag.glsl");
@@ -219,13 +234,9 @@ void MyGL::resizeGL(int w, int h) {
 
     // Upload the view-projection matrix to our shaders (i.e. onto the graphics card)
 
-    m_progLambert.setViewProjMatrix(viewproj);
+    // lambert, instanced and sky read theirs from m_frameUniforms every frame
     m_progFlat.setViewProjMatrix(viewproj);
     m_progOverlay.setViewProjMatrix(viewproj);
-    m_progSky.setViewProjMatrix(glm::inverse(viewproj));
-
-    m_progSky.setDimensions(width(), height());
-    m_progSky.setEye(m_player.m_position);
 
     overlayTransform = glm::scale(glm::mat4(1), glm::vec3(1.f/w, 1.f/h, 1.f));
 
@@ -262,6 +273,13 @@ void MyGL::tick() {
     m_player.tick(dt, m_inputs);
     setupTerrainThreads();
 
+    //drops far away chunks once over the memory budget, evicting frees vbos so it needs the context
+    if(m_time % 60 == 0) {
+        makeCurrent();
+        m_terrain.evictChunks({glm::vec2(m_player.mcr_position.x, m_player.mcr_position.z)}, EVICT_RADIUS);
+        doneCurrent();
+    }
+
     update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
 
     ItemType inHand, onHead, onChest, onLeg, onFoot;
@@ -295,10 +313,9 @@ void MyGL::setupTerrainThreads() {
     //does rendering stuff
     int minx = floor(m_player.mcr_position.x/64)*64;
     int miny = floor(m_player.mcr_position.z/64)*64;
-    for(int dx = minx-192; dx <= minx+192; dx+=64) {
-        for(int dy = miny-192; dy <= miny+192; dy+=64) {
-            if(m_terrain.m_generatedTerrain.find(toKey(dx, dy)) == m_terrain.m_generatedTerrain.end()){
-                m_terrain.m_generatedTerrain.insert(toKey(dx, dy));
+    for(int dx = minx-GEN_ZONE_RADIUS*64; dx <= minx+GEN_ZONE_RADIUS*64; dx+=64) {
+        for(int dy = miny-GEN_ZONE_RADIUS*64; dy <= miny+GEN_ZONE_RADIUS*64; dy+=64) {
+            if(m_terrain.markZoneGenerated(dx, dy)){
                 for(int ddx = dx; ddx < dx + 64; ddx+=16) {
                     for(int ddy = dy; ddy < dy + 64; ddy+=16) {
                         //qDebug() << "creating ground for " << ddx << ddy;
@@ -311,16 +328,14 @@ void MyGL::setupTerrainThreads() {
 
     //checks for additional structures for rendering, but not as often since structure threads can finish at staggered times
     if(m_time%30 == 0) {
-        for(int dx = minx-192; dx <= minx+192; dx+=64) {
-            for(int dy = miny-192; dy <= miny+192; dy+=64) {
+        for(int dx = minx-GEN_ZONE_RADIUS*64; dx <= minx+GEN_ZONE_RADIUS*64; dx+=64) {
+            for(int dy = miny-GEN_ZONE_RADIUS*64; dy <= miny+GEN_ZONE_RADIUS*64; dy+=64) {
                 for(int ddx = dx; ddx < dx + 64; ddx+=16) {
                     for(int ddy = dy; ddy < dy + 64; ddy+=16) {
-                        if(m_terrain.hasChunkAt(ddx, ddy)){
-                            Chunk* c = m_terrain.getChunkAt(ddx, ddy).get();
-                            if(c->dataGen && c->blocksChanged){
-                                c->blocksChanged = false;
-                                m_terrain.createVBOThread(c);
-                            }
+                        Chunk* c = m_terrain.getChunkAt(ddx, ddy);
+                        if(c && c->dataGen && c->blocksChanged){
+                            c->blocksChanged = false;
+                            m_terrain.updateVBOThread(c);
                         }
                     }
                 }
@@ -341,13 +356,45 @@ void MyGL::sendPlayerDataToGUI() const{
     glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    //walks every chunk, so only refresh once a second
+    if(m_time % 60 == 0) {
+        int chunks = 0;
+        size_t bytes = m_terrain.blockMemoryUsage(&chunks);
+        size_t perChunk = chunks > 0 ? bytes / chunks : 0;
+        emit sig_sendChunkMemory(QString::fromStdString(std::to_string(perChunk) + " B/chunk (flat " + std::to_string(65536 * sizeof(BlockType)) + "), "
+                                                        + std::to_string(bytes / 1024) + " KB total"));
+        MeshStats st = m_terrain.meshStats();
+        emit sig_sendMeshStats(QString(Chunk::greedyMeshing ? "greedy, " : "naive, ") + QString::number(st.vertices) + " verts, "
+                               + QString::number(st.msPerMesh, 'f', 2) + " ms/chunk, " + QString::number(st.gpuBytes / 1024) + " KB GPU, "
+                               + QString::number(st.cpuBytes / 1024) + " KB CPU");
+        RenderStats rs = m_terrain.renderStats();
+        //hitches hide in the average, the slowest 1% of frames shows them
+        std::vector<float> times = m_frameTimes;
+        std::nth_element(times.begin(), times.begin() + times.size() * 99 / 100, times.end());
+        float p99 = times[times.size() * 99 / 100];
+        emit sig_sendRenderStats(QString::number(rs.chunks) + " chunks (" + QString::number(rs.culled) + " culled, "
+                                 + QString::number(rs.occluded) + " occluded, " + QString::number(rs.reduced) + " reduced) in "
+                                 + QString::number(rs.drawCalls) + " draws, "
+                                 + QString::number(m_frameMs, 'f', 2) + " ms CPU/frame (p99 " + QString::number(p99, 'f', 2) + "), arena "
+                                 + QString::number(rs.arenaBytes >> 20) + "/" + QString::number(rs.arenaCapacity >> 20) + " MB (budget "
+                                 + QString::number(rs.vramBudget >> 20) + ", " + QString::number(rs.meshesEvicted) + " evicted)");
+        emit sig_sendGLStats(QString::number(m_glCalls.calls) + " calls/frame (" + QString::number(m_glCalls.skipped) + " redundant skipped), "
+                             + QString::number(m_glCalls.draws) + " draws, " + QString::number(rs.uploadBytes >> 10) + " KB uploaded, "
+                             + QString::number(rs.uploadsQueued) + " chunks queued");
+        if(rs.loading) emit sig_sendLoadStats("loading for " + QString::number(rs.loadMs / 1000, 'f', 1) + " s, " + QString::number(rs.genQueued) + " to generate, "
+                                              + QString::number(rs.meshQueued) + " to mesh, " + QString::number(rs.uploadsQueued) + " to upload");
+        else emit sig_sendLoadStats("fully loaded in " + QString::number(rs.loadMs, 'f', 0) + " ms");
+    }
 }
 
 // This function is called whenever update() is called.
 // MyGL's constructor links update() to a timer that fires 60 times per second,
 // so paintGL() called at a rate of 60 frames per second.
 void MyGL::paintGL() {
-
+    auto start = std::chrono::high_resolution_clock::now();
+    //Qt draws in between frames, so nothing cached from the last one can be trusted
+    m_glCalls = takeGLCallStats();
+    resetGLState();
 
     // Clear the screen so that we only see newly drawn images
     m_frame.bindFrameBuffer();
@@ -379,15 +426,10 @@ void MyGL::paintGL() {
     m_progPostProcess.setType(m_player.getType());
     m_frame.bindToTextureSlot(3);
 
-    m_progLambert.setTime(m_time);
-    m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progLambert.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-    m_progInstanced.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-
-    m_progSky.setViewProjMatrix(glm::inverse(m_player.mcr_camera.getViewProj()));
-    m_progSky.setDimensions(width(), height());
-    m_progSky.setEye(m_player.mcr_position);
-    m_progSky.setTime(m_time);
+    //one upload covers every program reading FrameData
+    glm::mat4 viewProj = m_player.mcr_camera.getViewProj();
+    m_frameUniforms.update(viewProj, m_player.mcr_position, m_time);
+    m_progFlat.setViewProjMatrix(viewProj);
 
     if(drawSky) m_progSky.draw(m_sky);
 
@@ -402,6 +444,12 @@ void MyGL::paintGL() {
     m_frame.bindToTextureSlot(3);
 
     renderOverlays();
+
+    //only what we spend issuing work, the driver may still be drawing
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    m_frameMs = 0.95 * m_frameMs + 0.05 * ms;
+    m_frameTimes[m_frameTimesAt] = ms;
+    m_frameTimesAt = (m_frameTimesAt + 1) % FRAME_TIME_SAMPLES;
 }
 
 // TODO: Change this so it renders the nine zones of generated
@@ -415,7 +463,12 @@ void MyGL::renderTerrain() {
     float x = floor(m_player.mcr_position.x/16.f)*16;
     float y = floor(m_player.mcr_position.z/16.f)*16;
 
-    m_terrain.draw(x-renderDist, x+renderDist, y-renderDist, y+renderDist, &m_progLambert);
+    //coarse terrain past the generated zones, sunk so chunks drawn over it win
+    m_horizon.update(m_player.mcr_position, GEN_ZONE_RADIUS);
+    m_progFlat.setModelMatrix(glm::mat4());
+    m_progFlat.draw(m_horizon);
+
+    m_terrain.draw(x-renderDist, x+renderDist, y-renderDist, y+renderDist, &m_progLambert, m_player.mcr_camera);
     //m_terrain.draw(0, 1024, 0, 1024, &m_progInstanced);
 }
 void MyGL::renderOverlays() {
@@ -797,6 +850,8 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
 //            }
         } else if (e->key() == Qt::Key_M) { //drawing sky
             drawSky = !drawSky;
+        } else if (e->key() == Qt::Key_G) { //switching between the naive and greedy mesher
+            m_terrain.setGreedyMeshing(!Chunk::greedyMeshing);
         } else if (e->key() == Qt::Key_1) {
             m_player.m_inventory.hotbar.selected = 0;
             m_player.m_inventory.hotbar.createVBOdata();
@@ -1012,10 +1067,10 @@ void MyGL::mousePressEvent(QMouseEvent *e) {
                 if (m_terrain.gridMarch(cam_pos, ray_dir, &dist, &block_pos, d)) {
                     qDebug() << block_pos.x << " " << block_pos.y << " " << block_pos.z;
                     //m_terrain.changeBlockAt(block_pos.x, block_pos.y, block_pos.z, EMPTY);
-                    //Chunk* c = m_terrain.getChunkAt(block_pos.x, block_pos.z).get();
+                    //Chunk* c = m_terrain.getChunkAt(block_pos.x, block_pos.z);
 
                     m_terrain.changeBlockAt(block_pos.x, block_pos.y, block_pos.z, EMPTY);
-                    m_terrain.renderChange(m_terrain.getChunkAt(block_pos.x, block_pos.z).get(), block_pos.x, block_pos.z);
+                    m_terrain.renderChange(m_terrain.getChunkAt(block_pos.x, block_pos.z), block_pos.x, block_pos.y, block_pos.z);
 
                     BlockChangePacket bcp = BlockChangePacket(toKey(block_pos.x, block_pos.z), block_pos.y, EMPTY);
                     send_packet(&bcp);
@@ -1047,7 +1102,7 @@ void MyGL::mousePressEvent(QMouseEvent *e) {
                     }
                 }
                 m_terrain.changeBlockAt(neighbor.x, neighbor.y, neighbor.z, type);
-                m_terrain.renderChange(m_terrain.getChunkAt(neighbor.x, neighbor.z).get(), neighbor.x, neighbor.z);
+                m_terrain.renderChange(m_terrain.getChunkAt(neighbor.x, neighbor.z), neighbor.x, neighbor.y, neighbor.z);
                 m_player.m_inventory.hotbar.items[m_player.m_inventory.hotbar.selected]->item_count--;
                 if(m_player.m_inventory.hotbar.items[m_player.m_inventory.hotbar.selected]->item_count == 0) {
                     m_player.m_inventory.hotbar.items[m_player.m_inventory.hotbar.selected].reset();
@@ -1162,6 +1217,8 @@ void MyGL::close_client() {
 }
 
 void MyGL::packet_processer(Packet* packet) {
+    //runs on the client thread, keeps chunks we look up alive until we are done with them
+    Epoch::Guard g;
     switch(packet->type) {
     case PLAYER_STATE:{
         PlayerStatePacket* thispack = dynamic_cast<PlayerStatePacket*>(packet);
@@ -1255,7 +1312,7 @@ void MyGL::packet_processer(Packet* packet) {
         if(m_terrain.hasChunkAt(xz.x, xz.y) && m_terrain.getBlockAt(xz.x, thispack->yPos, xz.y) == thispack->newBlock) return;
         m_terrain.changeBlockAt(xz.x, thispack->yPos, xz.y, thispack->newBlock);
 
-        m_terrain.renderChange(m_terrain.getChunkAt(xz.x, xz.y).get(), xz.x, xz.y);
+        m_terrain.renderChange(m_terrain.getChunkAt(xz.x, xz.y), xz.x, thispack->yPos, xz.y);
         break;
     }
     case CHAT: {
@@ -6,9 +6,11 @@
 #include "scene/icons.h"
 #include "scene/rectangle.h"
 #include "shaderprogram.h"
+#include "frameuniforms.h"
 #include "scene/worldaxes.h"
 #include "scene/camera.h"
 #include "scene/terrain.h"
+#include "scene/horizon.h"
 #include "scene/player.h"
 #include "texture.h"
 #include "server/server.h"
@@ -23,6 +25,12 @@
 #include <smartpointerhelp.h>
 
 #define BUFFER_SIZE 5000
+//render distance plus a zone of slack
+#define EVICT_RADIUS 576
+//zones generated in every direction from the player's, the horizon fills in past them
+#define GEN_ZONE_RADIUS 3
+//frames the p99 frame time is taken over, about 10 seconds
+#define FRAME_TIME_SAMPLES 600
 
 class MyGL : public OpenGLContext
 {
@@ -37,12 +45,14 @@ private:
     ShaderProgram m_progInstanced;// A shader program that is designed to be compatible with instanced rendering
     ShaderProgram m_progPostProcess;
     ShaderProgram m_progSky;
+    FrameUniforms m_frameUniforms; // view-proj, time and sun shared by lambert, instanced and sky
 
 
     GLuint vao; // A handle for our vertex array object. This will store the VBOs created in our geometry classes.
                 // Don't worry too much about this. Just know it is necessary in order to render geometry.
 
     Terrain m_terrain; // All of the Chunks that currently comprise the world.
+    Horizon m_horizon; // coarse heightmap of the world past what m_terrain has generated
     Player m_player; // The entity controlled by the user. Contains a camera to display what it sees as well.
     FrameBuffer m_frame;
     Quad m_quad;
@@ -53,6 +63,10 @@ private:
 
     QTimer m_timer; // Timer linked to tick(). Fires approximately 60 times per second.
     int m_time; //to get tick number
+    double m_frameMs; //paintGL cpu time, averaged over the last second or so
+    std::vector<float> m_frameTimes; //the last FRAME_TIME_SAMPLES of it, oldest at m_frameTimesAt
+    int m_frameTimesAt;
+    GLCallStats m_glCalls; //what the last frame asked of GL, see OpenGLContext::resetGLState
     bool mouseMove;
 
     Texture m_block_texture;
@@ -175,6 +189,11 @@ signals:
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
     void sig_sendServerIP(QString) const;
+    void sig_sendChunkMemory(QString) const;
+    void sig_sendMeshStats(QString) const;
+    void sig_sendRenderStats(QString) const;
+    void sig_sendGLStats(QString) const;
+    void sig_sendLoadStats(QString) const;
 };
 
 
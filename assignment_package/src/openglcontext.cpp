@@ -7,13 +7,176 @@
 #include <QDebug>
 
 
+#define GL_UNKNOWN GLuint(-1)
+
 OpenGLContext::OpenGLContext(QWidget *parent)
-    : QOpenGLWidget(parent)
-{}
+    : QOpenGLWidget(parent), drawElementsBaseVertex(nullptr), multiDrawElementsIndirect(nullptr),
+      m_program(GL_UNKNOWN), m_vao(GL_UNKNOWN), m_buffers(), m_activeTexture(GL_UNKNOWN), m_textures(),
+      m_attribs(0), m_attribsKnown(0), m_callStats{0, 0, 0}
+{
+    resetGLState();
+}
 
 OpenGLContext::~OpenGLContext()
 {}
 
+void OpenGLContext::loadDrawFunctions()
+{
+    QOpenGLContext *ctx = context();
+    drawElementsBaseVertex = reinterpret_cast<DrawElementsBaseVertexFn>(ctx->getProcAddress("glDrawElementsBaseVertex"));
+    //indirect draws with a baseInstance are 4.2, the multi draw 4.3
+    multiDrawElementsIndirect = nullptr;
+    if(!ctx->isOpenGLES() && ctx->format().version() >= qMakePair(4, 3)) {
+        multiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirectFn>(ctx->getProcAddress("glMultiDrawElementsIndirect"));
+    }
+    qDebug() << "chunk draws:" << (multiDrawElementsIndirect ? "multi draw indirect" : "one draw per chunk");
+}
+
+static int bufferTarget(GLenum target) {
+    switch(target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_ELEMENT_ARRAY_BUFFER: return 1;
+    case GL_DRAW_INDIRECT_BUFFER: return 2;
+    default: return -1;
+    }
+}
+
+bool OpenGLContext::changes(GLuint &cached, GLuint value) {
+    if(cached == value) {
+        m_callStats.skipped++;
+        return false;
+    }
+    cached = value;
+    m_callStats.calls++;
+    return true;
+}
+
+void OpenGLContext::glUseProgram(GLuint program) {
+    if(changes(m_program, program)) QOpenGLExtraFunctions::glUseProgram(program);
+}
+
+void OpenGLContext::glBindVertexArray(GLuint array) {
+    if(!changes(m_vao, array)) return;
+    QOpenGLExtraFunctions::glBindVertexArray(array);
+    //the index buffer and enabled attributes belong to the vao
+    m_buffers[bufferTarget(GL_ELEMENT_ARRAY_BUFFER)] = GL_UNKNOWN;
+    m_attribsKnown = 0;
+}
+
+void OpenGLContext::glBindBuffer(GLenum target, GLuint buffer) {
+    int t = bufferTarget(target);
+    if(t < 0) {
+        m_callStats.calls++;
+        QOpenGLExtraFunctions::glBindBuffer(target, buffer);
+    }
+    else if(changes(m_buffers[t], buffer)) {
+        QOpenGLExtraFunctions::glBindBuffer(target, buffer);
+    }
+}
+
+void OpenGLContext::glActiveTexture(GLenum texture) {
+    if(changes(m_activeTexture, texture)) QOpenGLExtraFunctions::glActiveTexture(texture);
+}
+
+void OpenGLContext::glBindTexture(GLenum target, GLuint texture) {
+    unsigned unit = m_activeTexture - GL_TEXTURE0;
+    if(target != GL_TEXTURE_2D || unit >= CACHED_TEXTURE_UNITS) {
+        m_callStats.calls++;
+        QOpenGLExtraFunctions::glBindTexture(target, texture);
+    }
+    else if(changes(m_textures[unit], texture)) {
+        QOpenGLExtraFunctions::glBindTexture(target, texture);
+    }
+}
+
+void OpenGLContext::glEnableVertexAttribArray(GLuint index) {
+    unsigned bit = 1u << index;
+    if((m_attribsKnown & bit) && (m_attribs & bit)) {
+        m_callStats.skipped++;
+        return;
+    }
+    m_attribs |= bit;
+    m_attribsKnown |= bit;
+    m_callStats.calls++;
+    QOpenGLExtraFunctions::glEnableVertexAttribArray(index);
+}
+
+void OpenGLContext::glDisableVertexAttribArray(GLuint index) {
+    unsigned bit = 1u << index;
+    if((m_attribsKnown & bit) && !(m_attribs & bit)) {
+        m_callStats.skipped++;
+        return;
+    }
+    m_attribs &= ~bit;
+    m_attribsKnown |= bit;
+    m_callStats.calls++;
+    QOpenGLExtraFunctions::glDisableVertexAttribArray(index);
+}
+
+void OpenGLContext::useVertexAttribs(unsigned mask) {
+    //every location a program can have, 16 is the least GL guarantees
+    for(GLuint i = 0; i < 16; i++) {
+        if(mask >> i & 1) glEnableVertexAttribArray(i);
+        else glDisableVertexAttribArray(i);
+    }
+}
+
+void OpenGLContext::glDeleteProgram(GLuint program) {
+    if(m_program == program) m_program = GL_UNKNOWN;
+    QOpenGLExtraFunctions::glDeleteProgram(program);
+}
+
+void OpenGLContext::glDeleteBuffers(GLsizei n, const GLuint *buffers) {
+    //GL unbinds a deleted buffer, and a later glGenBuffers can hand the name out again
+    for(GLsizei i = 0; i < n; i++) {
+        for(GLuint &b: m_buffers) {
+            if(b == buffers[i]) b = GL_UNKNOWN;
+        }
+    }
+    QOpenGLExtraFunctions::glDeleteBuffers(n, buffers);
+}
+
+void OpenGLContext::glDeleteTextures(GLsizei n, const GLuint *textures) {
+    for(GLsizei i = 0; i < n; i++) {
+        for(GLuint &t: m_textures) {
+            if(t == textures[i]) t = GL_UNKNOWN;
+        }
+    }
+    QOpenGLExtraFunctions::glDeleteTextures(n, textures);
+}
+
+void OpenGLContext::glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices) {
+    m_callStats.calls++;
+    m_callStats.draws++;
+    QOpenGLExtraFunctions::glDrawElements(mode, count, type, indices);
+}
+
+void OpenGLContext::glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount) {
+    m_callStats.calls++;
+    m_callStats.draws++;
+    QOpenGLExtraFunctions::glDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+
+void OpenGLContext::countDraws(int n) {
+    m_callStats.calls += n;
+    m_callStats.draws += n;
+}
+
+void OpenGLContext::resetGLState() {
+    m_program = GL_UNKNOWN;
+    m_vao = GL_UNKNOWN;
+    for(GLuint &b: m_buffers) b = GL_UNKNOWN;
+    m_activeTexture = GL_UNKNOWN;
+    for(GLuint &t: m_textures) t = GL_UNKNOWN;
+    m_attribsKnown = 0;
+}
+
+OpenGLContext::GLCallStats OpenGLContext::takeGLCallStats() {
+    GLCallStats st = m_callStats;
+    m_callStats = {0, 0, 0};
+    return st;
+}
+
 inline const char *glGS(GLenum e)
 {
     return reinterpret_cast<const char *>(glGetString(e));
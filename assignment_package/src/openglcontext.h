@@ -4,6 +4,8 @@
 #include <QTimer>
 #include <QOpenGLExtraFunctions>
 
+#define CACHED_BUFFER_TARGETS 3 //GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER
+#define CACHED_TEXTURE_UNITS 16
 
 class OpenGLContext
     : public QOpenGLWidget,
@@ -18,4 +20,58 @@ public:
     void printGLErrorLog();
     void printLinkInfoLog(int prog);
     void printShaderInfoLog(int shader);
+
+    // Desktop GL draws QOpenGLExtraFunctions doesn't wrap, set by loadDrawFunctions()
+    // once the context is current. Null when the driver doesn't have them
+    typedef void (QOPENGLF_APIENTRYP DrawElementsBaseVertexFn)(GLenum mode, GLsizei count, GLenum type,
+                                                               const void *indices, GLint basevertex);
+    typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirectFn)(GLenum mode, GLenum type, const void *indirect,
+                                                                  GLsizei drawcount, GLsizei stride);
+    DrawElementsBaseVertexFn drawElementsBaseVertex;
+    MultiDrawElementsIndirectFn multiDrawElementsIndirect;
+    void loadDrawFunctions();
+
+    // A cache of the binding state. These hide the QOpenGLExtraFunctions calls of
+    // the same name, so every bind made through a context goes through it and the
+    // ones that wouldn't change anything are skipped. Deletes drop what they free
+    void glUseProgram(GLuint program);
+    void glBindVertexArray(GLuint array);
+    void glBindBuffer(GLenum target, GLuint buffer);
+    void glActiveTexture(GLenum texture);
+    void glBindTexture(GLenum target, GLuint texture);
+    void glEnableVertexAttribArray(GLuint index);
+    void glDisableVertexAttribArray(GLuint index);
+    void glDeleteProgram(GLuint program);
+    void glDeleteBuffers(GLsizei n, const GLuint *buffers);
+    void glDeleteTextures(GLsizei n, const GLuint *textures);
+    // only counted
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices);
+    void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+    // for draws made through the function pointers above
+    void countDraws(int n);
+    // enables exactly the vertex attributes in mask (bit i is location i) and disables the rest,
+    // so back to back draws with the same layout don't toggle anything
+    void useVertexAttribs(unsigned mask);
+    // forgets the cached state, for when something else may have changed it (Qt between frames)
+    void resetGLState();
+
+    struct GLCallStats {
+        int calls;   //state changes and draws that reached GL
+        int skipped; //state changes the cache dropped
+        int draws;
+    };
+    // counts since the last call
+    GLCallStats takeGLCallStats();
+
+private:
+    // GL_UNKNOWN where we can't tell what GL has
+    GLuint m_program, m_vao;
+    GLuint m_buffers[CACHED_BUFFER_TARGETS];
+    GLenum m_activeTexture;
+    GLuint m_textures[CACHED_TEXTURE_UNITS]; //GL_TEXTURE_2D on each unit
+    unsigned m_attribs, m_attribsKnown;     //enabled vertex attributes, and which bits of that are known
+    GLCallStats m_callStats;
+
+    // true if the call has to go through, counts it either way
+    bool changes(GLuint &cached, GLuint value);
 };
@@ -40,3 +40,23 @@ void PlayerInfo::slot_setZoneText(QString s) {
 void PlayerInfo::slot_setServerIP(QString s) {
     ui->serverIPLabel->setText(s);
 }
+
+void PlayerInfo::slot_setChunkMemoryText(QString s) {
+    ui->chunkMemoryLabel->setText(s);
+}
+
+void PlayerInfo::slot_setMeshStatsText(QString s) {
+    ui->meshStatsLabel->setText(s);
+}
+
+void PlayerInfo::slot_setRenderStatsText(QString s) {
+    ui->renderStatsLabel->setText(s);
+}
+
+void PlayerInfo::slot_setGLStatsText(QString s) {
+    ui->glStatsLabel->setText(s);
+}
+
+void PlayerInfo::slot_setLoadStatsText(QString s) {
+    ui->loadStatsLabel->setText(s);
+}
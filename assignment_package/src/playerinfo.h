@@ -21,6 +21,11 @@ public slots:
     void slot_setChunkText(QString);
     void slot_setZoneText(QString);
     void slot_setServerIP(QString);
+    void slot_setChunkMemoryText(QString);
+    void slot_setMeshStatsText(QString);
+    void slot_setRenderStatsText(QString);
+    void slot_setGLStatsText(QString);
+    void slot_setLoadStatsText(QString);
 private:
     Ui::PlayerInfo *ui;
 };
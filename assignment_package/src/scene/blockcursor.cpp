@@ -0,0 +1,96 @@
+#include "blockcursor.h"
+#include "terrain.h"
+#include "chunkmap.h"
+#include <QDebug>
+#include <chrono>
+#include <random>
+#include <climits>
+
+BlockCursor::BlockCursor(const Terrain &t)
+    : m_guard(), m_chunks(t.m_chunks), m_cache(), m_last(m_cache)
+{
+    //no chunk index is INT_MIN, so every entry starts out missing
+    for(Entry &e: m_cache) e = {INT_MIN, INT_MIN, nullptr};
+}
+
+Chunk* BlockCursor::chunkAt(int x, int z) {
+    //arithmetic shift floors negatives too
+    int cx = x >> 4, cz = z >> 4;
+    if(m_last->cx == cx && m_last->cz == cz) return m_last->chunk;
+    Entry &e = m_cache[(cx & 3) | (cz & 3) << 2];
+    if(e.cx != cx || e.cz != cz) {
+        e = {cx, cz, m_chunks.find(16 * cx, 16 * cz)};
+    }
+    m_last = &e;
+    return e.chunk;
+}
+
+BlockType BlockCursor::get(int x, int y, int z, BlockType missing) {
+    if(y < 0 || y >= 256) return EMPTY;
+    Chunk* c = chunkAt(x, z);
+    if(c == nullptr) return missing;
+    return c->getLocalBlock(x & 15, y, z & 15);
+}
+
+BlockType BlockCursor::get(glm::ivec3 p, BlockType missing) {
+    return get(p.x, p.y, p.z, missing);
+}
+
+bool BlockCursor::loaded(int x, int z) {
+    return chunkAt(x, z) != nullptr;
+}
+
+bool isTransparent(BlockCursor &cur, int x, int y, int z) {
+    return checkTransparent(cur.get(x, y, z));
+}
+
+bool isEmpty(BlockCursor &cur, int x, int y, int z) {
+    return cur.get(x, y, z) == EMPTY;
+}
+
+#define BENCH_CHUNKS 8 //BENCH_CHUNKS x BENCH_CHUNKS chunks around the origin
+#define BENCH_RANDOM_READS (1 << 22)
+
+template<typename Get>
+static void benchReads(const char* name, Get get) {
+    int half = 8 * BENCH_CHUNKS;
+    long sum = 0;
+
+    //uniform over the whole area, nearly every read lands in a different chunk
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> xz(-half, half - 1), y(0, 255);
+    std::vector<glm::ivec3> points(BENCH_RANDOM_READS);
+    for(glm::ivec3 &p: points) p = glm::ivec3(xz(rng), y(rng), xz(rng));
+    auto start = std::chrono::high_resolution_clock::now();
+    for(const glm::ivec3 &p: points) sum += get(p.x, p.y, p.z);
+    double randomMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    //column by column, the order meshing and structure building read in
+    start = std::chrono::high_resolution_clock::now();
+    for(int x = -half; x < half; x++) {
+        for(int z = -half; z < half; z++) {
+            for(int yy = 0; yy < 256; yy++) sum += get(x, yy, z);
+        }
+    }
+    double coherentMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    long coherentReads = long(2 * half) * (2 * half) * 256;
+
+    qDebug() << name << ":" << BENCH_RANDOM_READS / randomMs / 1000 << "M random reads/sec,"
+             << coherentReads / coherentMs / 1000 << "M coherent reads/sec" << "(checksum" << sum << ")";
+}
+
+void blockCursorBench() {
+    Terrain terrain(nullptr);
+    for(int x = -BENCH_CHUNKS / 2; x < BENCH_CHUNKS / 2; x++) {
+        for(int z = -BENCH_CHUNKS / 2; z < BENCH_CHUNKS / 2; z++) {
+            terrain.instantiateChunkAt(16 * x, 16 * z);
+        }
+    }
+    benchReads("Terrain::getBlockAt", [&terrain](int x, int y, int z) {
+        return terrain.getBlockAt(x, y, z);
+    });
+    BlockCursor cur(terrain);
+    benchReads("BlockCursor", [&cur](int x, int y, int z) {
+        return cur.get(x, y, z);
+    });
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "chunk.h"
+#include "epoch.h"
+
+class Terrain;
+class ChunkMap;
+
+// Fast world space block access for code that touches many nearby blocks.
+// Terrain::getBlockAt floors floats and goes through the chunk map on every
+// call, and throws when the chunk isn't loaded. A cursor instead remembers the
+// chunks it recently hit, so runs of nearby accesses only do integer shifts
+// and masks. Unloaded blocks read as a sentinel.
+//
+// The cursor pins the epoch for its lifetime so cached chunks can't be freed
+// under it. Keep it on the stack of one thread and don't hold it for long.
+class BlockCursor {
+private:
+    Epoch::Guard m_guard;
+    const ChunkMap &m_chunks;
+
+    // direct mapped on the low two bits of the chunk index, so any 4 x 4 block
+    // of chunks fits at once and a chunk's neighbors never evict it
+    struct Entry {
+        int cx, cz; //chunk index (world / 16)
+        Chunk* chunk;
+    };
+    Entry m_cache[16];
+    // last chunk returned, checked first
+    Entry* m_last;
+public:
+    explicit BlockCursor(const Terrain &t);
+    BlockCursor(const BlockCursor&) = delete;
+    BlockCursor& operator=(const BlockCursor&) = delete;
+
+    // chunk containing world space (x, z), nullptr if it isn't loaded
+    Chunk* chunkAt(int x, int z);
+    // block at world space (x, y, z). Returns EMPTY above or below the world
+    // like Terrain::getBlockAt, and missing if the chunk isn't loaded
+    BlockType get(int x, int y, int z, BlockType missing = EMPTY);
+    BlockType get(glm::ivec3 p, BlockType missing = EMPTY);
+    bool loaded(int x, int z);
+};
+
+// world space versions of the chunk local helpers in chunk.h, unloaded blocks are EMPTY
+bool isTransparent(BlockCursor &cur, int x, int y, int z);
+bool isEmpty(BlockCursor &cur, int x, int y, int z);
+
+// prints Terrain::getBlockAt and BlockCursor throughput for random and coherent access
+void blockCursorBench();
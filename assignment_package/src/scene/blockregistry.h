@@ -0,0 +1,81 @@
+#pragma once
+
+// C++ 11 allows us to define the size of an enum. This lets us use only one byte
+// of memory to store our different block types. By default, the size of a C++ enum
+// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
+// block types, but in the scope of this project we'll never get anywhere near that many.
+enum BlockType : unsigned char
+{
+    EMPTY, GRASS_BLOCK, DIRT, STONE, WATER, SAND, SNOW, COBBLESTONE,
+    OAK_PLANKS, SPRUCE_PLANKS, JUNGLE_PLANKS, BIRCH_PLANKS, ACACIA_PLANKS,
+    OAK_LOG, SPRUCE_LOG, BIRCH_LOG, JUNGLE_LOG, ACACIA_LOG,
+    OAK_LEAVES, BOOKSHELF, GLASS, PATH, SANDSTONE,
+    LAVA, BEDROCK, CACTUS, ICE,
+    GRASS};
+
+// Rectangle of the block atlas in texels, the atlas is 1024 x 1024
+struct AtlasRect {
+    float x0, y0, x1, y1;
+};
+
+// Which pass a block's faces are drawn in
+enum RenderLayer : unsigned char
+{
+    LAYER_NONE, LAYER_OPAQUE, LAYER_CLEAR
+};
+
+// Everything the mesher, raycaster and collision need to know about a block type.
+// Adding a block means adding it to BlockType and one row to BLOCK_INFO
+struct BlockInfo {
+    AtlasRect side;
+    AtlasRect top; //top and bottom
+    bool transparent; //faces behind it still show
+    bool solid;       //stops rays and entities
+    bool liquid;      //entities swim in it
+    bool animated;    //the shader scrolls its texture
+    RenderLayer layer;
+};
+
+constexpr BlockInfo BLOCK_INFO[] = {
+    //                  side                     top & bottom             transp solid  liquid anim   layer
+    /* EMPTY */         {{512, 1008, 528, 1024},  {512, 1008, 528, 1024},  true,  false, false, false, LAYER_NONE},
+    /* GRASS_BLOCK */   {{401, 1009, 415, 1023},  {497, 817, 511, 831},    false, true,  false, false, LAYER_OPAQUE},
+    /* DIRT */          {{337, 850, 350, 863},    {337, 850, 350, 863},    false, true,  false, false, LAYER_OPAQUE},
+    /* STONE */         {{507, 642, 510, 655},    {507, 642, 510, 655},    false, true,  false, false, LAYER_OPAQUE},
+    /* WATER */         {{129, 930, 142, 944},    {129, 930, 142, 944},    true,  false, true,  true,  LAYER_CLEAR},
+    /* SAND */          {{129, 658, 142, 671},    {129, 658, 142, 671},    false, true,  false, false, LAYER_OPAQUE},
+    /* SNOW */          {{480, 705, 494, 720},    {480, 705, 494, 720},    false, true,  false, false, LAYER_OPAQUE},
+    /* COBBLESTONE */   {{32, 770, 47, 784},      {32, 770, 47, 784},      false, true,  false, false, LAYER_OPAQUE},
+    /* OAK_PLANKS */    {{384, 737, 398, 752},    {384, 737, 398, 752},    false, true,  false, false, LAYER_OPAQUE},
+    /* SPRUCE_PLANKS */ {{448, 641, 462, 656},    {448, 641, 462, 656},    false, true,  false, false, LAYER_OPAQUE},
+    /* JUNGLE_PLANKS */ {{448, 849, 462, 864},    {448, 849, 462, 864},    false, true,  false, false, LAYER_OPAQUE},
+    /* BIRCH_PLANKS */  {{256, 929, 270, 944},    {256, 929, 270, 944},    false, true,  false, false, LAYER_OPAQUE},
+    /* ACACIA_PLANKS */ {{175, 929, 190, 944},    {175, 929, 190, 944},    false, true,  false, false, LAYER_OPAQUE},
+    /* OAK_LOG */       {{352, 738, 367, 752},    {369, 737, 383, 752},    false, true,  false, false, LAYER_OPAQUE},
+    /* SPRUCE_LOG */    {{416, 641, 431, 656},    {432, 641, 447, 656},    false, true,  false, false, LAYER_OPAQUE},
+    /* BIRCH_LOG */     {{256, 961, 270, 976},    {256, 945, 270, 960},    false, true,  false, false, LAYER_OPAQUE},
+    /* JUNGLE_LOG */    {{448, 881, 463, 896},    {448, 865, 463, 880},    false, true,  false, false, LAYER_OPAQUE},
+    /* ACACIA_LOG */    {{160, 897, 174, 912},    {176, 945, 191, 960},    false, true,  false, false, LAYER_OPAQUE},
+    /* OAK_LEAVES */    {{192, 1009, 207, 1024},  {192, 1009, 207, 1024},  true,  true,  false, false, LAYER_CLEAR},
+    /* BOOKSHELF */     {{192, 849, 207, 864},    {384, 737, 398, 752},    false, true,  false, false, LAYER_OPAQUE},
+    /* GLASS */         {{384, 881, 399, 896},    {384, 881, 399, 896},    true,  true,  false, false, LAYER_CLEAR},
+    /* PATH */          {{337, 833, 350, 847},    {337, 818, 350, 831},    false, true,  false, false, LAYER_OPAQUE},
+    /* SANDSTONE */     {{144, 657, 158, 671},    {160, 657, 174, 671},    false, true,  false, false, LAYER_OPAQUE},
+    /* LAVA */          {{129, 962, 141, 976},    {129, 962, 141, 976},    false, false, true,  true,  LAYER_OPAQUE},
+    /* BEDROCK */       {{208, 881, 222, 895},    {208, 881, 222, 895},    false, true,  false, false, LAYER_OPAQUE},
+    /* CACTUS */        {{32, 818, 47, 831},      {48, 817, 63, 832},      false, true,  false, false, LAYER_OPAQUE},
+    /* ICE */           {{224, 722, 238, 735},    {224, 722, 238, 735},    true,  true,  false, false, LAYER_CLEAR},
+    /* GRASS */         {{512, 1008, 528, 1024},  {512, 1008, 528, 1024},  false, true,  false, false, LAYER_OPAQUE},
+};
+static_assert(sizeof(BLOCK_INFO) / sizeof(BlockInfo) == GRASS + 1, "every BlockType needs a row in BLOCK_INFO");
+//two tiles per block, indexed through the 6 bit tile field of PackedVertex and
+//u_Tiles[64] in lambert.frag.glsl, both need widening past 32 block types
+static_assert(2 * (GRASS + 1) <= 64, "block tiles no longer fit the packed tile field and u_Tiles");
+
+constexpr const BlockInfo& blockInfo(BlockType t) {
+    return BLOCK_INFO[t];
+}
+
+inline bool checkTransparent(BlockType t) {
+    return BLOCK_INFO[t].transparent;
+}
@@ -0,0 +1,197 @@
+#include "blockstorage.h"
+#include "chunk.h"
+#include <stdexcept>
+#include <algorithm>
+
+BlockStorage::Data::Data(int bitsLog, unsigned int size)
+    : bitsLog(bitsLog), paletteSize(0), palette(),
+      words(bitsLog < 0 ? 0 : (size << bitsLog) / 64)
+{
+    palette.resize(capacity());
+}
+
+unsigned int BlockStorage::Data::bits() const {
+    return bitsLog < 0 ? 0 : 1u << bitsLog;
+}
+
+unsigned int BlockStorage::Data::capacity() const {
+    return 1u << bits();
+}
+
+// indices never straddle two words since the index width always divides 64
+unsigned int BlockStorage::Data::indexAt(unsigned int i) const {
+    if(bitsLog < 0) return 0;
+    unsigned int bit = i << bitsLog;
+    uint64_t w = words[bit >> 6].load(std::memory_order_acquire);
+    return (w >> (bit & 63)) & ((uint64_t(1) << bits()) - 1);
+}
+
+// single writer, so a plain read-modify-write is enough
+void BlockStorage::Data::storeIndex(unsigned int i, unsigned int p) {
+    unsigned int bit = i << bitsLog;
+    uint64_t mask = ((uint64_t(1) << bits()) - 1) << (bit & 63);
+    std::atomic<uint64_t> &word = words[bit >> 6];
+    uint64_t w = word.load(std::memory_order_relaxed);
+    word.store((w & ~mask) | (uint64_t(p) << (bit & 63)), std::memory_order_release);
+}
+
+BlockStorage::BlockStorage(unsigned int size, BlockType fill)
+    : m_size(size), m_data(new Data(-1, size)), m_retired(), m_retiredBytes(0)
+{
+    Data* d = m_data.load(std::memory_order_relaxed);
+    d->palette[0] = fill;
+    d->paletteSize.store(1, std::memory_order_relaxed);
+}
+
+BlockStorage::~BlockStorage() {
+    delete m_data.load(std::memory_order_relaxed);
+    for(Data* d: m_retired) {
+        delete d;
+    }
+}
+
+unsigned int BlockStorage::size() const {
+    return m_size;
+}
+
+BlockType BlockStorage::get(unsigned int i) const {
+    if(i >= m_size) throw std::out_of_range("block storage index out of range");
+    const Data* d = m_data.load(std::memory_order_acquire);
+    return d->palette[d->indexAt(i)];
+}
+
+void BlockStorage::set(unsigned int i, BlockType t) {
+    if(i >= m_size) throw std::out_of_range("block storage index out of range");
+    Data* d = m_data.load(std::memory_order_relaxed);
+
+    unsigned int n = d->paletteSize.load(std::memory_order_relaxed);
+    unsigned int p = 0;
+    while(p < n && d->palette[p] != t) p++;
+
+    if(p == n) {
+        //new type, make room in the palette first
+        if(n == d->capacity()) {
+            grow();
+            d = m_data.load(std::memory_order_relaxed);
+        }
+        d->palette[p] = t;
+        d->paletteSize.store(n + 1, std::memory_order_release);
+    }
+    if(d->bitsLog < 0) return;
+    d->storeIndex(i, p);
+}
+
+// doubles the index width, 0 -> 1 -> 2 -> 4 -> 8 bits
+void BlockStorage::grow() {
+    Data* old = m_data.load(std::memory_order_relaxed);
+    Data* d = new Data(old->bitsLog + 1, m_size);
+    unsigned int n = old->paletteSize.load(std::memory_order_relaxed);
+    std::copy_n(old->palette.begin(), n, d->palette.begin());
+    d->paletteSize.store(n, std::memory_order_relaxed);
+    if(old->bitsLog >= 0) {
+        for(unsigned int i = 0; i < m_size; i++) {
+            d->storeIndex(i, old->indexAt(i));
+        }
+    }
+    m_data.store(d, std::memory_order_release);
+    release(old);
+}
+
+void BlockStorage::release(Data* d) {
+    m_retired.push_back(d);
+    m_retiredBytes.fetch_add(sizeof(Data) + d->palette.size() + d->words.size() * sizeof(uint64_t), std::memory_order_relaxed);
+}
+
+bool BlockStorage::isUniform() const {
+    return m_data.load(std::memory_order_acquire)->bitsLog < 0;
+}
+
+unsigned int BlockStorage::paletteSize() const {
+    return m_data.load(std::memory_order_acquire)->paletteSize.load(std::memory_order_acquire);
+}
+
+unsigned int BlockStorage::bitsPerBlock() const {
+    return m_data.load(std::memory_order_acquire)->bits();
+}
+
+void BlockStorage::compact() {
+    Data* old = m_data.load(std::memory_order_relaxed);
+    if(old->bitsLog >= 0) {
+        unsigned int n = old->paletteSize.load(std::memory_order_relaxed);
+        std::array<bool, 256> used{};
+        for(unsigned int i = 0; i < m_size; i++) {
+            used[old->indexAt(i)] = true;
+        }
+        //old palette index -> new palette index
+        std::array<unsigned char, 256> remap{};
+        unsigned int m = 0;
+        for(unsigned int p = 0; p < n; p++) {
+            if(used[p]) remap[p] = m++;
+        }
+        if(m < n) {
+            int bitsLog = -1;
+            while((1u << (bitsLog < 0 ? 0 : 1u << bitsLog)) < m) bitsLog++;
+            Data* d = new Data(bitsLog, m_size);
+            for(unsigned int p = 0; p < n; p++) {
+                if(used[p]) d->palette[remap[p]] = old->palette[p];
+            }
+            d->paletteSize.store(m, std::memory_order_relaxed);
+            if(bitsLog >= 0) {
+                for(unsigned int i = 0; i < m_size; i++) {
+                    d->storeIndex(i, remap[old->indexAt(i)]);
+                }
+            }
+            m_data.store(d, std::memory_order_release);
+            delete old;
+        }
+    }
+    for(Data* d: m_retired) {
+        delete d;
+    }
+    m_retired.clear();
+    m_retired.shrink_to_fit();
+    m_retiredBytes.store(0, std::memory_order_relaxed);
+}
+
+size_t BlockStorage::memoryUsage() const {
+    size_t bytes = sizeof(BlockStorage);
+    const Data* d = m_data.load(std::memory_order_acquire);
+    bytes += sizeof(Data) + d->palette.size() + d->words.size() * sizeof(uint64_t);
+    return bytes + m_retiredBytes.load(std::memory_order_relaxed);
+}
+
+void BlockStorage::serialize(QByteArray &out) const {
+    const Data* d = m_data.load(std::memory_order_acquire);
+    unsigned int n = d->paletteSize.load(std::memory_order_acquire);
+    out.append(char(d->bitsLog + 1));
+    out.append(char(n - 1));
+    out.append(reinterpret_cast<const char*>(d->palette.data()), n);
+    for(const std::atomic<uint64_t> &word: d->words) {
+        uint64_t w = word.load(std::memory_order_acquire);
+        out.append(reinterpret_cast<const char*>(&w), sizeof(uint64_t));
+    }
+}
+
+bool BlockStorage::deserialize(const char *&data, const char *end) {
+    if(end - data < 2) return false;
+    int bitsLog = static_cast<unsigned char>(data[0]) - 1;
+    unsigned int n = static_cast<unsigned char>(data[1]) + 1;
+    if(bitsLog > 3) return false;
+    Data* d = new Data(bitsLog, m_size);
+    if(n > d->capacity() || end - data < long(2 + n + d->words.size() * sizeof(uint64_t))) {
+        delete d;
+        return false;
+    }
+    data += 2;
+    std::copy_n(reinterpret_cast<const BlockType*>(data), n, d->palette.begin());
+    d->paletteSize.store(n, std::memory_order_relaxed);
+    data += n;
+    for(std::atomic<uint64_t> &word: d->words) {
+        uint64_t w;
+        std::copy_n(data, sizeof(uint64_t), reinterpret_cast<char*>(&w));
+        word.store(w, std::memory_order_relaxed);
+        data += sizeof(uint64_t);
+    }
+    delete m_data.exchange(d, std::memory_order_acq_rel);
+    return true;
+}
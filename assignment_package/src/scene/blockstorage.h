@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <QByteArray>
+
+// defined in chunk.h
+enum BlockType : unsigned char;
+
+// Palette compressed block storage.
+// Instead of one byte per block, each block stores an index into a small palette
+// of the block types present, packed 1, 2, 4 or 8 bits at a time into 64-bit words.
+// A storage holding only a single block type keeps no index data at all.
+//
+// Reads are lock free so meshing threads can read while a generation thread writes.
+// Writes must be serialized by the owner (Chunk does this with its setBlock mutex).
+class BlockStorage {
+private:
+    struct Data {
+        // log2 of bits per index, or -1 if every block is palette[0]
+        int bitsLog;
+        // number of palette entries in use
+        std::atomic<unsigned int> paletteSize;
+        std::vector<BlockType> palette;
+        std::vector<std::atomic<uint64_t>> words;
+
+        Data(int bitsLog, unsigned int size);
+        unsigned int bits() const;
+        unsigned int capacity() const;
+        unsigned int indexAt(unsigned int i) const;
+        void storeIndex(unsigned int i, unsigned int p);
+    };
+
+    unsigned int m_size;
+    std::atomic<Data*> m_data;
+
+    // grown-out buffers, readers may still hold these so they live until compact() or destruction
+    std::vector<Data*> m_retired;
+    std::atomic<size_t> m_retiredBytes;
+
+    void grow();
+    void release(Data* d);
+public:
+    BlockStorage(unsigned int size, BlockType fill);
+    ~BlockStorage();
+    BlockStorage(const BlockStorage&) = delete;
+    BlockStorage& operator=(const BlockStorage&) = delete;
+
+    unsigned int size() const;
+
+    // Throws std::out_of_range like std::array::at
+    BlockType get(unsigned int i) const;
+    void set(unsigned int i, BlockType t);
+
+    // true if every block is the same type, ie no index data is stored
+    bool isUniform() const;
+    unsigned int paletteSize() const;
+    unsigned int bitsPerBlock() const;
+
+    // Rebuilds the palette with only the types still in use, shrinks the index width
+    // to match and frees retired buffers. Only call when no other thread is reading.
+    void compact();
+
+    // heap + inline bytes used by this storage
+    size_t memoryUsage() const;
+
+    // appends the palette and packed indices to out
+    void serialize(QByteArray &out) const;
+    // reads back what serialize wrote and advances data past it, returns false on malformed input.
+    // Only call when no other thread is reading.
+    bool deserialize(const char *&data, const char *end);
+};
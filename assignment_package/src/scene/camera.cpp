@@ -7,7 +7,7 @@ Camera::Camera(glm::vec3 pos)
 
 Camera::Camera(unsigned int w, unsigned int h, glm::vec3 pos)
     : Entity(pos), m_fovy(45), m_width(w), m_height(h),
-      m_near_clip(0.1f), m_far_clip(1000.f), m_aspect(w / static_cast<float>(h))
+      m_near_clip(0.1f), m_far_clip(2200.f), m_aspect(w / static_cast<float>(h))
 {}
 
 Camera::Camera(const Camera &c)
@@ -36,6 +36,29 @@ glm::mat4 Camera::getViewProj() const {
     return glm::perspective(glm::radians(m_fovy), m_aspect, m_near_clip, m_far_clip) * glm::lookAt(m_position, m_position + m_forward, m_up);
 }
 
+Frustum Camera::getFrustum() const {
+    return Frustum(getViewProj());
+}
+
+Frustum::Frustum(const glm::mat4 &viewProj) {
+    //clip space is -w <= x, y, z <= w, each side of that is a plane in world space.
+    //glm is column major, so row i is viewProj[*][i]
+    glm::mat4 t = glm::transpose(viewProj);
+    for(int i = 0; i < 3; i++) {
+        planes[2 * i] = t[3] + t[i];
+        planes[2 * i + 1] = t[3] - t[i];
+    }
+}
+
+bool Frustum::intersects(glm::vec3 min, glm::vec3 max) const {
+    for(const glm::vec4 &p: planes) {
+        //the corner furthest along the plane's normal
+        glm::vec3 far(p.x >= 0 ? max.x : min.x, p.y >= 0 ? max.y : min.y, p.z >= 0 ? max.z : min.z);
+        if(glm::dot(glm::vec3(p), far) + p.w < 0) return false;
+    }
+    return true;
+}
+
 void Camera::setPos(glm::vec3 p) {
     m_position = p;
 }
@@ -2,6 +2,16 @@
 #include "glm_includes.h"
 #include "scene/entity.h"
 
+// The six clip planes of a view projection matrix, for skipping boxes that
+// can't be on screen
+struct Frustum {
+    glm::vec4 planes[6]; //xyz point inside, w the offset, not normalized
+
+    Frustum(const glm::mat4 &viewProj);
+    // false only if the world space box is entirely outside one plane
+    bool intersects(glm::vec3 min, glm::vec3 max) const;
+};
+
 //A perspective projection camera
 //Receives its eye position and reference point from the scene XML file
 class Camera : public Entity {
@@ -21,5 +31,6 @@ public:
     void tick(float dT, InputBundle &input) override;
 
     glm::mat4 getViewProj() const;
+    Frustum getFrustum() const;
     void setPos(glm::vec3);
 };
@@ -1,15 +1,16 @@
 #include "chunk.h"
+#include "chunkarena.h"
 #include <QDebug>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <climits>
 
 void printVec(glm::vec4 a) {
     qDebug() << a[0] << a[1] << a[2] << a[3];
 }
 
-bool checkTransparent(BlockType bt) {
-    return bt == EMPTY || bt == WATER || bt ==  GLASS || bt == ICE || bt ==  OAK_LEAVES;
-}
-
 bool isTransparent(int x, int y, int z, Chunk* c) {
     BlockType bt = c->getBlockAt(x, y, z);
     return checkTransparent(bt);
@@ -60,255 +61,61 @@ Direction vecToDir(glm::vec3 v) {
 }
 
 std::vector<glm::vec4> getBlockUV(BlockType type, int Face) {
-    std::vector<glm::vec4> UVs = {glm::vec4(), glm::vec4(), glm::vec4(), glm::vec4()};
-    switch(type){
-        case GRASS_BLOCK:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(25.f/64.f + 1.f/1024, 63.f/64.f + 1.f/1024, 0.f, 0.f),
-                UVs[1] = glm::vec4(26.f/64.f - 1.f/1024, 63.f/64.f + 1.f/1024, 0.f, 0.f),
-                UVs[2] = glm::vec4(26.f/64.f - 1.f/1024, 64.f/64.f - 1.f/1024, 0.f, 0.f),
-                UVs[3] = glm::vec4(25.f/64.f + 1.f/1024, 64.f/64.f - 1.f/1024, 0.f, 0.f);
-
-            } else { //top & bottom
-                UVs[0] = glm::vec4(497.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(511.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(511.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(497.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        case DIRT:
-            UVs[0] = glm::vec4(337.f/1024.f, 850.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(350.f/1024.f, 850.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(350.f/1024.f, 863.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(337.f/1024.f, 863.f/1024.f, 0.f, 0.f);
-            break;
-        case STONE:
-            UVs[0] = glm::vec4(507.f/1024.f, 642.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(510.f/1024.f, 642.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(510.f/1024.f, 655.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(507.f/1024.f, 655.f/1024.f, 0.f, 0.f);
-            break;
-        case WATER:
-            UVs[0] = glm::vec4(129.f/1024.f, 930.f/1024.f, 1.f, 0.f);
-            UVs[1] = glm::vec4(142.f/1024.f, 930.f/1024.f, 1.f, 0.f);
-            UVs[2] = glm::vec4(142.f/1024.f, 944.f/1024.f, 1.f, 0.f);
-            UVs[3] = glm::vec4(129.f/1024.f, 944.f/1024.f, 1.f, 0.f);
-            break;
-        case SAND:
-            UVs[0] = glm::vec4(129.f/1024.f, 658.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(142.f/1024.f, 658.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(142.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(129.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-            break;
-        case SNOW:
-            UVs[0] = glm::vec4(480.f/1024.f, 705.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(494.f/1024.f, 705.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(494.f/1024.f, 720.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(480.f/1024.f, 720.f/1024.f, 0.f, 0.f);
-            break;
-        case GLASS:
-            UVs[0] = glm::vec4(384.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(399.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(399.f/1024.f, 896.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(384.f/1024.f, 896.f/1024.f, 0.f, 0.f);
-            break;
-        case COBBLESTONE:
-            UVs[0] = glm::vec4(32.f/1024.f, 770.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(47.f/1024.f, 770.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(47.f/1024.f, 784.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(32.f/1024.f, 784.f/1024.f, 0.f, 0.f);
-            break;
-        case OAK_PLANKS:
-            UVs[0] = glm::vec4(384.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(398.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(398.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(384.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-            break;
-          case SPRUCE_PLANKS:
-              UVs[0] = glm::vec4(448.f/1024.f, 641.f/1024.f, 0.f, 0.f);
-              UVs[1] = glm::vec4(462.f/1024.f, 641.f/1024.f, 0.f, 0.f);
-              UVs[2] = glm::vec4(462.f/1024.f, 656.f/1024.f, 0.f, 0.f);
-              UVs[3] = glm::vec4(448.f/1024.f, 656.f/1024.f, 0.f, 0.f);
-              break;
-        case JUNGLE_PLANKS:
-            UVs[0] = glm::vec4(448.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(462.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(462.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(448.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-            break;
-        case BIRCH_PLANKS:
-            UVs[0] = glm::vec4(256.f/1024.f, 929.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(270.f/1024.f, 929.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(270.f/1024.f, 944.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(256.f/1024.f, 944.f/1024.f, 0.f, 0.f);
-            break;
-        case ACACIA_PLANKS:
-            UVs[0] = glm::vec4(175.f/1024.f, 929.f/1024.f, 0.f, 1.f);
-            UVs[1] = glm::vec4(190.f/1024.f, 929.f/1024.f, 0.f, 1.f);
-            UVs[2] = glm::vec4(190.f/1024.f, 944.f/1024.f, 0.f, 1.f);
-            UVs[3] = glm::vec4(175.f/1024.f, 944.f/1024.f, 0.f, 1.f);
-            break;
-        case OAK_LOG:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(352.f/1024.f, 738.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(367.f/1024.f, 738.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(367.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(352.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-            } else { //top and bottom
-                UVs[0] = glm::vec4(369.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(383.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(383.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(369.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        case SPRUCE_LOG:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(416.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(431.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(431.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(416.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-            } else { //top and bottom
-                UVs[0] = glm::vec4(432.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(447.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(447.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(432.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-            }
-            break;
-        case BIRCH_LOG:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(256.f/1024.f, 961.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(270.f/1024.f, 961.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(270.f/1024.f, 976.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(256.f/1024.f, 976.f/1024.f, 0.f, 1.f);
-            } else { //top and bottom
-                UVs[0] = glm::vec4(256.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(270.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(270.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(256.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-            }
-            break;
-        case JUNGLE_LOG:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(448.f/1024.f, 881.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(463.f/1024.f, 881.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(463.f/1024.f, 896.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(448.f/1024.f, 896.f/1024.f, 0.f, 1.f);
-            } else { //top and bottom
-                UVs[0] = glm::vec4(448.f/1024.f, 865.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(463.f/1024.f, 865.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(463.f/1024.f, 880.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(448.f/1024.f, 880.f/1024.f, 0.f, 1.f);
-            }
-            break;
-        case ACACIA_LOG:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(160.f/1024.f, 897.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(174.f/1024.f, 897.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(174.f/1024.f, 912.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(160.f/1024.f, 912.f/1024.f, 0.f, 1.f);
-            } else { //top and bottom
-                UVs[0] = glm::vec4(176.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                UVs[1] = glm::vec4(191.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                UVs[2] = glm::vec4(191.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                UVs[3] = glm::vec4(176.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-            }
-            break;
-        case OAK_LEAVES:
-            UVs[0] = glm::vec4(192.f/1024.f, 1009.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(207.f/1024.f, 1009.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(207.f/1024.f, 1024.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(192.f/1024.f, 1024.f/1024.f, 0.f, 0.f);
-            break;
-        case PATH:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(337.f/1024.f, 833.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(350.f/1024.f, 833.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(350.f/1024.f, 847.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(337.f/1024.f, 847.f/1024.f, 0.f, 0.f);
-            } else {
-                UVs[0] = glm::vec4(337.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(350.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(350.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(337.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        case BOOKSHELF:
-            if (Face != 2 && Face != 3) {
-                UVs[0] = glm::vec4(192.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(207.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(207.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(192.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-            } else {
-                UVs[0] = glm::vec4(384.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(398.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(398.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(384.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        case LAVA:
-            UVs[0] = glm::vec4(129.f/1024.f, 962.f/1024.f, 1.f, 0.f);
-            UVs[1] = glm::vec4(141.f/1024.f, 962.f/1024.f, 1.f, 0.f);
-            UVs[2] = glm::vec4(141.f/1024.f, 976.f/1024.f, 1.f, 0.f);
-            UVs[3] = glm::vec4(129.f/1024.f, 976.f/1024.f, 1.f, 0.f);
-            break;
-        case SANDSTONE:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(144.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(158.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(158.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(144.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-            } else { //top & bottom
-                UVs[0] = glm::vec4(160.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(174.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(174.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(160.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        case BEDROCK:
-            UVs[0] = glm::vec4(208.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(222.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(222.f/1024.f, 895.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(208.f/1024.f, 895.f/1024.f, 0.f, 0.f);
-            break;
-        case ICE:
-            UVs[0] = glm::vec4(224.f/1024.f, 722.f/1024.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(238.f/1024.f, 722.f/1024.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(238.f/1024.f, 735.f/1024.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(224.f/1024.f, 735.f/1024.f, 0.f, 0.f);
-            break;
-        case CACTUS:
-            if (Face != 2 && Face != 3) { //side
-                UVs[0] = glm::vec4(32.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(47.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(47.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(32.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-            } else { //top & bottom
-                UVs[0] = glm::vec4(48.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                UVs[1] = glm::vec4(63.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                UVs[2] = glm::vec4(63.f/1024.f, 832.f/1024.f, 0.f, 0.f);
-                UVs[3] = glm::vec4(48.f/1024.f, 832.f/1024.f, 0.f, 0.f);
-            }
-            break;
-        default:
-            UVs[0] = glm::vec4(32.f/64.f, 63.f/64.f, 0.f, 0.f);
-            UVs[1] = glm::vec4(33.f/64.f, 63.f/64.f, 0.f, 0.f);
-            UVs[2] = glm::vec4(33.f/64.f, 64.f/64.f, 0.f, 0.f);
-            UVs[3] = glm::vec4(32.f/64.f, 64.f/64.f, 0.f, 0.f);
-            break;
+    const BlockInfo &info = blockInfo(type);
+    const AtlasRect &r = Face != 2 && Face != 3 ? info.side : info.top;
+    float anim = info.animated;
+    return {glm::vec4(r.x0/1024.f, r.y0/1024.f, anim, 0.f),
+            glm::vec4(r.x1/1024.f, r.y0/1024.f, anim, 0.f),
+            glm::vec4(r.x1/1024.f, r.y1/1024.f, anim, 0.f),
+            glm::vec4(r.x0/1024.f, r.y1/1024.f, anim, 0.f)};
+}
+
+std::vector<glm::vec4> blockTiles() {
+    std::vector<glm::vec4> tiles;
+    for(const BlockInfo &info: BLOCK_INFO) {
+        for(const AtlasRect &r: {info.side, info.top}) {
+            tiles.push_back(glm::vec4(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0) / 1024.f);
+        }
+    }
+    return tiles;
+}
+
+ChunkSection::ChunkSection() : blocks(4096, EMPTY), nonEmpty(0), opaque(0), version(0)
+{}
+
+bool ChunkSection::allAir() const {
+    return nonEmpty == 0;
+}
+
+bool ChunkSection::allOpaque() const {
+    return opaque == 4096;
+}
+
+void ChunkSection::recount() {
+    int e = 0, o = 0;
+    for(unsigned int i = 0; i < 4096; i++) {
+        BlockType t = blocks.get(i);
+        if(t != EMPTY) e++;
+        if(!checkTransparent(t)) o++;
     }
-    return UVs;
+    nonEmpty = e;
+    opaque = o;
 }
 
-Chunk::Chunk(OpenGLContext* mp_context) : Drawable(mp_context), m_blocks(),
-    dataBound(false), dataGen(false), surfaceGen(false), hasTransparent(false)
+Chunk::Chunk(OpenGLContext* mp_context) : Drawable(mp_context), m_sections(),
+    m_meshes(), m_meshed(false), m_meshedNeighbors(0), m_slots(), m_slotSizes(), m_freedSlots(0), m_arenaVerts{0, 0},
+    m_lodMesh(), m_lodMeshOpaque(0), m_lodMeshLevel(0), m_lodMeshVersion(0), m_lodArena{0, 0}, m_lodOpaque(0), m_lodLevel(0), m_lodVersion(0), m_visibility(),
+    vertexCount(0), meshSections(0), gpuBytes(0), dataBound(false), dataGen(false), surfaceGen(false), hasTransparent(false),
+    unsaved(true), jobs(0), evicted(false), lastUsed(0), origin(0, 0), uploadQueued(false), lastDrawn(0), lod(0), dirtySections(0)
 {
-    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+    for(std::atomic<uint64_t> &v: m_visibility) v = VISIBLE_ALL;
 }
 
-// Does bounds checking with at()
+// Does bounds checking, throws std::out_of_range
 BlockType Chunk::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
     if(y > 500 && y < 1500) y+= heightMap[x][z]-1000;
-    return m_blocks.at(x + 16 * y + 16 * 256 * z);
+    if(x >= 16 || y >= 256 || z >= 16) throw std::out_of_range("chunk get block received faulty values");
+    return m_sections[y >> 4].blocks.get(x + 16 * (y & 15) + 16 * 16 * z);
 }
 
 // Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
@@ -317,23 +124,269 @@ BlockType Chunk::getBlockAt(int x, int y, int z) const {
     return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
 }
 
-// Does bounds checking with at()
+BlockType Chunk::getLocalBlock(int x, int y, int z) const {
+    return m_sections[y >> 4].blocks.get(x + 16 * (y & 15) + 16 * 16 * z);
+}
+
+// Does bounds checking
 void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
     try{
         setBlock_mutex.lock();
         //if y is in this range, means that we want to take a delta of height map instead
         if(y > 500 && y < 1500) y += heightMap[x][z]-1000;
-        m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+        if(x >= 16 || y >= 256 || z >= 16) throw std::out_of_range("");
+        ChunkSection &sec = m_sections[y >> 4];
+        unsigned int i = x + 16 * (y & 15) + 16 * 16 * z;
+        BlockType old = sec.blocks.get(i);
+        if(old != t) {
+            sec.blocks.set(i, t);
+            sec.nonEmpty += (t != EMPTY) - (old != EMPTY);
+            sec.opaque += !checkTransparent(t) - !checkTransparent(old);
+            sec.version++;
+            unsaved = true;
+        }
         setBlock_mutex.unlock();
 
         blocksChanged = true;
     }
     catch(...){
+        setBlock_mutex.unlock();
         qDebug() << x << y << z;
         throw std::invalid_argument( "chunk set block received faulty values" );
     }
 }
 
+void Chunk::fillColumn(int x, int z, int yFrom, int yTo, BlockType t) {
+    if(x < 0 || x >= 16 || z < 0 || z >= 16) throw std::out_of_range("chunk fill column received faulty values");
+    yFrom = std::max(yFrom, 0);
+    yTo = std::min(yTo, 256);
+    if(yFrom >= yTo) return;
+    bool changed = false;
+    setBlock_mutex.lock();
+    //section counts are atomics, so add up each section's change before touching them
+    for(int y = yFrom; y < yTo;) {
+        ChunkSection &sec = m_sections[y >> 4];
+        int end = std::min(yTo, (y & ~15) + 16);
+        int e = 0, o = 0;
+        bool secChanged = false;
+        for(; y < end; y++) {
+            unsigned int i = x + 16 * (y & 15) + 16 * 16 * z;
+            BlockType old = sec.blocks.get(i);
+            if(old == t) continue;
+            sec.blocks.set(i, t);
+            secChanged = true;
+            e += (t != EMPTY) - (old != EMPTY);
+            o += !checkTransparent(t) - !checkTransparent(old);
+        }
+        if(e) sec.nonEmpty += e;
+        if(o) sec.opaque += o;
+        if(secChanged) sec.version++;
+        changed |= secChanged;
+    }
+    setBlock_mutex.unlock();
+    if(changed) unsaved = true;
+    blocksChanged = true;
+}
+
+void Chunk::writeColumn(int x, int z, int yFrom, const BlockType* types, int n) {
+    if(x < 0 || x >= 16 || z < 0 || z >= 16) throw std::out_of_range("chunk write column received faulty values");
+    int yTo = std::min(yFrom + n, 256);
+    if(yFrom < 0) {
+        types -= yFrom;
+        yFrom = 0;
+    }
+    if(yFrom >= yTo) return;
+    bool changed = false;
+    setBlock_mutex.lock();
+    for(int y = yFrom; y < yTo;) {
+        ChunkSection &sec = m_sections[y >> 4];
+        int end = std::min(yTo, (y & ~15) + 16);
+        int e = 0, o = 0;
+        bool secChanged = false;
+        for(; y < end; y++) {
+            unsigned int i = x + 16 * (y & 15) + 16 * 16 * z;
+            BlockType t = types[y - yFrom];
+            BlockType old = sec.blocks.get(i);
+            if(old == t) continue;
+            sec.blocks.set(i, t);
+            secChanged = true;
+            e += (t != EMPTY) - (old != EMPTY);
+            o += !checkTransparent(t) - !checkTransparent(old);
+        }
+        if(e) sec.nonEmpty += e;
+        if(o) sec.opaque += o;
+        if(secChanged) sec.version++;
+        changed |= secChanged;
+    }
+    setBlock_mutex.unlock();
+    if(changed) unsaved = true;
+    blocksChanged = true;
+}
+
+void Chunk::compactBlocks() {
+    setBlock_mutex.lock();
+    for(ChunkSection &sec: m_sections) {
+        sec.blocks.compact();
+    }
+    setBlock_mutex.unlock();
+}
+
+size_t Chunk::memoryUsage() const {
+    size_t bytes = 0;
+    for(const ChunkSection &sec: m_sections) {
+        bytes += sec.blocks.memoryUsage() + sizeof(ChunkSection) - sizeof(BlockStorage);
+    }
+    return bytes;
+}
+
+size_t Chunk::meshMemory() {
+    size_t bytes = 0;
+    createVBO_mutex.lock();
+    for(const SectionMesh &m: m_meshes) {
+        bytes += (m.verts.capacity() + m.clearVerts.capacity()) * sizeof(PackedVertex);
+    }
+    createVBO_mutex.unlock();
+    return bytes;
+}
+
+size_t Chunk::residentMemory() {
+    size_t bytes = sizeof(Chunk) + memoryUsage() + meshMemory();
+    setBlock_mutex.lock();
+    bytes += m_changes.size() * (sizeof(glm::ivec3) + sizeof(BlockType) + 2 * sizeof(void*));
+    setBlock_mutex.unlock();
+    return bytes;
+}
+
+void Chunk::recordChange(int x, int y, int z, BlockType t) {
+    setBlock_mutex.lock();
+    m_changes[glm::ivec3(x, y, z)] = t;
+    setBlock_mutex.unlock();
+    unsaved = true;
+}
+
+bool Chunk::hasChange(int x, int y, int z) const {
+    setBlock_mutex.lock();
+    bool has = m_changes.find(glm::ivec3(x, y, z)) != m_changes.end();
+    setBlock_mutex.unlock();
+    return has;
+}
+
+vec3Map Chunk::changes() const {
+    setBlock_mutex.lock();
+    vec3Map copy = m_changes;
+    setBlock_mutex.unlock();
+    return copy;
+}
+
+//jobs while Terrain::evictChunks has the chunk, no job can start after that
+#define JOBS_EVICTING INT_MIN
+
+// only refused once eviction has claimed the chunk, an eviction that backs off
+// for a running job never turns a job away
+bool Chunk::beginJob() {
+    int n = jobs;
+    while(n != JOBS_EVICTING) {
+        if(jobs.compare_exchange_weak(n, n + 1)) return true;
+    }
+    return false;
+}
+
+void Chunk::endJob() {
+    jobs--;
+}
+
+bool Chunk::claimEviction() {
+    int idle = 0;
+    return jobs.compare_exchange_strong(idle, JOBS_EVICTING);
+}
+
+bool Chunk::sectionAir(int s) const {
+    return m_sections[s].allAir();
+}
+
+bool Chunk::sectionOpaque(int s) const {
+    return m_sections[s].allOpaque();
+}
+
+//2 added the chunk's origin, so a payload read from the wrong place is caught
+#define CHUNK_FORMAT 2
+
+void Chunk::serialize(QByteArray &out) const {
+    //the blocks and changes as of one moment, edits wait until we're done
+    std::lock_guard<std::mutex> lock(setBlock_mutex);
+    out.append(char(CHUNK_FORMAT));
+    out.append(char(biome));
+    int32_t at[2] = {origin.x, origin.y};
+    out.append(reinterpret_cast<const char*>(at), sizeof(at));
+    for(int x = 0; x < 16; x++) {
+        for(int z = 0; z < 16; z++) {
+            int16_t h = heightMap[x][z];
+            out.append(reinterpret_cast<const char*>(&h), sizeof(int16_t));
+        }
+    }
+    //air sections only take up a bit in the mask
+    uint16_t mask = 0;
+    for(int s = 0; s < 16; s++) {
+        if(!m_sections[s].allAir()) mask |= 1 << s;
+    }
+    out.append(reinterpret_cast<const char*>(&mask), sizeof(uint16_t));
+    for(int s = 0; s < 16; s++) {
+        if(mask & (1 << s)) m_sections[s].blocks.serialize(out);
+    }
+    uint32_t n = m_changes.size();
+    out.append(reinterpret_cast<const char*>(&n), sizeof(uint32_t));
+    for(const auto &kv: m_changes) {
+        out.append(char(kv.first.x));
+        out.append(char(kv.first.y));
+        out.append(char(kv.first.z));
+        out.append(char(kv.second));
+    }
+}
+
+bool Chunk::deserialize(const QByteArray &in) {
+    const char *data = in.constData();
+    const char *end = data + in.size();
+    if(end - data < 2 || (data[0] != CHUNK_FORMAT && data[0] != 1)) return false;
+    int format = data[0];
+    biome = BiomeType(static_cast<unsigned char>(data[1]));
+    data += 2;
+    if(format >= 2) {
+        int32_t at[2];
+        if(end - data < long(sizeof(at))) return false;
+        std::copy_n(data, sizeof(at), reinterpret_cast<char*>(at));
+        data += sizeof(at);
+        if(at[0] != origin.x || at[1] != origin.y) return false;
+    }
+    if(end - data < long(256 * sizeof(int16_t) + sizeof(uint16_t))) return false;
+    for(int x = 0; x < 16; x++) {
+        for(int z = 0; z < 16; z++) {
+            int16_t h;
+            std::copy_n(data, sizeof(int16_t), reinterpret_cast<char*>(&h));
+            heightMap[x][z] = h;
+            data += sizeof(int16_t);
+        }
+    }
+    uint16_t mask;
+    std::copy_n(data, sizeof(uint16_t), reinterpret_cast<char*>(&mask));
+    data += sizeof(uint16_t);
+    for(int s = 0; s < 16; s++) {
+        if(mask & (1 << s)) {
+            if(!m_sections[s].blocks.deserialize(data, end)) return false;
+            m_sections[s].recount();
+        }
+    }
+    if(end - data < long(sizeof(uint32_t))) return false;
+    uint32_t n;
+    std::copy_n(data, sizeof(uint32_t), reinterpret_cast<char*>(&n));
+    data += sizeof(uint32_t);
+    if(end - data < long(4 * n)) return false;
+    for(uint32_t i = 0; i < n; i++, data += 4) {
+        m_changes[glm::ivec3(static_cast<unsigned char>(data[0]), static_cast<unsigned char>(data[1]),
+                             static_cast<unsigned char>(data[2]))] = BlockType(static_cast<unsigned char>(data[3]));
+    }
+    unsaved = false;
+    return true;
+}
 
 const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection {
     {XPOS, XNEG},
@@ -344,14 +397,38 @@ const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirectio
     {ZNEG, ZPOS}
 };
 
-void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
+void Chunk::linkNeighbor(Chunk* neighbor, Direction dir) {
     if(neighbor != nullptr) {
         this->neighbor_mutex.lock();
-        this->m_neighbors[dir] = neighbor.get();
+        this->m_neighbors[dir] = neighbor;
         this->neighbor_mutex.unlock();
         neighbor->neighbor_mutex.lock();
-        neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
+        bool gone = neighbor->evicted;
+        if(!gone) neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
         neighbor->neighbor_mutex.unlock();
+        //neighbor got evicted before it could see us, so it won't unlink us either
+        if(gone) {
+            this->neighbor_mutex.lock();
+            if(this->m_neighbors[dir] == neighbor) this->m_neighbors.erase(dir);
+            this->neighbor_mutex.unlock();
+        }
+    }
+}
+
+void Chunk::unlinkNeighbors() {
+    neighbor_mutex.lock();
+    evicted = true;
+    std::unordered_map<Direction, Chunk*, EnumHash> neighbors;
+    neighbors.swap(m_neighbors);
+    neighbor_mutex.unlock();
+    for(auto &kv: neighbors) {
+        Chunk* n = kv.second;
+        if(n == nullptr) continue;
+        Direction opp = oppositeDirection.at(kv.first);
+        n->neighbor_mutex.lock();
+        auto it = n->m_neighbors.find(opp);
+        if(it != n->m_neighbors.end() && it->second == this) n->m_neighbors.erase(it);
+        n->neighbor_mutex.unlock();
     }
 }
 
@@ -387,472 +464,811 @@ const int UVorder[6][4] = {
     {1, 0, 3, 2},
     {0, 1, 2, 3}
 };
-void Chunk::createVBOdata() {
-    createVBO_mutex.lock();
-    std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors_copy;
-    neighbor_mutex.lock();
-    m_neighbors_copy.insert(m_neighbors.begin(), m_neighbors.end());
-    neighbor_mutex.unlock();
+PackedVertex packVertex(glm::ivec3 p, int normal, bool animated, int u, int v, int tile) {
+    PackedVertex pv;
+    pv.pos = p.x | p.y << 5 | p.z << 14 | normal << 19 | animated << 22;
+    pv.tex = u | v << 5 | tile << 10;
+    return pv;
+}
+
+static void tileAxes(int Face, int *out_u, int *out_v);
+
+// pushes the 4 vertices of a face of type in direction l (an index into delta) whose
+// corner nearest the origin is faceref, stretched over extent blocks along the two
+// in-plane axes. flip faces it the other way. Texture coordinates count blocks,
+// the shader repeats the tile once per block
+static void pushFace(std::vector<PackedVertex> &layer, glm::ivec3 faceref, int l, BlockType type, bool flip, glm::ivec3 extent) {
+    int Face = l/3; //0, 1, 4, 5 for side, 2 for top & 3 bottom
+    int tile = 2 * type + (Face == 2 || Face == 3);
+    //normals are a Direction, which is laid out like delta
+    int normal = flip ? Face ^ 1 : Face;
+    int uAxis, vAxis;
+    tileAxes(Face, &uAxis, &vAxis);
+    bool animated = blockInfo(type).animated;
+    for(int foo = 0; foo < 4; foo++) {
+        const int *fd = &facedeltas[(l/6)*12 + foo*3];
+        glm::ivec3 p = faceref + glm::ivec3(fd[0], fd[1], fd[2]) * extent;
+        int c = UVorder[Face][foo];
+        layer.push_back(packVertex(p, normal, animated, (c == 1 || c == 2) * extent[uAxis], (c == 2 || c == 3) * extent[vAxis], tile));
+    }
+}
 
-    std::vector<glm::vec4> VBOpos;
-    std::vector<glm::vec4> VBOnor;
-    std::vector<glm::vec4> VBOuv;
+// which of the two in-plane axes the tile's u and v run along, per face direction
+static void tileAxes(int Face, int *out_u, int *out_v) {
+    int axis = Face / 2;
+    int a1 = axis == 0 ? 1 : 0, a2 = axis == 2 ? 1 : 2;
+    //u follows whichever axis the corners' u coordinate tracks (possibly mirrored)
+    bool a1u = true;
+    for(int foo = 0; foo < 4; foo++) {
+        int c = UVorder[Face][foo];
+        int cu = c == 1 || c == 2;
+        int cu0 = UVorder[Face][0] == 1 || UVorder[Face][0] == 2;
+        int f1 = facedeltas[axis*12 + foo*3 + a1], f10 = facedeltas[axis*12 + a1];
+        if((cu != cu0) != (f1 != f10)) a1u = false;
+    }
+    *out_u = a1u ? a1 : a2;
+    *out_v = a1u ? a2 : a1;
+}
 
-    std::vector<glm::vec4> VBOClearpos;
-    std::vector<glm::vec4> VBOClearnor;
-    std::vector<glm::vec4> VBOClearuv;
-    std::vector<int> Clearidx;
+std::atomic_bool Chunk::greedyMeshing(false);
+std::atomic<long long> Chunk::meshNanos(0);
+std::atomic_int Chunk::meshCount(0);
+std::atomic<long long> Chunk::meshAllocations(0);
 
-    VBOinter.clear();
-    idx.clear();
+SectionMesh::SectionMesh() : verts(), clearVerts(), version(-1), visibility(VISIBLE_ALL)
+{}
 
-    for(int i = 0; i < 16; i++) {
-        for(int j = 0; j < 256; j++) {
-            for(int k = 0; k < 16; k++) {
-                //check in all 6 directions
-                int Face = 0; //0, 1, 4, 5 for side, 2 for top & 3 bottom
-                glm::vec4 UVs[4];
-                for(int l = 0; l < 6*3; l+=3) {
-                    //bound checking and neighbor
-                    BlockType curr = getBlockAt(i, j, k);
-                    BlockType oth = EMPTY;
-                    bool drawFace = false;
-                    if(i+delta[l] < 0){
-                        if (!checkTransparent(curr)) {
-                            drawFace = m_neighbors_copy.find(XNEG) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = checkTransparent(m_neighbors_copy[XNEG]->getBlockAt(15, j, k));
-                        }
-                        else {
-                            drawFace = m_neighbors_copy.find(XNEG) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = m_neighbors_copy[XNEG]->getBlockAt(15, j, k) != curr;
-                            if (m_neighbors_copy.find(XNEG) != m_neighbors_copy.end())
-                                oth = m_neighbors_copy[XNEG]->getBlockAt(15, j, k);
-                        }
-                    }
-                    else if(i+delta[l] > 15){
-                        if (!checkTransparent(curr)) {
-                            drawFace = m_neighbors_copy.find(XPOS) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = checkTransparent(m_neighbors_copy[XPOS]->getBlockAt(0, j, k));
-                        }
-                        else {
-                            drawFace = m_neighbors_copy.find(XPOS) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = m_neighbors_copy[XPOS]->getBlockAt(0, j, k) != curr;
-                            if (m_neighbors_copy.find(XPOS) != m_neighbors_copy.end())
-                                oth = m_neighbors_copy[XPOS]->getBlockAt(0, j, k);
-                        }
-                    }
-                    else if(j+delta[l+1] < 0 || j+delta[l+1] > 255){
-                        if (curr != EMPTY) drawFace = true;
-                    }
-                    else if(k+delta[l+2] < 0){
-                        if (!checkTransparent(curr)) {
-                            drawFace = m_neighbors_copy.find(ZNEG) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = checkTransparent(m_neighbors_copy[ZNEG]->getBlockAt(i, j, 15));
-                        }
-                        else {
-                            drawFace = m_neighbors_copy.find(ZNEG) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = m_neighbors_copy[ZNEG]->getBlockAt(i, j, 15) != curr;
-                            if (m_neighbors_copy.find(ZNEG) != m_neighbors_copy.end())
-                                oth = m_neighbors_copy[ZNEG]->getBlockAt(i, j, 15);
-                        }
-                    }
-                    else if(k+delta[l+2] > 15){
-                        if (!checkTransparent(curr)){
-                            drawFace = m_neighbors_copy.find(ZPOS) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = checkTransparent(m_neighbors_copy[ZPOS]->getBlockAt(i, j, 0));
-                        }
-                        else {
-                            drawFace = m_neighbors_copy.find(ZPOS) != m_neighbors_copy.end();
-                            if(drawFace) drawFace = m_neighbors_copy[ZPOS]->getBlockAt(i, j, 0) != curr;
-                            if (m_neighbors_copy.find(ZPOS) != m_neighbors_copy.end())
-                                oth = m_neighbors_copy[ZPOS]->getBlockAt(i, j, 0);
-                        }
-                    }
-                    else if(getBlockAt(i+delta[l], j+delta[l+1], k+delta[l+2]) == EMPTY){
-                        if (curr != EMPTY) drawFace = true;
-                    } else if(checkTransparent(getBlockAt(i+delta[l], j+delta[l+1], k+delta[l+2]))){
-                        if (!checkTransparent(curr)) drawFace = true;
+uint64_t Chunk::computeVisibility(int s) const {
+    const ChunkSection &sec = m_sections[s];
+    if(sec.allOpaque()) return VISIBLE_NONE;
+    if(sec.opaque == 0) return VISIBLE_ALL;
+
+    bool clear[4096];
+    for(int i = 0; i < 4096; i++) clear[i] = checkTransparent(sec.blocks.get(i));
+    //every pocket of see through blocks connects all the faces it touches
+    bool seen[4096] = {};
+    uint16_t stack[4096];
+    uint64_t visibility = VISIBLE_NONE;
+    for(int start = 0; start < 4096; start++) {
+        if(seen[start] || !clear[start]) continue;
+        int faces = 0, top = 0;
+        seen[start] = true;
+        stack[top++] = start;
+        while(top > 0) {
+            //index is x + 16 * y + 256 * z, like BlockStorage
+            int i = stack[--top];
+            int x = i & 15, y = i >> 4 & 15, z = i >> 8;
+            if(x == 15) faces |= 1 << XPOS;
+            if(x == 0) faces |= 1 << XNEG;
+            if(y == 15) faces |= 1 << YPOS;
+            if(y == 0) faces |= 1 << YNEG;
+            if(z == 15) faces |= 1 << ZPOS;
+            if(z == 0) faces |= 1 << ZNEG;
+            int next[6] = {x < 15 ? i + 1 : -1, x > 0 ? i - 1 : -1, y < 15 ? i + 16 : -1,
+                           y > 0 ? i - 16 : -1, z < 15 ? i + 256 : -1, z > 0 ? i - 256 : -1};
+            for(int j: next) {
+                if(j < 0 || seen[j] || !clear[j]) continue;
+                seen[j] = true;
+                stack[top++] = j;
+            }
+        }
+        for(int a = 0; a < 6; a++) {
+            if(!(faces >> a & 1)) continue;
+            for(int b = 0; b < 6; b++) {
+                if(faces >> b & 1) visibility |= uint64_t(1) << (a * 6 + b);
+            }
+        }
+        if(visibility == VISIBLE_ALL) break;
+    }
+    return visibility;
+}
+
+uint64_t Chunk::sectionVisibility(int s) const {
+    return m_visibility[s];
+}
+
+void Chunk::meshSection(int s, const NeighborArray &nb, bool greedy, SectionMesh &out) {
+    //read before any block, so a write that lands while we mesh leaves this mesh looking stale
+    out.version = m_sections[s].version;
+    out.visibility = computeVisibility(s);
+    std::vector<PackedVertex> &verts = out.verts;
+    std::vector<PackedVertex> &clearVerts = out.clearVerts;
+    verts.clear();
+    clearVerts.clear();
+
+    //the face block (i, j, k) shows in direction l (an index into delta).
+    //type is EMPTY if there is none. Air next to another chunk's block shows that block's face, flipped
+    struct Face {
+        BlockType type;
+        bool flip;
+        bool operator==(const Face &f) const { return type == f.type && flip == f.flip; }
+    };
+    auto faceAt = [&](int i, int j, int k, int l) -> Face {
+        //bound checking and neighbor
+        BlockType curr = getBlockAt(i, j, k);
+        BlockType oth = EMPTY;
+        bool drawFace = false;
+        if(i+delta[l] < 0){
+            if (!checkTransparent(curr)) {
+                drawFace = nb[XNEG] != nullptr;
+                if(drawFace) drawFace = checkTransparent(nb[XNEG]->getBlockAt(15, j, k));
+            }
+            else {
+                drawFace = nb[XNEG] != nullptr;
+                if(drawFace) drawFace = nb[XNEG]->getBlockAt(15, j, k) != curr;
+                if (nb[XNEG] != nullptr)
+                    oth = nb[XNEG]->getBlockAt(15, j, k);
+            }
+        }
+        else if(i+delta[l] > 15){
+            if (!checkTransparent(curr)) {
+                drawFace = nb[XPOS] != nullptr;
+                if(drawFace) drawFace = checkTransparent(nb[XPOS]->getBlockAt(0, j, k));
+            }
+            else {
+                drawFace = nb[XPOS] != nullptr;
+                if(drawFace) drawFace = nb[XPOS]->getBlockAt(0, j, k) != curr;
+                if (nb[XPOS] != nullptr)
+                    oth = nb[XPOS]->getBlockAt(0, j, k);
+            }
+        }
+        else if(j+delta[l+1] < 0 || j+delta[l+1] > 255){
+            if (curr != EMPTY) drawFace = true;
+        }
+        else if(k+delta[l+2] < 0){
+            if (!checkTransparent(curr)) {
+                drawFace = nb[ZNEG] != nullptr;
+                if(drawFace) drawFace = checkTransparent(nb[ZNEG]->getBlockAt(i, j, 15));
+            }
+            else {
+                drawFace = nb[ZNEG] != nullptr;
+                if(drawFace) drawFace = nb[ZNEG]->getBlockAt(i, j, 15) != curr;
+                if (nb[ZNEG] != nullptr)
+                    oth = nb[ZNEG]->getBlockAt(i, j, 15);
+            }
+        }
+        else if(k+delta[l+2] > 15){
+            if (!checkTransparent(curr)){
+                drawFace = nb[ZPOS] != nullptr;
+                if(drawFace) drawFace = checkTransparent(nb[ZPOS]->getBlockAt(i, j, 0));
+            }
+            else {
+                drawFace = nb[ZPOS] != nullptr;
+                if(drawFace) drawFace = nb[ZPOS]->getBlockAt(i, j, 0) != curr;
+                if (nb[ZPOS] != nullptr)
+                    oth = nb[ZPOS]->getBlockAt(i, j, 0);
+            }
+        }
+        else if(getBlockAt(i+delta[l], j+delta[l+1], k+delta[l+2]) == EMPTY){
+            if (curr != EMPTY) drawFace = true;
+        } else if(checkTransparent(getBlockAt(i+delta[l], j+delta[l+1], k+delta[l+2]))){
+            if (!checkTransparent(curr)) drawFace = true;
+        }
+        if(!drawFace) return Face{EMPTY, false};
+        return curr == EMPTY ? Face{oth, true} : Face{curr, false};
+    };
+
+    //emits face f in direction l for block (i, j, k), stretched to cover extent blocks along the
+    //two in-plane axes
+    auto emitFace = [&](int i, int j, int k, int l, Face f, glm::ivec3 extent) {
+        bool clear = blockInfo(f.type).layer == LAYER_CLEAR;
+        //every quad is 4 vertices in order, drawn with the quad indices in ChunkArena
+        std::vector<PackedVertex> &layer = clear ? clearVerts : verts;
+        if(layer.capacity() - layer.size() < 4) {
+            meshAllocations++;
+            layer.reserve(std::max<size_t>(2 * layer.capacity(), 64));
+        }
+        glm::ivec3 faceref(i + std::max(0, delta[l]), j + std::max(0, delta[l+1]), k + std::max(0, delta[l+2]));
+        pushFace(layer, faceref, l, f.type, f.flip, extent);
+    };
+
+    //meshes one block, checking all 6 of its faces
+    auto meshBlock = [&](int i, int j, int k) {
+        for(int l = 0; l < 6*3; l+=3) {
+            Face f = faceAt(i, j, k, l);
+            if(f.type != EMPTY) emitFace(i, j, k, l, f, glm::ivec3(1));
+        }
+    };
+
+    //merges each direction's faces in the section into as few rectangles as possible.
+    //considered says which blocks the per block path would have looked at
+    auto meshGreedy = [&](const std::function<bool(int, int, int)> &considered) {
+        Face mask[16][16];
+        for(int l = 0; l < 6*3; l+=3) {
+            int axis = l/6;
+            int a1 = axis == 0 ? 1 : 0, a2 = axis == 2 ? 1 : 2;
+            for(int slice = 0; slice < 16; slice++) {
+                bool any = false;
+                for(int u = 0; u < 16; u++) {
+                    for(int v = 0; v < 16; v++) {
+                        glm::ivec3 p;
+                        p[axis] = slice;
+                        p[a1] = u;
+                        p[a2] = v;
+                        p.y += s*16;
+                        mask[u][v] = considered(p.x, p.y, p.z) ? faceAt(p.x, p.y, p.z, l) : Face{EMPTY, false};
+                        any |= mask[u][v].type != EMPTY;
                     }
-                    if(drawFace){
-
-                        //set surface positions
-                        glm::vec4 faceref = glm::vec4(i+fmax(0, delta[l]), j+fmax(0, delta[l+1]), k+fmax(0, delta[l+2]), 1);
-
-                        if (curr == WATER || curr == GLASS || curr == ICE || curr == OAK_LEAVES ||
-                                (curr == EMPTY && (oth == WATER || oth == GLASS || oth == ICE || oth == OAK_LEAVES))) {
-                            //set indices
-                            Clearidx.push_back(VBOClearpos.size());
-                            Clearidx.push_back(VBOClearpos.size()+1);
-                            Clearidx.push_back(VBOClearpos.size()+2);
-                            Clearidx.push_back(VBOClearpos.size()+2);
-                            Clearidx.push_back(VBOClearpos.size()+3);
-                            Clearidx.push_back(VBOClearpos.size());
-
-                            VBOClearpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12], facedeltas[(l/6)*12+1], facedeltas[(l/6)*12+2], 0));
-                            VBOClearpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+3], facedeltas[(l/6)*12+4], facedeltas[(l/6)*12+5], 0));
-                            VBOClearpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+6], facedeltas[(l/6)*12+7], facedeltas[(l/6)*12+8], 0));
-                            VBOClearpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+9], facedeltas[(l/6)*12+10], facedeltas[(l/6)*12+11], 0));
-                        } else {
-                            //set indices
-                            idx.push_back(VBOpos.size());
-                            idx.push_back(VBOpos.size()+1);
-                            idx.push_back(VBOpos.size()+2);
-                            idx.push_back(VBOpos.size()+2);
-                            idx.push_back(VBOpos.size()+3);
-                            idx.push_back(VBOpos.size());
-
-                            VBOpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12], facedeltas[(l/6)*12+1], facedeltas[(l/6)*12+2], 0));
-                            VBOpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+3], facedeltas[(l/6)*12+4], facedeltas[(l/6)*12+5], 0));
-                            VBOpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+6], facedeltas[(l/6)*12+7], facedeltas[(l/6)*12+8], 0));
-                            VBOpos.push_back(faceref + glm::vec4(facedeltas[(l/6)*12+9], facedeltas[(l/6)*12+10], facedeltas[(l/6)*12+11], 0));
+                }
+                if(!any) continue;
+                for(int v = 0; v < 16; v++) {
+                    for(int u = 0; u < 16;) {
+                        Face f = mask[u][v];
+                        if(f.type == EMPTY) {
+                            u++;
+                            continue;
                         }
-                        //set surface normals
-                        if (curr != EMPTY) {
-                            if (curr == WATER || curr == GLASS || curr == ICE || curr == OAK_LEAVES) {
-                                VBOClearnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                            } else {
-                                VBOnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                            }
-                        } else {
-                            if (oth ==  WATER || oth == GLASS || oth == ICE || oth == OAK_LEAVES) {
-                                VBOClearnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOClearnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                            } else {
-                                VBOnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
-                                VBOnor.push_back(-glm::vec4(delta[l], delta[l+1], delta[l+2], 1));
+                        int w = 1, h = 1;
+                        while(u + w < 16 && mask[u + w][v] == f) w++;
+                        for(bool grow = true; grow && v + h < 16; ) {
+                            for(int du = 0; du < w; du++) {
+                                if(!(mask[u + du][v + h] == f)) {
+                                    grow = false;
+                                    break;
+                                }
                             }
+                            if(grow) h++;
                         }
-
-                        if (curr == EMPTY) curr = oth;
-                        switch(curr){
-                        case GRASS_BLOCK:
-                            if (Face != 2 && Face != 3) { //side
-
-                                UVs[0] = glm::vec4(25.f/64.f + 1.f/1024, 63.f/64.f + 1.f/1024, 0.f, 0.f),
-                                UVs[1] = glm::vec4(26.f/64.f - 1.f/1024, 63.f/64.f + 1.f/1024, 0.f, 0.f),
-                                UVs[2] = glm::vec4(26.f/64.f - 1.f/1024, 64.f/64.f - 1.f/1024, 0.f, 0.f),
-                                UVs[3] = glm::vec4(25.f/64.f + 1.f/1024, 64.f/64.f - 1.f/1024, 0.f, 0.f);
-
-                            } else { //top & bottom
-                                UVs[0] = glm::vec4(497.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(511.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(511.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(497.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        case DIRT:
-                            UVs[0] = glm::vec4(337.f/1024.f, 850.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(350.f/1024.f, 850.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(350.f/1024.f, 863.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(337.f/1024.f, 863.f/1024.f, 0.f, 0.f);
-                            break;
-                        case STONE:
-                            UVs[0] = glm::vec4(507.f/1024.f, 642.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(510.f/1024.f, 642.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(510.f/1024.f, 655.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(507.f/1024.f, 655.f/1024.f, 0.f, 0.f);
-                            break;
-                        case WATER:
-                            UVs[0] = glm::vec4(129.f/1024.f, 930.f/1024.f, 1.f, 0.f);
-                            UVs[1] = glm::vec4(142.f/1024.f, 930.f/1024.f, 1.f, 0.f);
-                            UVs[2] = glm::vec4(142.f/1024.f, 944.f/1024.f, 1.f, 0.f);
-                            UVs[3] = glm::vec4(129.f/1024.f, 944.f/1024.f, 1.f, 0.f);
-                            break;
-                        case SAND:
-                            UVs[0] = glm::vec4(129.f/1024.f, 658.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(142.f/1024.f, 658.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(142.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(129.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                            break;
-                        case SNOW:
-                            UVs[0] = glm::vec4(480.f/1024.f, 705.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(494.f/1024.f, 705.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(494.f/1024.f, 720.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(480.f/1024.f, 720.f/1024.f, 0.f, 0.f);
-                            break;
-                        case GLASS:
-                            UVs[0] = glm::vec4(384.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(399.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(399.f/1024.f, 896.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(384.f/1024.f, 896.f/1024.f, 0.f, 0.f);
-                            break;
-                        case COBBLESTONE:
-                            UVs[0] = glm::vec4(32.f/1024.f, 770.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(47.f/1024.f, 770.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(47.f/1024.f, 784.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(32.f/1024.f, 784.f/1024.f, 0.f, 0.f);
-                            break;
-                        case OAK_PLANKS:
-                            UVs[0] = glm::vec4(384.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(398.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(398.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(384.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                            break;
-                          case SPRUCE_PLANKS:
-                              UVs[0] = glm::vec4(448.f/1024.f, 641.f/1024.f, 0.f, 0.f);
-                              UVs[1] = glm::vec4(462.f/1024.f, 641.f/1024.f, 0.f, 0.f);
-                              UVs[2] = glm::vec4(462.f/1024.f, 656.f/1024.f, 0.f, 0.f);
-                              UVs[3] = glm::vec4(448.f/1024.f, 656.f/1024.f, 0.f, 0.f);
-                              break;
-                        case JUNGLE_PLANKS:
-                            UVs[0] = glm::vec4(448.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(462.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(462.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(448.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-                            break;
-                        case BIRCH_PLANKS:
-                            UVs[0] = glm::vec4(256.f/1024.f, 929.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(270.f/1024.f, 929.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(270.f/1024.f, 944.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(256.f/1024.f, 944.f/1024.f, 0.f, 0.f);
-                            break;
-                        case ACACIA_PLANKS:
-                            UVs[0] = glm::vec4(175.f/1024.f, 929.f/1024.f, 0.f, 1.f);
-                            UVs[1] = glm::vec4(190.f/1024.f, 929.f/1024.f, 0.f, 1.f);
-                            UVs[2] = glm::vec4(190.f/1024.f, 944.f/1024.f, 0.f, 1.f);
-                            UVs[3] = glm::vec4(175.f/1024.f, 944.f/1024.f, 0.f, 1.f);
-                            break;
-                        case OAK_LOG:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(352.f/1024.f, 738.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(367.f/1024.f, 738.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(367.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(352.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                            } else { //top and bottom
-                                UVs[0] = glm::vec4(369.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(383.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(383.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(369.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        case SPRUCE_LOG:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(416.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(431.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(431.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(416.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                            } else { //top and bottom
-                                UVs[0] = glm::vec4(432.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(447.f/1024.f, 641.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(447.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(432.f/1024.f, 656.f/1024.f, 0.f, 1.f);
-                            }
-                            break;
-                        case BIRCH_LOG:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(256.f/1024.f, 961.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(270.f/1024.f, 961.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(270.f/1024.f, 976.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(256.f/1024.f, 976.f/1024.f, 0.f, 1.f);
-                            } else { //top and bottom
-                                UVs[0] = glm::vec4(256.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(270.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(270.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(256.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                            }
-                            break;
-                        case JUNGLE_LOG:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(448.f/1024.f, 881.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(463.f/1024.f, 881.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(463.f/1024.f, 896.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(448.f/1024.f, 896.f/1024.f, 0.f, 1.f);
-                            } else { //top and bottom
-                                UVs[0] = glm::vec4(448.f/1024.f, 865.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(463.f/1024.f, 865.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(463.f/1024.f, 880.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(448.f/1024.f, 880.f/1024.f, 0.f, 1.f);
-                            }
-                            break;
-                        case ACACIA_LOG:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(160.f/1024.f, 897.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(174.f/1024.f, 897.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(174.f/1024.f, 912.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(160.f/1024.f, 912.f/1024.f, 0.f, 1.f);
-                            } else { //top and bottom
-                                UVs[0] = glm::vec4(176.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                                UVs[1] = glm::vec4(191.f/1024.f, 945.f/1024.f, 0.f, 1.f);
-                                UVs[2] = glm::vec4(191.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                                UVs[3] = glm::vec4(176.f/1024.f, 960.f/1024.f, 0.f, 1.f);
-                            }
-                            break;
-                        case OAK_LEAVES:
-                            UVs[0] = glm::vec4(192.f/1024.f, 1009.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(207.f/1024.f, 1009.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(207.f/1024.f, 1024.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(192.f/1024.f, 1024.f/1024.f, 0.f, 0.f);
-                            break;
-                        case PATH:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(337.f/1024.f, 833.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(350.f/1024.f, 833.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(350.f/1024.f, 847.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(337.f/1024.f, 847.f/1024.f, 0.f, 0.f);
-                            } else {
-                                UVs[0] = glm::vec4(337.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(350.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(350.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(337.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        case BOOKSHELF:
-                            if (Face != 2 && Face != 3) {
-                                UVs[0] = glm::vec4(192.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(207.f/1024.f, 849.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(207.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(192.f/1024.f, 864.f/1024.f, 0.f, 0.f);
-                            } else {
-                                UVs[0] = glm::vec4(384.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(398.f/1024.f, 737.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(398.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(384.f/1024.f, 752.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        case LAVA:
-                            UVs[0] = glm::vec4(129.f/1024.f, 962.f/1024.f, 1.f, 0.f);
-                            UVs[1] = glm::vec4(141.f/1024.f, 962.f/1024.f, 1.f, 0.f);
-                            UVs[2] = glm::vec4(141.f/1024.f, 976.f/1024.f, 1.f, 0.f);
-                            UVs[3] = glm::vec4(129.f/1024.f, 976.f/1024.f, 1.f, 0.f);
-                            break;
-                        case SANDSTONE:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(144.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(158.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(158.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(144.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                            } else { //top & bottom
-                                UVs[0] = glm::vec4(160.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(174.f/1024.f, 657.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(174.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(160.f/1024.f, 671.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        case BEDROCK:
-                            UVs[0] = glm::vec4(208.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(222.f/1024.f, 881.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(222.f/1024.f, 895.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(208.f/1024.f, 895.f/1024.f, 0.f, 0.f);
-                            break;
-                        case ICE:
-                            UVs[0] = glm::vec4(224.f/1024.f, 722.f/1024.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(238.f/1024.f, 722.f/1024.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(238.f/1024.f, 735.f/1024.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(224.f/1024.f, 735.f/1024.f, 0.f, 0.f);
-                            break;
-                        case CACTUS:
-                            if (Face != 2 && Face != 3) { //side
-                                UVs[0] = glm::vec4(32.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(47.f/1024.f, 818.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(47.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(32.f/1024.f, 831.f/1024.f, 0.f, 0.f);
-                            } else { //top & bottom
-                                UVs[0] = glm::vec4(48.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                                UVs[1] = glm::vec4(63.f/1024.f, 817.f/1024.f, 0.f, 0.f);
-                                UVs[2] = glm::vec4(63.f/1024.f, 832.f/1024.f, 0.f, 0.f);
-                                UVs[3] = glm::vec4(48.f/1024.f, 832.f/1024.f, 0.f, 0.f);
-                            }
-                            break;
-                        default:
-                            UVs[0] = glm::vec4(32.f/64.f, 63.f/64.f, 0.f, 0.f);
-                            UVs[1] = glm::vec4(33.f/64.f, 63.f/64.f, 0.f, 0.f);
-                            UVs[2] = glm::vec4(33.f/64.f, 64.f/64.f, 0.f, 0.f);
-                            UVs[3] = glm::vec4(32.f/64.f, 64.f/64.f, 0.f, 0.f);
-                            break;
-                        }
-                        for(int foo = 0; foo < 4; foo++) {
-                            if (curr == WATER || curr == GLASS || curr == ICE || curr == OAK_LEAVES) {
-                                VBOClearuv.push_back(UVs[UVorder[l/3][foo]]);
-                            } else {
-                                VBOuv.push_back(UVs[UVorder[l/3][foo]]);
+                        for(int dv = 0; dv < h; dv++) {
+                            for(int du = 0; du < w; du++) {
+                                mask[u + du][v + dv].type = EMPTY;
                             }
                         }
+                        glm::ivec3 p, extent(1);
+                        p[axis] = slice;
+                        p[a1] = u;
+                        p[a2] = v;
+                        p.y += s*16;
+                        extent[a1] = w;
+                        extent[a2] = h;
+                        emitFace(p.x, p.y, p.z, l, f, extent);
+                        u += w;
                     }
-                    Face++;
                 }
             }
         }
+    };
+
+    //walls of this chunk that border a loaded neighbor
+    bool wall[6] = {};
+    for(Direction d: {XPOS, XNEG, ZPOS, ZNEG}) {
+        wall[d] = nb[d] != nullptr;
+    }
+
+    const ChunkSection &sec = m_sections[s];
+    std::function<bool(int, int, int)> considered;
+    if(sec.allAir()) {
+        //air only picks up the faces of neighboring chunks' blocks along the chunk walls
+        bool side[6] = {};
+        bool any = false;
+        for(Direction d: {XPOS, XNEG, ZPOS, ZNEG}) {
+            side[d] = wall[d] && !nb[d]->sectionAir(s);
+            any |= side[d];
+        }
+        if(!any) return;
+        considered = [side](int i, int, int k) {
+            return (i == 0 && side[XNEG]) || (i == 15 && side[XPOS]) ||
+                   (k == 0 && side[ZNEG]) || (k == 15 && side[ZPOS]);
+        };
+    }
+    else if(sec.allOpaque()) {
+        //the inside of a solid section can't be seen, and neither can any of it if it's surrounded by solid sections
+        bool buried = s > 0 && s < 15 && sectionOpaque(s-1) && sectionOpaque(s+1);
+        for(Direction d: {XPOS, XNEG, ZPOS, ZNEG}) {
+            buried = buried && (!wall[d] || nb[d]->sectionOpaque(s));
+        }
+        if(buried) return;
+        considered = [s](int i, int j, int k) {
+            return i == 0 || i == 15 || k == 0 || k == 15 || j == s*16 || j == s*16+15;
+        };
+    }
+    else {
+        considered = [](int, int, int) { return true; };
+    }
+
+    if(greedy) {
+        meshGreedy(considered);
+        return;
+    }
+    for(int i = 0; i < 16; i++) {
+        for(int j = s*16; j < s*16+16; j++) {
+            for(int k = 0; k < 16; k++) {
+                if(considered(i, j, k)) meshBlock(i, j, k);
+            }
+        }
     }
+}
+
+// copies src over dst, which only allocates if dst never held a mesh this big
+static void copyMesh(const std::vector<PackedVertex> &src, std::vector<PackedVertex> &dst) {
+    if(dst.capacity() < src.size()) Chunk::meshAllocations++;
+    dst.assign(src.begin(), src.end());
+}
 
-    for (int i = 0; i < VBOpos.size(); i++) {
-        VBOinter.push_back(VBOpos[i]);
-        VBOinter.push_back(VBOnor[i]);
-        VBOinter.push_back(VBOuv[i]);
+int Chunk::commitMeshes(const std::array<SectionMesh, 16> &meshes, int sections) {
+    int changed = 0;
+    for(int s = 0; s < 16; s++) {
+        if(!(sections >> s & 1)) continue;
+        //a build that started before someone else's finished must not undo it
+        if(meshes[s].version < m_meshes[s].version) continue;
+        copyMesh(meshes[s].verts, m_meshes[s].verts);
+        copyMesh(meshes[s].clearVerts, m_meshes[s].clearVerts);
+        m_meshes[s].version = meshes[s].version;
+        m_meshes[s].visibility = meshes[s].visibility;
+        m_visibility[s] = meshes[s].visibility;
+        m_slotSizes[s] = meshes[s].verts.size();
+        m_slotSizes[s + 16] = meshes[s].clearVerts.size();
+        m_freedSlots &= ~(1u << s | 1u << (s + 16));
+        changed |= 1 << s;
     }
+    recountMesh();
+    return changed;
+}
 
-    for(int i = 0; i < VBOClearpos.size(); i++) {
-        VBOinter.push_back(VBOClearpos[i]);
-        VBOinter.push_back(VBOClearnor[i]);
-        VBOinter.push_back(VBOClearuv[i]);
+void Chunk::recountMesh() {
+    int verts = 0, sections = 0;
+    bool clear = false;
+    for(int s = 0; s < 16; s++) {
+        int opaque = m_slotSizes[s], translucent = m_slotSizes[s + 16];
+        verts += opaque + translucent;
+        clear = clear || translucent > 0;
+        if(opaque > 0 || translucent > 0) sections |= 1 << s;
     }
+    vertexCount = verts;
+    meshSections = sections;
+    hasTransparent = clear;
+}
 
-    int s = VBOpos.size();
-    for (int i = 0; i < Clearidx.size(); i++) {
-        int index = Clearidx.at(i);
-        idx.push_back(s + index);
+// bit d is set if there is a neighbor in Direction d
+static int neighborMask(const Chunk::NeighborArray &neighbors) {
+    int mask = 0;
+    for(int d = 0; d < 6; d++) {
+        if(neighbors[d] != nullptr) mask |= 1 << d;
     }
+    return mask;
+}
 
-    hasTransparent = !Clearidx.empty();
+Chunk::NeighborArray Chunk::neighborSnapshot() {
+    NeighborArray nb;
+    nb.fill(nullptr);
+    neighbor_mutex.lock();
+    for(auto &n: m_neighbors) nb[n.first] = n.second;
+    neighbor_mutex.unlock();
+    return nb;
+}
+
+// Meshing scratch space, one set per thread that meshes. Sections are built
+// here and copied into the chunk, so the buffers keep their capacity from job
+// to job and a worker stops allocating once it has seen its biggest section
+static thread_local std::array<SectionMesh, 16> scratchMeshes;
+
+void Chunk::createVBOdata() {
+    auto start = std::chrono::high_resolution_clock::now();
+    bool greedy = greedyMeshing;
+    NeighborArray nb = neighborSnapshot();
 
+    for(int s = 0; s < 16; s++) {
+        meshSection(s, nb, greedy, scratchMeshes[s]);
+    }
+
+    createVBO_mutex.lock();
+    commitMeshes(scratchMeshes, 0xffff);
+    m_meshed = true;
+    m_meshedNeighbors = neighborMask(nb);
     createVBO_mutex.unlock();
 
+    meshNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    meshCount++;
+
     //tells the main thread to bind to vbo
     dataGen = true;
     dataBound = false;
 }
 
-void Chunk::bindVBOdata() {
+bool Chunk::remeshSections(int sections) {
     createVBO_mutex.lock();
-    m_count = idx.size();
+    bool meshed = m_meshed;
+    createVBO_mutex.unlock();
+    if(!meshed) return false;
+
+    bool greedy = greedyMeshing;
+    NeighborArray nb = neighborSnapshot();
 
-    // Create a VBO on our GPU and store its handle in bufIdx
-    generateIdx();
-    // Tell OpenGL that we want to perform subsequent operations on the VBO referred to by bufIdx
-    // and that it will be treated as an element array buffer (since it will contain triangle indices)
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    // Pass the data stored in cyl_idx into the bound buffer, reading a number of bytes equal to
-    // SPH_IDX_COUNT multiplied by the size of a GLuint. This data is sent to the GPU to be read by shader programs.
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+    for(int s = 0; s < 16; s++) {
+        if(sections >> s & 1) meshSection(s, nb, greedy, scratchMeshes[s]);
+    }
 
-    generateInter();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInter);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, VBOinter.size() * sizeof(glm::vec4), VBOinter.data(), GL_STATIC_DRAW);
+    createVBO_mutex.lock();
+    dirtySections |= commitMeshes(scratchMeshes, sections);
+    createVBO_mutex.unlock();
+    return true;
+}
 
+void Chunk::updateVBOdata() {
+    int neighbors = neighborMask(neighborSnapshot());
+    int stale = 0;
+    createVBO_mutex.lock();
+    //walls drawn against missing neighbors are all wrong, start over
+    bool full = !m_meshed || neighbors != m_meshedNeighbors;
+    for(int s = 0; s < 16; s++) {
+        if(m_meshes[s].version != m_sections[s].version) stale |= 1 << s;
+    }
+    createVBO_mutex.unlock();
+    if(full) {
+        createVBOdata();
+        return;
+    }
+    //we don't know where in a section the writes were, and faces on its top and bottom layers belong to the sections next to it
+    int sections = (stale | stale << 1 | stale >> 1) & 0xffff;
+    if(sections) remeshSections(sections);
+}
+
+// vertices of slot (0 - 15 opaque, 16 - 31 clear), caller holds createVBO_mutex
+static const std::vector<PackedVertex>& slotVerts(const std::array<SectionMesh, 16> &meshes, int slot) {
+    return slot < 16 ? meshes[slot].verts : meshes[slot - 16].clearVerts;
+}
+
+// vertices bindVBOdata lays a slot of n out in, the rest is room to grow
+static int slotCapacity(int n) {
+    return n == 0 ? 0 : (n + n / 8 + 48 + 3) & ~3;
+}
+
+void Chunk::bindVBOdata(ChunkArena &arena) {
+    createVBO_mutex.lock();
+    ArenaRange old = m_arenaVerts;
+    std::array<MeshSlot, 32> was = m_slots;
+    //lay sections out with room to grow, so most edits can be patched in place.
+    //Unused room is zeroed, which draws as degenerate quads. Slots we only have
+    //in the arena keep the room they had and are copied over as they are
+    uint32_t moved = old.size > 0 ? m_freedSlots : 0;
+    int total = 0;
+    for(int slot = 0; slot < 32; slot++) {
+        int n = m_slotSizes[slot];
+        int capacity;
+        if(moved >> slot & 1) capacity = was[slot].capacity;
+        else if(m_freedSlots >> slot & 1) capacity = 0; //lost, nothing to draw until a remesh
+        else capacity = slotCapacity(n);
+        m_slots[slot] = {total, capacity};
+        total += capacity;
+    }
+    m_arenaVerts = {0, 0};
+    if(total > 0) {
+        //no indices, every draw shares the arena's quad pattern
+        m_arenaVerts = {arena.vertices.alloc(total), total};
+        //runs of slots we have on the cpu go up in one write each
+        std::vector<PackedVertex> data;
+        int runStart = 0;
+        for(int slot = 0; slot <= 32; slot++) {
+            if(slot == 32 || (moved >> slot & 1)) {
+                if(!data.empty()) arena.vertices.write(runStart, data.size(), data.data());
+                data.clear();
+                if(slot == 32) break;
+                arena.vertices.copy(old.offset + was[slot].offset, m_arenaVerts.offset + m_slots[slot].offset, m_slots[slot].capacity);
+                continue;
+            }
+            if(m_slots[slot].capacity == 0) continue;
+            if(data.empty()) runStart = m_arenaVerts.offset + m_slots[slot].offset;
+            const std::vector<PackedVertex> &v = slotVerts(m_meshes, slot);
+            data.insert(data.end(), v.begin(), v.end());
+            data.resize(data.size() + m_slots[slot].capacity - v.size(), PackedVertex{0, 0});
+        }
+    }
+    //after the copies, so the new range can't land on what they read
+    arena.vertices.release(old.offset, old.size);
+    freeUploaded(~m_freedSlots);
+    m_count = total / 4 * 6;
+
+    updateGPUBytes();
+    dirtySections = 0;
     dataBound = true;
     createVBO_mutex.unlock();
 }
 
-void Chunk::unbindVBOdata() {
+void Chunk::patchVBOdata(ChunkArena &arena) {
     createVBO_mutex.lock();
-    m_count = 0;
+    int dirty = dirtySections.exchange(0);
+    for(int slot = 0; slot < 32; slot++) {
+        if(!(dirty >> (slot & 15) & 1)) continue;
+        //outgrew its room, everything after it has to move
+        if(m_slotSizes[slot] > m_slots[slot].capacity) {
+            createVBO_mutex.unlock();
+            bindVBOdata(arena);
+            return;
+        }
+    }
+    std::vector<PackedVertex> data;
+    for(int slot = 0; slot < 32; slot++) {
+        if(!(dirty >> (slot & 15) & 1) || m_slots[slot].capacity == 0) continue;
+        const std::vector<PackedVertex> &v = slotVerts(m_meshes, slot);
+        data.assign(v.begin(), v.end());
+        data.resize(m_slots[slot].capacity, PackedVertex{0, 0});
+        arena.vertices.write(m_arenaVerts.offset + m_slots[slot].offset, data.size(), data.data());
+    }
+    freeUploaded(uint32_t(dirty) | uint32_t(dirty) << 16);
+    createVBO_mutex.unlock();
+}
 
-    // Create a VBO on our GPU and store its handle in bufIdx
-    generateIdx();
-    // Tell OpenGL that we want to perform subsequent operations on the VBO referred to by bufIdx
-    // and that it will be treated as an element array buffer (since it will contain triangle indices)
-    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
-    // Pass the data stored in cyl_idx into the bound buffer, reading a number of bytes equal to
-    // SPH_IDX_COUNT multiplied by the size of a GLuint. This data is sent to the GPU to be read by shader programs.
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+int Chunk::uploadBytes() {
+    createVBO_mutex.lock();
+    //what patchVBOdata writes, unless a slot outgrew its room and it falls back to bindVBOdata
+    bool rebind = !dataBound;
+    int dirty = dirtySections;
+    int n = 0;
+    for(int slot = 0; slot < 32 && !rebind; slot++) {
+        if(!(dirty >> (slot & 15) & 1)) continue;
+        if(m_slotSizes[slot] > m_slots[slot].capacity) rebind = true;
+        else n += m_slots[slot].capacity;
+    }
+    if(rebind) {
+        n = 0;
+        for(int slot = 0; slot < 32; slot++) {
+            //freed slots are copied on the gpu
+            if(!(m_freedSlots >> slot & 1)) n += slotCapacity(m_slotSizes[slot]);
+        }
+    }
+    createVBO_mutex.unlock();
+    return n * sizeof(PackedVertex);
+}
 
-    generateInter();
-    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufInter);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, VBOinter.size() * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+void Chunk::unbindVBOdata(ChunkArena &arena) {
+    unbindSections(arena);
+    unbindLODdata(arena);
+}
 
+void Chunk::unbindSections(ChunkArena &arena) {
+    createVBO_mutex.lock();
+    releaseArena(arena);
+    //what's left on the cpu is no use without the rest, start over next time
+    freeUploaded(~0u);
+    if(m_freedSlots) m_meshed = false;
+    m_count = 0;
+    updateGPUBytes();
     dataBound = false;
     createVBO_mutex.unlock();
 }
 
+bool Chunk::hasMesh() {
+    createVBO_mutex.lock();
+    bool has = m_freedSlots == 0 || m_arenaVerts.size > 0;
+    createVBO_mutex.unlock();
+    return has;
+}
+
+void Chunk::freeUploaded(uint32_t which) {
+    for(int slot = 0; slot < 32; slot++) {
+        if(!(which >> slot & 1) || m_slotSizes[slot] == 0) continue;
+        std::vector<PackedVertex> &v = slot < 16 ? m_meshes[slot].verts : m_meshes[slot - 16].clearVerts;
+        std::vector<PackedVertex>().swap(v);
+        m_freedSlots |= 1u << slot;
+    }
+}
+
+void Chunk::releaseArena(ChunkArena &arena) {
+    arena.vertices.release(m_arenaVerts.offset, m_arenaVerts.size);
+    m_arenaVerts = {0, 0};
+}
+
+void Chunk::releaseLOD(ChunkArena &arena) {
+    arena.vertices.release(m_lodArena.offset, m_lodArena.size);
+    m_lodArena = {0, 0};
+    m_lodOpaque = 0;
+    m_lodLevel = 0;
+}
+
+void Chunk::updateGPUBytes() {
+    gpuBytes = (m_arenaVerts.size + m_lodArena.size) * sizeof(PackedVertex);
+}
+
+void Chunk::queueDraw(ChunkArena &arena, int x, int z, int sections) {
+    if(m_arenaVerts.size == 0) return;
+    arena.addChunk(glm::ivec2(x, z));
+    for(int slot = 0; slot < 32; slot++) {
+        if(!(sections >> (slot & 15) & 1) || m_slots[slot].capacity == 0) continue;
+        arena.addRange(slot < 16 ? LAYER_OPAQUE : LAYER_CLEAR, m_arenaVerts.offset + m_slots[slot].offset, m_slots[slot].capacity);
+    }
+}
+
+int Chunk::blocksVersion() const {
+    int v = 0;
+    for(const ChunkSection &sec: m_sections) v += sec.version;
+    return v;
+}
+
+// the cell of 2^level blocks whose lowest corner is (x0, y0, z0) in c: its topmost
+// opaque block, else its topmost clear one, else EMPTY
+static BlockType lodCell(const Chunk* c, int x0, int y0, int z0, int k) {
+    if(c->sectionAir(y0 >> 4)) return EMPTY;
+    BlockType clear = EMPTY;
+    for(int y = y0 + k - 1; y >= y0; y--) {
+        for(int x = x0; x < x0 + k; x++) {
+            for(int z = z0; z < z0 + k; z++) {
+                BlockType t = c->getLocalBlock(x, y, z);
+                if(t == EMPTY) continue;
+                if(!checkTransparent(t)) return t;
+                if(clear == EMPTY) clear = t;
+            }
+        }
+    }
+    return clear;
+}
+
+void Chunk::createLODdata(int level) {
+    //read before any block, so a write that lands while we mesh leaves this mesh looking stale
+    int version = blocksVersion();
+    NeighborArray nb = neighborSnapshot();
+    int k = 1 << level;
+    int n = 16 / k, ny = 256 / k;
+    //cells of this chunk and the ring of neighbor cells touching it,
+    //(x, y, z) is at (x + 1) + (n + 2) * (y + ny * (z + 1))
+    std::vector<BlockType> cells((n + 2) * ny * (n + 2), EMPTY);
+    auto cell = [&](int x, int y, int z) -> BlockType& {
+        return cells[(x + 1) + (n + 2) * (y + ny * (z + 1))];
+    };
+    for(int y = 0; y < ny; y++) {
+        for(int x = 0; x < n; x++) {
+            for(int z = 0; z < n; z++) {
+                cell(x, y, z) = lodCell(this, x * k, y * k, z * k, k);
+            }
+        }
+        for(int i = 0; i < n; i++) {
+            if(nb[XPOS]) cell(n, y, i) = lodCell(nb[XPOS], 0, y * k, i * k, k);
+            if(nb[XNEG]) cell(-1, y, i) = lodCell(nb[XNEG], 16 - k, y * k, i * k, k);
+            if(nb[ZPOS]) cell(i, y, n) = lodCell(nb[ZPOS], i * k, y * k, 0, k);
+            if(nb[ZNEG]) cell(i, y, -1) = lodCell(nb[ZNEG], i * k, y * k, 16 - k, k);
+        }
+    }
+    auto opaque = [](BlockType t) {
+        return t != EMPTY && !checkTransparent(t);
+    };
+
+    //the face cell (x, y, z) shows in direction l, EMPTY if none
+    auto faceAt = [&](glm::ivec3 p, int l) -> BlockType {
+        BlockType t = cell(p.x, p.y, p.z);
+        if(t == EMPTY) return EMPTY;
+        int ox = p.x + delta[l], oy = p.y + delta[l+1], oz = p.z + delta[l+2];
+        BlockType o = oy < 0 || oy >= ny ? EMPTY : cell(ox, oy, oz);
+        bool show;
+        if(!opaque(t)) {
+            show = o == EMPTY || (checkTransparent(o) && o != t);
+        }
+        else if(ox < 0 || ox >= n || oz < 0 || oz >= n) {
+            //a neighbor drawn finer can have its top cell only partly filled
+            show = !opaque(o) || oy + 1 >= ny || !opaque(cell(ox, oy + 1, oz));
+        }
+        else {
+            show = !opaque(o);
+        }
+        return show ? t : EMPTY;
+    };
+
+    //merged like meshSection's greedy path, over at most 16 blocks each way so tile coordinates fit
+    std::vector<PackedVertex> verts, clearVerts;
+    glm::ivec3 dims(n, ny, n);
+    int most = 16 / k;
+    std::vector<BlockType> mask;
+    for(int l = 0; l < 6*3; l += 3) {
+        int axis = l/6;
+        int a1 = axis == 0 ? 1 : 0, a2 = axis == 2 ? 1 : 2;
+        int du = dims[a1], dv = dims[a2];
+        for(int slice = 0; slice < dims[axis]; slice++) {
+            mask.assign(du * dv, EMPTY);
+            bool any = false;
+            for(int v = 0; v < dv; v++) {
+                for(int u = 0; u < du; u++) {
+                    glm::ivec3 p;
+                    p[axis] = slice;
+                    p[a1] = u;
+                    p[a2] = v;
+                    mask[u + du * v] = faceAt(p, l);
+                    any |= mask[u + du * v] != EMPTY;
+                }
+            }
+            if(!any) continue;
+            for(int v = 0; v < dv; v++) {
+                for(int u = 0; u < du;) {
+                    BlockType t = mask[u + du * v];
+                    if(t == EMPTY) {
+                        u++;
+                        continue;
+                    }
+                    int w = 1, h = 1;
+                    while(w < most && u + w < du && mask[u + w + du * v] == t) w++;
+                    for(bool grow = true; grow && h < most && v + h < dv; ) {
+                        for(int i = 0; i < w; i++) {
+                            if(mask[u + i + du * (v + h)] != t) {
+                                grow = false;
+                                break;
+                            }
+                        }
+                        if(grow) h++;
+                    }
+                    for(int j = 0; j < h; j++) {
+                        for(int i = 0; i < w; i++) {
+                            mask[u + i + du * (v + j)] = EMPTY;
+                        }
+                    }
+                    glm::ivec3 p, extent(k);
+                    p[axis] = slice;
+                    p[a1] = u;
+                    p[a2] = v;
+                    extent[a1] = w * k;
+                    extent[a2] = h * k;
+                    glm::ivec3 faceref(p.x + std::max(0, delta[l]), p.y + std::max(0, delta[l+1]), p.z + std::max(0, delta[l+2]));
+                    std::vector<PackedVertex> &layer = blockInfo(t).layer == LAYER_CLEAR ? clearVerts : verts;
+                    pushFace(layer, faceref * k, l, t, false, extent);
+                    u += w;
+                }
+            }
+        }
+    }
+
+    int opaqueVerts = verts.size();
+    verts.insert(verts.end(), clearVerts.begin(), clearVerts.end());
+    createVBO_mutex.lock();
+    m_lodMesh.swap(verts);
+    m_lodMeshOpaque = opaqueVerts;
+    m_lodMeshLevel = level;
+    m_lodMeshVersion = version;
+    createVBO_mutex.unlock();
+}
+
+int Chunk::lodPending() {
+    createVBO_mutex.lock();
+    int level = m_lodMeshLevel;
+    createVBO_mutex.unlock();
+    return level;
+}
+
+int Chunk::lodUploadBytes() {
+    createVBO_mutex.lock();
+    int n = m_lodMesh.size() * sizeof(PackedVertex);
+    createVBO_mutex.unlock();
+    return n;
+}
+
+void Chunk::bindLODdata(ChunkArena &arena) {
+    createVBO_mutex.lock();
+    if(m_lodMeshLevel == 0) {
+        createVBO_mutex.unlock();
+        return;
+    }
+    releaseLOD(arena);
+    int total = m_lodMesh.size();
+    if(total > 0) {
+        m_lodArena = {arena.vertices.alloc(total), total};
+        arena.vertices.write(m_lodArena.offset, total, m_lodMesh.data());
+    }
+    m_lodOpaque = m_lodMeshOpaque;
+    m_lodLevel = m_lodMeshLevel;
+    m_lodVersion = m_lodMeshVersion;
+    m_lodMeshLevel = 0;
+    std::vector<PackedVertex>().swap(m_lodMesh);
+    updateGPUBytes();
+    createVBO_mutex.unlock();
+}
+
+void Chunk::unbindLODdata(ChunkArena &arena) {
+    createVBO_mutex.lock();
+    releaseLOD(arena);
+    updateGPUBytes();
+    createVBO_mutex.unlock();
+}
+
+int Chunk::lodLevel() const {
+    return m_lodLevel;
+}
+
+bool Chunk::lodStale() const {
+    return m_lodVersion != blocksVersion();
+}
+
+void Chunk::queueDrawLOD(ChunkArena &arena, int x, int z) {
+    if(m_lodArena.size == 0) return;
+    arena.addChunk(glm::ivec2(x, z));
+    arena.addRange(LAYER_OPAQUE, m_lodArena.offset, m_lodOpaque);
+    arena.addRange(LAYER_CLEAR, m_lodArena.offset + m_lodOpaque, m_lodArena.size - m_lodOpaque);
+}
+
 //void Chunk::setBiome(BiomeType input) {
 //    biome = input;
 //}
@@ -862,5 +1278,9 @@ GLenum Chunk::drawMode(){
 }
 
 Chunk* Chunk::getNeighborChunk(Direction d) {
-    return m_neighbors[d];
+    neighbor_mutex.lock();
+    auto it = m_neighbors.find(d);
+    Chunk* c = it == m_neighbors.end() ? nullptr : it->second;
+    neighbor_mutex.unlock();
+    return c;
 }
@@ -4,24 +4,16 @@
 #include <array>
 #include <unordered_map>
 #include <cstddef>
+#include <cstdint>
 #include "drawable.h"
 #include "biome.h"
+#include "blockstorage.h"
+#include "blockregistry.h"
 
+class ChunkArena;
 
-//using namespace std;
 
-// C++ 11 allows us to define the size of an enum. This lets us use only one byte
-// of memory to store our different block types. By default, the size of a C++ enum
-// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
-// block types, but in the scope of this project we'll never get anywhere near that many.
-enum BlockType : unsigned char
-{
-    EMPTY, GRASS_BLOCK, DIRT, STONE, WATER, SAND, SNOW, COBBLESTONE,
-    OAK_PLANKS, SPRUCE_PLANKS, JUNGLE_PLANKS, BIRCH_PLANKS, ACACIA_PLANKS,
-    OAK_LOG, SPRUCE_LOG, BIRCH_LOG, JUNGLE_LOG, ACACIA_LOG,
-    OAK_LEAVES, BOOKSHELF, GLASS, PATH, SANDSTONE,
-    LAVA, BEDROCK, CACTUS, ICE,
-    GRASS};
+//using namespace std;
 
 // The six cardinal directions in 3D space
 enum Direction : unsigned char
@@ -59,6 +51,61 @@ typedef std::unordered_map<glm::ivec3,BlockType,KeyFuncsiv3,KeyFuncsiv3> vec3Map
 
 //block uvs
 std::vector<glm::vec4> getBlockUV(BlockType, int);
+// atlas rect (x, y, width, height) of every block's side and top, for tiling chunk faces.
+// Tile 2 * type is the side and 2 * type + 1 the top and bottom, see lambert.frag.glsl
+std::vector<glm::vec4> blockTiles();
+
+// One chunk mesh vertex, unpacked by lambert.vert.glsl when u_Packed is set.
+// pos: x (5 bits) | y (9) << 5 | z (5) << 14 | normal Direction (3) << 19 | animated (1) << 22
+// tex: u (5 bits) | v (5) << 5 | tile (6) << 10
+// Positions are chunk local corners and u, v count blocks across the face, so
+// both stay exact for greedy quads. tile indexes blockTiles()
+struct PackedVertex {
+    uint32_t pos;
+    uint32_t tex;
+};
+static_assert(sizeof(PackedVertex) == 8, "chunk vertices should stay 8 bytes");
+
+PackedVertex packVertex(glm::ivec3 p, int normal, bool animated, int u, int v, int tile);
+
+// Far chunks draw a reduced detail mesh instead of their sections, one of
+// LOD_LEVELS levels. Level l meshes cells of 2^l blocks, see Chunk::createLODdata
+#define LOD_LEVELS 3
+
+// A 16 x 16 x 16 vertical slice of a Chunk.
+// Block counts are kept up to date on every write so the
+// air/opaque flags cost nothing to check.
+struct ChunkSection {
+    BlockStorage blocks;
+    std::atomic_int nonEmpty; //blocks that aren't EMPTY
+    std::atomic_int opaque;   //blocks that aren't transparent
+    std::atomic_int version;  //bumped by every write, meshes remember which one they were built from
+
+    ChunkSection();
+    bool allAir() const;
+    bool allOpaque() const;
+    void recount();
+};
+
+// Which faces of a section can see each other through it: bit a * 6 + b is set
+// if some path of see through blocks runs from face a to face b (Directions).
+// Terrain::draw walks these to skip sections walled off from the camera
+#define VISIBLE_NONE uint64_t(0)
+#define VISIBLE_ALL ((uint64_t(1) << 36) - 1)
+inline bool seesThrough(uint64_t visibility, int from, int to) {
+    return visibility >> (from * 6 + to) & 1;
+}
+
+// The faces of one ChunkSection, kept apart so a block edit only remeshes
+// and reuploads the sections it can change
+struct SectionMesh {
+    std::vector<PackedVertex> verts;      //opaque layer
+    std::vector<PackedVertex> clearVerts; //clear layer, drawn after every opaque face
+    int version; //ChunkSection::version this was built from, -1 before the first mesh
+    uint64_t visibility;
+
+    SectionMesh();
+};
 
 // One Chunk is a 16 x 256 x 16 section of the world,
 // containing all the Minecraft blocks in that area.
@@ -69,9 +116,13 @@ std::vector<glm::vec4> getBlockUV(BlockType, int);
 
 // TODO have Chunk inherit from Drawable
 class Chunk : public Drawable{
+public:
+    // m_neighbors indexed by Direction, nullptr where there is none
+    typedef std::array<Chunk*, 6> NeighborArray;
 private:
-    // All of the blocks contained within this Chunk
-    std::array<BlockType, 65536> m_blocks;
+    // All of the blocks contained within this Chunk, split into
+    // 16 sections stacked bottom to top, each palette compressed
+    std::array<ChunkSection, 16> m_sections;
 
     // This Chunk's four neighbors to the north, south, east, and west
     // The third input to this map just lets us use a Direction as
@@ -80,21 +131,122 @@ private:
     std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors;
 
     //for vbo
-    std::vector<glm::vec4> VBOinter;
-    std::vector<int> idx;
+    std::array<SectionMesh, 16> m_meshes;
+    bool m_meshed; //every section has been meshed at least once
+    int m_meshedNeighbors; //which neighbors existed at the last full mesh, bit per Direction
+    // where each section's faces live in the vertex buffer, opaque layers in
+    // [0, 16) then clear layers in [16, 32). Sizes are in vertices and include
+    // some slack so edits usually fit where they are
+    struct MeshSlot {
+        int offset, capacity;
+    };
+    std::array<MeshSlot, 32> m_slots;
+    // vertices in each slot's mesh, kept after its cpu copy is freed
+    std::array<int, 32> m_slotSizes;
+    // slots whose cpu copy was freed once it was uploaded, bit per slot.
+    // They only live in the arena, so unbinding loses them
+    uint32_t m_freedSlots;
+    // where the slots live in the ChunkArena, in vertices. Size 0 if nowhere
+    struct ArenaRange {
+        int offset, size;
+    };
+    ArenaRange m_arenaVerts;
+    // reduced detail mesh, opaque vertices then clear ones. Built by createLODdata,
+    // freed once bindLODdata uploads it
+    std::vector<PackedVertex> m_lodMesh;
+    int m_lodMeshOpaque;  //vertices of m_lodMesh in the opaque layer
+    int m_lodMeshLevel;   //level of m_lodMesh, 0 if no mesh is waiting
+    int m_lodMeshVersion; //blocksVersion() it was built from
+    // the uploaded one, laid out the same
+    ArenaRange m_lodArena;
+    int m_lodOpaque, m_lodLevel, m_lodVersion;
+    // each section's visibility as of its last mesh, read while drawing
+    std::array<std::atomic<uint64_t>, 16> m_visibility;
+    // caller holds createVBO_mutex
+    void releaseArena(ChunkArena &arena);
+    void releaseLOD(ChunkArena &arena);
+    void updateGPUBytes();
+    // drops the cpu copy of the slots set in which now that the arena has them, caller holds createVBO_mutex
+    void freeUploaded(uint32_t which);
+
+    // copy of m_neighbors, so meshing doesn't hold neighbor_mutex or allocate
+    NeighborArray neighborSnapshot();
+    // flood fills section s's see through blocks
+    uint64_t computeVisibility(int s) const;
+    // builds section s's faces into out, neighbors is a snapshot of m_neighbors
+    void meshSection(int s, const NeighborArray &neighbors, bool greedy, SectionMesh &out);
+    // stores meshes newer than what we have and returns which sections changed, caller holds createVBO_mutex
+    int commitMeshes(const std::array<SectionMesh, 16> &meshes, int sections);
+    void recountMesh();
 
-    std::mutex setBlock_mutex;
+    mutable std::mutex setBlock_mutex; //blocks and m_changes
     std::mutex createVBO_mutex;
+    // non-generated changes made to terrain
+    vec3Map m_changes;
     std::mutex neighbor_mutex;
 public:
     Chunk(OpenGLContext*);
     Chunk* getNeighborChunk(Direction d);
     BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
     BlockType getBlockAt(int x, int y, int z) const;
+    // no bounds checks or height map offsets, x and z in [0, 16) and y in [0, 256)
+    BlockType getLocalBlock(int x, int y, int z) const;
     void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
-    void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
+    // Bulk writes for generation: one lock per call and no height map offsets.
+    // x and z are chunk local, y ranges are clipped to the chunk.
+    // sets y in [yFrom, yTo) of column (x, z) to t
+    void fillColumn(int x, int z, int yFrom, int yTo, BlockType t);
+    // copies types[0, n) into column (x, z) starting at yFrom
+    void writeColumn(int x, int z, int yFrom, const BlockType* types, int n);
+    void linkNeighbor(Chunk* neighbor, Direction dir);
+    // removes this chunk from its neighbors before it gets evicted
+    void unlinkNeighbors();
+
+    // repacks block storage once generation is done, must be called before other threads can see the chunk
+    void compactBlocks();
+    // bytes used to store blocks, compare against sizeof(BlockType) * 65536 for a flat array
+    size_t memoryUsage() const;
+    // blocks plus the cpu side mesh and change list, what evicting this chunk would free
+    size_t residentMemory();
+    // bytes of mesh still held on the cpu
+    size_t meshMemory();
+
+    // section flags, s is the section index (y / 16)
+    bool sectionAir(int s) const;
+    bool sectionOpaque(int s) const;
+
+    // user changes, kept apart from generated blocks so they survive regeneration.
+    // Edits come in on network threads while saves and eviction read them elsewhere
+    void recordChange(int x, int y, int z, BlockType t);
+    bool hasChange(int x, int y, int z) const;
+    vec3Map changes() const;
+
+    // writes origin, blocks, height map, biome and user changes, air sections are skipped
+    void serialize(QByteArray &out) const;
+    // only for chunks no other thread can see yet, with origin already set. Returns
+    // false on malformed input or a payload saved for another chunk
+    bool deserialize(const QByteArray &in);
 
     virtual void createVBOdata();
+    // rebuilds only the sections in the bitmask (bit s is section s), for block edits.
+    // Returns false if the chunk has no mesh yet, then call createVBOdata instead
+    bool remeshSections(int sections);
+    // remeshes the sections written since they were last meshed, and the ones above and below
+    // them whose faces touch. Falls back to createVBOdata if there is no mesh yet
+    void updateVBOdata();
+    // merge coplanar faces of the same block within each 16^3 section into larger quads,
+    // read at the start of every createVBOdata
+    static std::atomic_bool greedyMeshing;
+    // total time spent in and number of createVBOdata calls, for comparing the two mesher modes
+    static std::atomic<long long> meshNanos;
+    static std::atomic_int meshCount;
+    // times a mesh buffer had to grow, in the scratch space or in a chunk
+    static std::atomic<long long> meshAllocations;
+    // vertices in the last mesh and bytes its buffers take on the gpu
+    std::atomic_int vertexCount;
+    // bit s is set if section s has any faces, bounds the chunk for culling
+    std::atomic_int meshSections;
+    std::atomic_int gpuBytes;
     //locks for multithreading stages
     std::atomic_bool dataBound, dataGen, surfaceGen;
 
@@ -103,16 +255,76 @@ public:
     //for generating structures, don't want to redraw vbo for every single one
     std::atomic_bool blocksChanged;
 
-    void bindVBOdata();
-    void unbindVBOdata();
+    //blocks differ from what was last loaded from or saved to disk
+    std::atomic_bool unsaved;
+
+    //for eviction
+    //queued work that holds a pointer to this chunk, a chunk with jobs is never evicted
+    std::atomic_int jobs;
+    //unlinked from its neighbors, guarded by neighbor_mutex
+    std::atomic_bool evicted;
+    //terrain tick this chunk was last near a player
+    int lastUsed;
+    // world space (x, z) of its lower left corner, set before the chunk goes into the terrain
+    glm::ivec2 origin;
+    // waiting in Terrain's upload queue. Main thread only
+    bool uploadQueued;
+    // Terrain's frame count the last time this chunk was drawn. Main thread only
+    int lastDrawn;
+    // the detail level Terrain last picked for this chunk, 0 is full detail. Main thread only
+    int lod;
+    // call before handing this chunk to a worker, returns false if it is being evicted
+    bool beginJob();
+    void endJob();
+    // takes the chunk for eviction if no job holds it, beginJob fails from then on
+    bool claimEviction();
+
+    // copies the meshes into the arena, where they stay until unbindVBOdata, and frees
+    // them on the cpu. Sections already freed are moved within the arena. Main thread only
+    void bindVBOdata(ChunkArena &arena);
+    // sections remeshed since the last upload, patchVBOdata writes them into the arena
+    std::atomic_int dirtySections;
+    void patchVBOdata(ChunkArena &arena);
+    // about what bindVBOdata, or patchVBOdata if we're bound, would write right now
+    int uploadBytes();
+    // gives the arena space back, sections and reduced detail both
+    void unbindVBOdata(ChunkArena &arena);
+    // gives back just the sections and drops their cpu copy, they have to be meshed again
+    void unbindSections(ChunkArena &arena);
+    // false once unbinding lost the mesh, bindVBOdata would have nothing to upload
+    bool hasMesh();
+    // adds the bit s sections of this chunk at world space (x, z) to the arena's draws this frame
+    void queueDraw(ChunkArena &arena, int x, int z, int sections);
+
+    // Builds the reduced detail mesh for level (1 - LOD_LEVELS) from the blocks.
+    // A cell takes the topmost opaque block in it, or failing that its topmost
+    // clear one, so a coarse surface is never below a finer one. Faces against
+    // neighbors are culled at the same level, except against a neighbor's top
+    // cell: drawn at finer detail it may not fill it, and the face covers the gap
+    void createLODdata(int level);
+    // level of a built mesh waiting for bindLODdata, 0 if none
+    int lodPending();
+    // bytes bindLODdata would write
+    int lodUploadBytes();
+    // uploads the waiting mesh in place of the one bound. Main thread only
+    void bindLODdata(ChunkArena &arena);
+    void unbindLODdata(ChunkArena &arena);
+    // level of the bound reduced detail mesh, 0 if none
+    int lodLevel() const;
+    // blocks changed since the bound reduced detail mesh was built
+    bool lodStale() const;
+    // sum of every section's version, changes with any block
+    int blocksVersion() const;
+    // like queueDraw, for the reduced detail mesh
+    void queueDrawLOD(ChunkArena &arena, int x, int z);
+    // see SectionMesh::visibility. Everything is visible before the first mesh
+    uint64_t sectionVisibility(int s) const;
     virtual GLenum drawMode();
 
 
     //for terrain gen
     BiomeType biome; //biome of chunk, taking 8,8
     int heightMap[16][16]; //height map of surface level ground, to generate surface structs
-    // non-generated changes made to terrain
-    vec3Map m_changes;
 };
 
 bool isTransparent(int x, int y, int z, Chunk* c);
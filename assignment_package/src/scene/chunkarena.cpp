@@ -0,0 +1,286 @@
+#include "chunkarena.h"
+#include "chunk.h"
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+StagingRing::StagingRing(OpenGLContext* context, int size)
+    : mp_context(context), m_buf(0), m_size(size), m_head(0), m_used(0), m_unfenced(0), m_fences()
+{
+    mp_context->glGenBuffers(1, &m_buf);
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, m_buf);
+    mp_context->glBufferData(GL_COPY_READ_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+}
+
+StagingRing::~StagingRing() {
+    for(Fence &f: m_fences) mp_context->glDeleteSync(f.sync);
+    mp_context->glDeleteBuffers(1, &m_buf);
+}
+
+void StagingRing::retire() {
+    while(!m_fences.empty()) {
+        GLenum r = mp_context->glClientWaitSync(m_fences.front().sync, 0, 0);
+        if(r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        mp_context->glDeleteSync(m_fences.front().sync);
+        m_used -= m_fences.front().bytes;
+        m_fences.pop_front();
+    }
+    if(m_used == 0) m_head = 0;
+}
+
+int StagingRing::alloc(int n) {
+    retire();
+    if(n > m_size || m_used + n > m_size) return -1;
+    int tail = (m_head - m_used + m_size) % m_size;
+    int skip = 0;
+    if(m_used > 0 && tail > m_head) {
+        if(n > tail - m_head) return -1;
+    }
+    else if(n > m_size - m_head) {
+        //doesn't fit before the end, the rest of it stays in flight until we're past it
+        if(n > tail) return -1;
+        skip = m_size - m_head;
+        m_head = 0;
+    }
+    int offset = m_head;
+    m_head = (m_head + n) % m_size;
+    m_used += skip + n;
+    m_unfenced += skip + n;
+    return offset;
+}
+
+bool StagingRing::upload(GLuint dst, GLintptr offset, GLsizeiptr n, const void* data) {
+    int at = alloc(n);
+    if(at < 0) return false;
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, m_buf);
+    //nothing the GPU still reads is in [at, at + n), so it needn't wait for it
+    void* p = mp_context->glMapBufferRange(GL_COPY_READ_BUFFER, at, n,
+                                           GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if(p) {
+        std::memcpy(p, data, n);
+        mp_context->glUnmapBuffer(GL_COPY_READ_BUFFER);
+    }
+    else {
+        mp_context->glBufferSubData(GL_COPY_READ_BUFFER, at, n, data);
+    }
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    mp_context->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, at, offset, n);
+    return true;
+}
+
+int StagingRing::available() {
+    retire();
+    if(m_used == m_size) return 0;
+    int tail = (m_head - m_used + m_size) % m_size;
+    if(m_used > 0 && tail > m_head) return tail - m_head;
+    return std::max(m_size - m_head, m_used > 0 ? tail : 0);
+}
+
+bool StagingRing::reserve(int n) {
+    if(n <= 0) return true;
+    //takes the space and gives it straight back, keeping any wrap to the start
+    int at = alloc(n);
+    if(at < 0) return false;
+    m_head = at;
+    m_used -= n;
+    m_unfenced -= n;
+    return true;
+}
+
+void StagingRing::endFrame() {
+    if(m_unfenced == 0) return;
+    m_fences.push_back({mp_context->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_unfenced});
+    m_unfenced = 0;
+}
+
+int StagingRing::size() const {
+    return m_size;
+}
+
+BufferArena::BufferArena(OpenGLContext* context, GLenum target, int elemSize, int capacity, StagingRing* staging)
+    : mp_context(context), m_target(target), m_elemSize(elemSize), m_buf(0),
+      m_capacity(capacity), m_used(0), m_free(), mp_staging(staging)
+{
+    mp_context->glGenBuffers(1, &m_buf);
+    mp_context->glBindBuffer(m_target, m_buf);
+    mp_context->glBufferData(m_target, GLsizeiptr(m_capacity) * m_elemSize, nullptr, GL_DYNAMIC_DRAW);
+    m_free[0] = m_capacity;
+}
+
+BufferArena::~BufferArena() {
+    mp_context->glDeleteBuffers(1, &m_buf);
+}
+
+void BufferArena::grow(int atLeast) {
+    int capacity = m_capacity;
+    while(capacity - m_capacity < atLeast) capacity *= 2;
+    GLuint buf;
+    mp_context->glGenBuffers(1, &buf);
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, buf);
+    mp_context->glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity) * m_elemSize, nullptr, GL_DYNAMIC_DRAW);
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, m_buf);
+    mp_context->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(m_capacity) * m_elemSize);
+    mp_context->glDeleteBuffers(1, &m_buf);
+    m_buf = buf;
+    qDebug() << "geometry arena grew to" << GLsizeiptr(capacity) * m_elemSize / (1 << 20) << "MB";
+
+    release(m_capacity, capacity - m_capacity);
+    m_used += capacity - m_capacity;
+    m_capacity = capacity;
+}
+
+int BufferArena::alloc(int n) {
+    for(auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if(it->second < n) continue;
+        int offset = it->first, left = it->second - n;
+        m_free.erase(it);
+        if(left > 0) m_free[offset + n] = left;
+        m_used += n;
+        return offset;
+    }
+    grow(n);
+    return alloc(n);
+}
+
+void BufferArena::release(int offset, int n) {
+    if(n <= 0) return;
+    m_used -= n;
+    auto next = m_free.lower_bound(offset);
+    if(next != m_free.end() && offset + n == next->first) {
+        n += next->second;
+        next = m_free.erase(next);
+    }
+    if(next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if(prev->first + prev->second == offset) {
+            prev->second += n;
+            return;
+        }
+    }
+    m_free[offset] = n;
+}
+
+void BufferArena::write(int offset, int n, const void* data) {
+    GLsizeiptr bytes = GLsizeiptr(n) * m_elemSize;
+    if(mp_staging && mp_staging->upload(m_buf, GLintptr(offset) * m_elemSize, bytes, data)) return;
+    //the ring is full, this may wait on the GPU
+    mp_context->glBindBuffer(m_target, m_buf);
+    mp_context->glBufferSubData(m_target, GLintptr(offset) * m_elemSize, bytes, data);
+}
+
+void BufferArena::copy(int from, int to, int n) {
+    if(n <= 0) return;
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, m_buf);
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, m_buf);
+    mp_context->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                    GLintptr(from) * m_elemSize, GLintptr(to) * m_elemSize, GLsizeiptr(n) * m_elemSize);
+}
+
+GLuint BufferArena::buffer() const {
+    return m_buf;
+}
+
+int BufferArena::capacity() const {
+    return m_capacity;
+}
+
+int BufferArena::used() const {
+    return m_used;
+}
+
+//about 300 chunks worth of greedy meshes, grows from there
+#define ARENA_VERTICES (1 << 21)
+//a few frames of uploads at Terrain's budget
+#define STAGING_BYTES (16 << 20)
+
+ChunkArena::ChunkArena(OpenGLContext* context)
+    : mp_context(context), m_bufQuadIdx(0), m_bufOrigins(0), m_bufCommands(0), m_origins(), m_opaque(), m_clear(), m_commands(),
+      staging(context, STAGING_BYTES), vertices(context, GL_ARRAY_BUFFER, sizeof(PackedVertex), ARENA_VERTICES, &staging)
+{
+    std::vector<GLushort> idx;
+    idx.reserve(QUAD_BATCH_VERTICES / 4 * 6);
+    for(int q = 0; q < QUAD_BATCH_VERTICES; q += 4) {
+        for(int i: {0, 1, 2, 2, 3, 0}) idx.push_back(q + i);
+    }
+    mp_context->glGenBuffers(1, &m_bufQuadIdx);
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufQuadIdx);
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLushort), idx.data(), GL_STATIC_DRAW);
+
+    mp_context->glGenBuffers(1, &m_bufOrigins);
+    mp_context->glGenBuffers(1, &m_bufCommands);
+}
+
+ChunkArena::~ChunkArena() {
+    mp_context->glDeleteBuffers(1, &m_bufQuadIdx);
+    mp_context->glDeleteBuffers(1, &m_bufOrigins);
+    mp_context->glDeleteBuffers(1, &m_bufCommands);
+}
+
+void ChunkArena::clear() {
+    m_origins.clear();
+    m_opaque.clear();
+    m_clear.clear();
+}
+
+void ChunkArena::addChunk(glm::ivec2 origin) {
+    m_origins.push_back(origin);
+}
+
+void ChunkArena::addRange(RenderLayer layer, int baseVertex, int count) {
+    std::vector<DrawElementsCommand> &out = layer == LAYER_CLEAR ? m_clear : m_opaque;
+    GLuint instance = m_origins.size() - 1;
+    while(count > 0) {
+        int n;
+        DrawElementsCommand* last = out.empty() ? nullptr : &out.back();
+        int lastVerts = last ? last->count / 6 * 4 : 0;
+        if(last && last->baseInstance == instance && last->baseVertex + lastVerts == baseVertex && lastVerts < QUAD_BATCH_VERTICES) {
+            n = std::min(count, QUAD_BATCH_VERTICES - lastVerts);
+            last->count += n / 4 * 6;
+        }
+        else {
+            n = std::min(count, QUAD_BATCH_VERTICES);
+            out.push_back({GLuint(n / 4 * 6), 1, 0, baseVertex, instance});
+        }
+        baseVertex += n;
+        count -= n;
+    }
+}
+
+void ChunkArena::upload() {
+    m_commands.assign(m_opaque.begin(), m_opaque.end());
+    m_commands.insert(m_commands.end(), m_clear.begin(), m_clear.end());
+
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufOrigins);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, m_origins.size() * sizeof(glm::ivec2), m_origins.data(), GL_STREAM_DRAW);
+    mp_context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_bufCommands);
+    mp_context->glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsCommand), m_commands.data(), GL_STREAM_DRAW);
+    mp_context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+GLuint ChunkArena::quadIndexBuffer() const {
+    return m_bufQuadIdx;
+}
+
+GLuint ChunkArena::originBuffer() const {
+    return m_bufOrigins;
+}
+
+GLuint ChunkArena::commandBuffer() const {
+    return m_bufCommands;
+}
+
+const std::vector<DrawElementsCommand>& ChunkArena::commands() const {
+    return m_commands;
+}
+
+int ChunkArena::opaqueDraws() const {
+    return m_opaque.size();
+}
+
+const std::vector<glm::ivec2>& ChunkArena::origins() const {
+    return m_origins;
+}
+
+int ChunkArena::chunks() const {
+    return m_origins.size();
+}
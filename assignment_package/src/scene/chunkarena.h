@@ -0,0 +1,136 @@
+#pragma once
+#include "openglcontext.h"
+#include "glm_includes.h"
+#include "blockregistry.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+// One persistent buffer that uploads are copied through, so writing into
+// buffers the GPU may still be drawing from never waits on it. Space is handed
+// out in order and wraps around. endFrame() fences what the frame wrote, and
+// that space comes back once the GPU is past the fence; nothing here ever
+// blocks on one.
+class StagingRing {
+private:
+    OpenGLContext* mp_context;
+    GLuint m_buf;
+    int m_size;
+    int m_head;     //where the next write goes
+    int m_used;     //bytes in flight ending at m_head, including any end skipped on a wrap
+    int m_unfenced; //of those, written since the last endFrame
+    struct Fence {
+        GLsync sync;
+        int bytes;
+    };
+    std::deque<Fence> m_fences; //oldest first
+
+    // gives back the space of every fence the GPU is past
+    void retire();
+    // offset of n free bytes, -1 if the GPU is still reading that much
+    int alloc(int n);
+public:
+    StagingRing(OpenGLContext* context, int size);
+    ~StagingRing();
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // copies n bytes of data to offset in dst. Returns false having done
+    // nothing if there isn't room for it without waiting
+    bool upload(GLuint dst, GLintptr offset, GLsizeiptr n, const void* data);
+    // biggest upload that would go through right now
+    int available();
+    // makes the next n bytes of uploads land in one stretch of the ring, so
+    // several writes adding up to n go through. False if there's no such room
+    bool reserve(int n);
+    void endFrame();
+    int size() const;
+};
+
+// A GL buffer handed out in ranges. Sizes and offsets are in elements of a
+// fixed size, allocated first fit from a free list. Running out doubles the
+// buffer and copies it over on the GPU, so handed out offsets stay valid.
+class BufferArena {
+private:
+    OpenGLContext* mp_context;
+    GLenum m_target;
+    int m_elemSize;
+    GLuint m_buf;
+    int m_capacity, m_used;
+    std::map<int, int> m_free; //offset -> size of every free range, touching ranges always merged
+    StagingRing* mp_staging;   //writes go through this when it has room
+
+    void grow(int atLeast);
+public:
+    BufferArena(OpenGLContext* context, GLenum target, int elemSize, int capacity, StagingRing* staging = nullptr);
+    ~BufferArena();
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+
+    // offset of n elements nobody else has
+    int alloc(int n);
+    void release(int offset, int n);
+    void write(int offset, int n, const void* data);
+    // copies n elements from one range of the buffer to another on the GPU, they mustn't overlap
+    void copy(int from, int to, int n);
+
+    GLuint buffer() const;
+    int capacity() const;
+    int used() const;
+};
+
+// laid out the way glMultiDrawElementsIndirect reads it
+struct DrawElementsCommand {
+    GLuint count, instanceCount, firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Chunk faces are all quads of 4 vertices in order, so their indices are the
+// same 0 1 2 2 3 0 pattern everywhere. One static 16 bit buffer of it is shared
+// by every draw; a draw covers at most this many vertices past its base vertex
+#define QUAD_BATCH_VERTICES 65536
+
+// The geometry of every chunk in one vertex buffer, so the terrain draws with
+// one glMultiDrawElementsIndirect per layer instead of a draw per chunk.
+// Every frame, clear(), queue the chunks with Chunk::queueDraw, upload(),
+// then ShaderProgram::drawChunks.
+// A draw finds its chunk's origin through baseInstance, which picks its entry
+// out of an instanced attribute, so nothing changes between draws.
+// Vertices are written through staging; call staging.endFrame() once a frame
+// after the last of them.
+class ChunkArena {
+private:
+    OpenGLContext* mp_context;
+    GLuint m_bufQuadIdx, m_bufOrigins, m_bufCommands;
+    std::vector<glm::ivec2> m_origins;
+    // opaque draws, then clear draws so water blends over everything opaque
+    std::vector<DrawElementsCommand> m_opaque, m_clear;
+    std::vector<DrawElementsCommand> m_commands; //both lists, as uploaded
+public:
+    StagingRing staging;
+    BufferArena vertices; //PackedVertex
+
+    ChunkArena(OpenGLContext* context);
+    ~ChunkArena();
+    ChunkArena(const ChunkArena&) = delete;
+    ChunkArena& operator=(const ChunkArena&) = delete;
+
+    void clear();
+    // starts a chunk at origin, the ranges added after it are drawn there
+    void addChunk(glm::ivec2 origin);
+    // count vertices of the last chunk from baseVertex on, in the given layer. Ranges that
+    // pick up where the last one ended share its draw, up to QUAD_BATCH_VERTICES
+    void addRange(RenderLayer layer, int baseVertex, int count);
+    void upload();
+
+    // GLushort quad indices for up to QUAD_BATCH_VERTICES vertices
+    GLuint quadIndexBuffer() const;
+    GLuint originBuffer() const;
+    GLuint commandBuffer() const;
+    // commands as uploaded, opaque draws are [0, opaqueDraws())
+    const std::vector<DrawElementsCommand>& commands() const;
+    int opaqueDraws() const;
+    const std::vector<glm::ivec2>& origins() const;
+    int chunks() const;
+};
@@ -0,0 +1,275 @@
+#include "chunkmap.h"
+#include "terrain.h"
+#include <QDebug>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <cmath>
+
+#define INITIAL_BITS 10
+
+ChunkMap::Node ChunkMap::s_tombstone = {0, 0, 0, nullptr};
+
+ChunkMap::Table::Table(unsigned int bits)
+    : shift(64 - bits), mask((size_t(1) << bits) - 1), cells(new std::atomic<Node*>[size_t(1) << bits])
+{
+    for(size_t i = 0; i <= mask; i++) {
+        cells[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// fibonacci hashing spreads the morton code over the whole table
+size_t ChunkMap::Table::index(uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15ull) >> shift;
+}
+
+ChunkMap::ChunkMap()
+    : m_table(new Table(INITIAL_BITS)), m_size(0), m_write_mutex(), m_used(0)
+{}
+
+ChunkMap::~ChunkMap() {
+    Table* t = m_table.load();
+    for(size_t i = 0; i <= t->mask; i++) {
+        Node* n = t->cells[i].load();
+        if(n && n != &s_tombstone) delete n;
+    }
+    delete t;
+}
+
+// spreads the bits of v out to the even bit positions
+static uint64_t spreadBits(uint32_t v) {
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+}
+
+// interleaves the chunk indices, the sign bit is flipped so negative chunks sort below positive ones
+uint64_t ChunkMap::morton(int x, int z) {
+    uint32_t cx = uint32_t(x >> 4) ^ 0x80000000u;
+    uint32_t cz = uint32_t(z >> 4) ^ 0x80000000u;
+    return spreadBits(cx) | (spreadBits(cz) << 1);
+}
+
+ChunkMap::Node* ChunkMap::lookup(const Table* t, uint64_t key) const {
+    for(size_t i = t->index(key);; i = (i + 1) & t->mask) {
+        Node* n = t->cells[i].load(std::memory_order_acquire);
+        if(n == nullptr) return nullptr;
+        if(n != &s_tombstone && n->key == key) return n;
+    }
+}
+
+Chunk* ChunkMap::find(int x, int z) const {
+    Epoch::Guard g;
+    Node* n = lookup(m_table.load(std::memory_order_acquire), morton(x, z));
+    return n ? n->chunk.get() : nullptr;
+}
+
+// builds a fresh table sized for live entries and drops the tombstones, caller holds m_write_mutex
+void ChunkMap::rehash(size_t live) {
+    Table* old = m_table.load(std::memory_order_relaxed);
+    unsigned int bits = INITIAL_BITS;
+    while((size_t(1) << bits) < live * 4) bits++;
+    Table* t = new Table(bits);
+    for(size_t i = 0; i <= old->mask; i++) {
+        Node* n = old->cells[i].load(std::memory_order_relaxed);
+        if(n == nullptr || n == &s_tombstone) continue;
+        size_t j = t->index(n->key);
+        while(t->cells[j].load(std::memory_order_relaxed) != nullptr) j = (j + 1) & t->mask;
+        t->cells[j].store(n, std::memory_order_relaxed);
+    }
+    m_table.store(t, std::memory_order_release);
+    m_used = live;
+    //readers may still be probing the old table, the nodes themselves carry over
+    Epoch::get().retire([old]() { delete old; });
+}
+
+// finds where key lives or should go, caller holds m_write_mutex.
+// Returns the slot index, *out_found is the node already there or nullptr
+size_t ChunkMap::probe(uint64_t key, Node** out_found) {
+    Table* t = m_table.load(std::memory_order_relaxed);
+    if((m_used + 1) * 2 > t->mask + 1) {
+        rehash(m_size.load(std::memory_order_relaxed) + 1);
+        t = m_table.load(std::memory_order_relaxed);
+    }
+    size_t free = t->mask + 1;
+    for(size_t i = t->index(key);; i = (i + 1) & t->mask) {
+        Node* cur = t->cells[i].load(std::memory_order_relaxed);
+        if(cur == nullptr) {
+            *out_found = nullptr;
+            return free > t->mask ? i : free;
+        }
+        if(cur == &s_tombstone) {
+            if(free > t->mask) free = i;
+            continue;
+        }
+        if(cur->key == key) {
+            *out_found = cur;
+            return i;
+        }
+    }
+}
+
+// publishes n into an empty or tombstone slot, caller holds m_write_mutex
+void ChunkMap::place(size_t i, Node* n) {
+    Table* t = m_table.load(std::memory_order_relaxed);
+    if(t->cells[i].load(std::memory_order_relaxed) == nullptr) m_used++;
+    t->cells[i].store(n, std::memory_order_release);
+    m_size.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ChunkMap::insert(int x, int z, uPtr<Chunk> chunk) {
+    x = 16 * int(std::floor(x / 16.f));
+    z = 16 * int(std::floor(z / 16.f));
+    Node* n = new Node{x, z, morton(x, z), std::move(chunk)};
+
+    m_write_mutex.lock();
+    Node* cur;
+    size_t i = probe(n->key, &cur);
+    if(cur) {
+        //swap in the new node, the old chunk dies once no reader can hold it
+        m_table.load(std::memory_order_relaxed)->cells[i].store(n, std::memory_order_release);
+        m_write_mutex.unlock();
+        Epoch::get().retire([cur]() { delete cur; });
+        return;
+    }
+    place(i, n);
+    m_write_mutex.unlock();
+}
+
+Chunk* ChunkMap::insertIfAbsent(int x, int z, uPtr<Chunk> chunk) {
+    x = 16 * int(std::floor(x / 16.f));
+    z = 16 * int(std::floor(z / 16.f));
+    uint64_t key = morton(x, z);
+
+    m_write_mutex.lock();
+    Node* cur;
+    size_t i = probe(key, &cur);
+    if(cur) {
+        m_write_mutex.unlock();
+        return cur->chunk.get();
+    }
+    Node* n = new Node{x, z, key, std::move(chunk)};
+    place(i, n);
+    m_write_mutex.unlock();
+    return n->chunk.get();
+}
+
+bool ChunkMap::erase(int x, int z) {
+    uint64_t key = morton(x, z);
+    m_write_mutex.lock();
+    Table* t = m_table.load(std::memory_order_relaxed);
+    Node* cur = lookup(t, key);
+    if(cur == nullptr) {
+        m_write_mutex.unlock();
+        return false;
+    }
+    for(size_t i = t->index(key);; i = (i + 1) & t->mask) {
+        if(t->cells[i].load(std::memory_order_relaxed) == cur) {
+            //probes for other keys still have to walk past this slot
+            t->cells[i].store(&s_tombstone, std::memory_order_release);
+            break;
+        }
+    }
+    m_size.fetch_sub(1, std::memory_order_relaxed);
+    m_write_mutex.unlock();
+    Epoch::get().retire([cur]() { delete cur; });
+    return true;
+}
+
+size_t ChunkMap::size() const {
+    return m_size.load(std::memory_order_relaxed);
+}
+
+void ChunkMap::forEach(const std::function<void(int, int, Chunk*)> &f) const {
+    Epoch::Guard g;
+    const Table* t = m_table.load(std::memory_order_acquire);
+    for(size_t i = 0; i <= t->mask; i++) {
+        Node* n = t->cells[i].load(std::memory_order_acquire);
+        if(n == nullptr || n == &s_tombstone) continue;
+        f(n->x, n->z, n->chunk.get());
+    }
+}
+
+#define BENCH_WRITERS 8
+#define BENCH_CHUNKS_PER_WRITER 2048
+#define BENCH_LOOKUPS_PER_CHUNK 64
+
+// 8 generation threads insert chunks while a render thread keeps scanning the
+// loaded area. Generation also looks up neighbors constantly (every setBlockAt
+// goes through hasChunkAt), so each insert comes with a batch of lookups too.
+template<typename Insert, typename Find>
+static void benchMap(const char* name, Insert insert, Find find) {
+    int radius = int(std::sqrt(float(BENCH_WRITERS * BENCH_CHUNKS_PER_WRITER))) / 2 + 1;
+    std::atomic_bool done(false);
+    std::atomic<long> renderReads(0), found(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> writers;
+    for(int w = 0; w < BENCH_WRITERS; w++) {
+        writers.emplace_back([&, w]() {
+            long n = 0;
+            for(int i = 0; i < BENCH_CHUNKS_PER_WRITER; i++) {
+                int c = w * BENCH_CHUNKS_PER_WRITER + i;
+                int x = 16 * (c % (2 * radius) - radius), z = 16 * (c / (2 * radius) - radius);
+                insert(x, z);
+                for(int j = 0; j < BENCH_LOOKUPS_PER_CHUNK; j++) {
+                    if(find(x + 16 * (j % 3 - 1), z + 16 * (j / 3 % 3 - 1))) n++;
+                }
+            }
+            found.fetch_add(n);
+        });
+    }
+    std::thread render([&]() {
+        long n = 0, reads = 0;
+        while(!done.load()) {
+            for(int x = -radius; x < radius; x++) {
+                for(int z = -radius; z < radius; z++) {
+                    if(find(16 * x, 16 * z)) n++;
+                }
+            }
+            reads += 4 * radius * radius;
+        }
+        renderReads.store(reads);
+        found.fetch_add(n);
+    });
+    for(std::thread &t: writers) t.join();
+    double genMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    done = true;
+    render.join();
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    long genOps = long(BENCH_WRITERS) * BENCH_CHUNKS_PER_WRITER * (1 + BENCH_LOOKUPS_PER_CHUNK);
+    qDebug() << name << ":" << genMs << "ms for generation threads,"
+             << genOps / genMs * 1000 << "gen ops/sec,"
+             << renderReads.load() / totalMs * 1000 << "render lookups/sec";
+}
+
+void chunkMapBench() {
+    //old terrain map
+    {
+        std::unordered_map<int64_t, uPtr<Chunk>> map;
+        std::mutex mutex;
+        benchMap("mutex unordered_map",
+                 [&](int x, int z) {
+                     mutex.lock();
+                     map[toKey(x, z)] = mkU<Chunk>(nullptr);
+                     mutex.unlock();
+                 },
+                 [&](int x, int z) {
+                     mutex.lock();
+                     bool b = map.find(toKey(x, z)) != map.end();
+                     mutex.unlock();
+                     return b;
+                 });
+    }
+    //lock free map
+    {
+        ChunkMap map;
+        benchMap("lock free ChunkMap",
+                 [&](int x, int z) { map.insert(x, z, mkU<Chunk>(nullptr)); },
+                 [&](int x, int z) { return map.find(x, z) != nullptr; });
+    }
+    Epoch::get().collect();
+}
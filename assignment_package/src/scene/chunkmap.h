@@ -0,0 +1,65 @@
+#pragma once
+#include "chunk.h"
+#include "epoch.h"
+#include "smartpointerhelp.h"
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+// Concurrent hash map from chunk coordinates to Chunks.
+// Open addressing with linear probing over an array of node pointers.
+// Lookups never lock: they pin the epoch, probe and return. Inserts and
+// erases serialize on a writer mutex, publish with atomic stores and
+// retire replaced nodes and outgrown tables through Epoch.
+// Keys are the Morton code of the chunk coordinates so neighboring
+// chunks hash from nearby keys.
+class ChunkMap {
+private:
+    struct Node {
+        int x, z; //chunk corner in world space
+        uint64_t key;
+        uPtr<Chunk> chunk;
+    };
+
+    struct Table {
+        unsigned int shift; //64 - log2(capacity)
+        size_t mask;
+        uPtr<std::atomic<Node*>[]> cells;
+        Table(unsigned int bits);
+        size_t index(uint64_t key) const;
+    };
+
+    std::atomic<Table*> m_table;
+    std::atomic<size_t> m_size;
+
+    std::mutex m_write_mutex;
+    size_t m_used; //live nodes + tombstones, guarded by m_write_mutex
+
+    static Node s_tombstone;
+
+    Node* lookup(const Table* t, uint64_t key) const;
+    void rehash(size_t live);
+    size_t probe(uint64_t key, Node** out_found);
+    void place(size_t i, Node* n);
+public:
+    ChunkMap();
+    ~ChunkMap();
+
+    static uint64_t morton(int x, int z);
+
+    // x and z are any world space coordinates inside the chunk
+    Chunk* find(int x, int z) const;
+    // replaces any chunk already stored there
+    void insert(int x, int z, uPtr<Chunk> chunk);
+    // keeps the chunk already stored there if there is one, returns whichever chunk ends up in the map
+    Chunk* insertIfAbsent(int x, int z, uPtr<Chunk> chunk);
+    // unlinks the chunk, it is freed once no pinned reader can still hold it. Returns false if missing
+    bool erase(int x, int z);
+
+    size_t size() const;
+    // visits every chunk with its corner coordinates
+    void forEach(const std::function<void(int, int, Chunk*)> &f) const;
+};
+
+// times m_chunks-style lookups and inserts with a mutex-guarded unordered_map against ChunkMap
+void chunkMapBench();
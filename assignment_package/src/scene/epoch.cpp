@@ -0,0 +1,109 @@
+#include "epoch.h"
+
+// per thread pin state, the record goes back to the pool when the thread exits
+struct EpochThread {
+    Epoch::Record* record = nullptr;
+    int depth = 0;
+    ~EpochThread() {
+        if(record) {
+            record->state.store(0);
+            record->inUse.store(false);
+        }
+    }
+};
+
+static thread_local EpochThread t_epoch;
+
+Epoch::Epoch() : m_global(0), m_records(nullptr), m_retired_mutex(), m_retired()
+{}
+
+Epoch::~Epoch() {
+    for(auto &r: m_retired) {
+        r.second();
+    }
+    Record* r = m_records.load();
+    while(r) {
+        Record* next = r->next;
+        delete r;
+        r = next;
+    }
+}
+
+Epoch& Epoch::get() {
+    static Epoch epoch;
+    return epoch;
+}
+
+Epoch::Record* Epoch::acquireRecord() {
+    //reuse a record left behind by a finished thread if possible
+    for(Record* r = m_records.load(); r; r = r->next) {
+        bool free = false;
+        if(r->inUse.compare_exchange_strong(free, true)) return r;
+    }
+    Record* r = new Record();
+    r->state = 0;
+    r->inUse = true;
+    r->next = m_records.load();
+    while(!m_records.compare_exchange_weak(r->next, r));
+    return r;
+}
+
+Epoch::Guard::Guard() {
+    EpochThread &t = t_epoch;
+    if(t.depth++ == 0) {
+        Epoch &e = Epoch::get();
+        if(!t.record) t.record = e.acquireRecord();
+        t.record->state.store(e.m_global.load() << 1 | 1);
+    }
+}
+
+Epoch::Guard::~Guard() {
+    EpochThread &t = t_epoch;
+    if(--t.depth == 0) {
+        t.record->state.store(0, std::memory_order_release);
+    }
+}
+
+bool Epoch::tryAdvance() {
+    uint64_t g = m_global.load();
+    for(Record* r = m_records.load(); r; r = r->next) {
+        uint64_t s = r->state.load();
+        if(r->inUse.load() && (s & 1) && (s >> 1) != g) return false;
+    }
+    return m_global.compare_exchange_strong(g, g + 1);
+}
+
+void Epoch::retire(std::function<void()> deleter) {
+    m_retired_mutex.lock();
+    m_retired.emplace_back(m_global.load(), std::move(deleter));
+    m_retired_mutex.unlock();
+    collect();
+}
+
+void Epoch::collect() {
+    std::vector<std::function<void()>> ready;
+    m_retired_mutex.lock();
+    tryAdvance();
+    uint64_t g = m_global.load();
+    auto keep = m_retired.begin();
+    for(auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+        if(it->first + 2 <= g) ready.emplace_back(std::move(it->second));
+        else {
+            if(keep != it) *keep = std::move(*it);
+            ++keep;
+        }
+    }
+    m_retired.erase(keep, m_retired.end());
+    m_retired_mutex.unlock();
+    //run deleters outside the lock in case they retire more
+    for(auto &d: ready) {
+        d();
+    }
+}
+
+size_t Epoch::pending() {
+    m_retired_mutex.lock();
+    size_t n = m_retired.size();
+    m_retired_mutex.unlock();
+    return n;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// Epoch based reclamation.
+// Readers pin the current epoch while they hold pointers into a shared structure,
+// writers retire unlinked objects instead of deleting them. A retired object is
+// deleted once the global epoch has moved two steps past the one it was retired in,
+// since by then every thread that could have seen it has unpinned.
+class Epoch {
+private:
+    struct Record {
+        // pinned epoch << 1 | 1 while pinned, 0 otherwise. One word so pinning is a single store
+        std::atomic<uint64_t> state;
+        std::atomic_bool inUse;
+        Record* next;
+    };
+
+    std::atomic<uint64_t> m_global;
+    std::atomic<Record*> m_records;
+
+    std::mutex m_retired_mutex;
+    std::vector<std::pair<uint64_t, std::function<void()>>> m_retired;
+
+    Epoch();
+    Record* acquireRecord();
+    bool tryAdvance();
+
+    friend struct EpochThread;
+public:
+    ~Epoch();
+    static Epoch& get();
+
+    // Pins the calling thread for the guard's lifetime, nests freely
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // deleter runs once no pinned reader can still see the object
+    void retire(std::function<void()> deleter);
+    // frees whatever is safe to free now
+    void collect();
+    // number of retired objects waiting to be freed
+    size_t pending();
+};
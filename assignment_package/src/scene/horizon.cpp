@@ -0,0 +1,196 @@
+#include "horizon.h"
+#include "terrain.h"
+#include "runnables.h"
+#include <algorithm>
+#include <climits>
+
+#define HORIZON_VERTS (HORIZON_SAMPLES * HORIZON_SAMPLES)
+#define HORIZON_INDICES ((HORIZON_SAMPLES - 1) * (HORIZON_SAMPLES - 1) * 6)
+//tiles sit this far under the surface so real chunks win wherever both are drawn
+#define HORIZON_SINK 2
+//tile requests out at once, keeps a teleport from queueing the whole grid
+#define HORIZON_IN_FLIGHT 64
+#define NO_ZONE INT64_MIN
+
+static const glm::vec3 biomeColors[] = {
+    glm::vec3(220, 230, 235) / 255.f, //TUNDRA
+    glm::vec3(110, 170, 70) / 255.f,  //PLAINS
+    glm::vec3(220, 205, 140) / 255.f, //DESERT
+    glm::vec3(60, 110, 80) / 255.f,   //TAIGA
+    glm::vec3(170, 165, 80) / 255.f,  //SAVANNA
+    glm::vec3(60, 130, 50) / 255.f,   //FOREST
+    glm::vec3(80, 100, 60) / 255.f,   //SWAMP
+    glm::vec3(40, 120, 40) / 255.f,   //RAINFOREST
+    glm::vec3(50, 90, 200) / 255.f,   //RIVER
+    glm::vec3(225, 215, 160) / 255.f, //BEACH
+    glm::vec3(40, 70, 170) / 255.f,   //OCEAN
+    glm::vec3(255, 0, 255) / 255.f    //TEST_BIOME
+};
+
+static const glm::vec3 lightDir = glm::normalize(glm::vec3(0.5, 1, 0.3));
+
+static int slotOf(int zx, int zz) {
+    int sx = zx % HORIZON_GRID, sz = zz % HORIZON_GRID;
+    if(sx < 0) sx += HORIZON_GRID;
+    if(sz < 0) sz += HORIZON_GRID;
+    return sx + sz * HORIZON_GRID;
+}
+
+// zone offsets covering the grid, nearest ring first so close tiles are asked for first
+static const std::vector<glm::ivec2>& windowOrder() {
+    static std::vector<glm::ivec2> order;
+    if(order.empty()) {
+        for(int dz = -HORIZON_GRID/2; dz < HORIZON_GRID/2; dz++) {
+            for(int dx = -HORIZON_GRID/2; dx < HORIZON_GRID/2; dx++) {
+                order.emplace_back(dx, dz);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [](glm::ivec2 a, glm::ivec2 b) {
+            return glm::max(glm::abs(a.x), glm::abs(a.y)) < glm::max(glm::abs(b.x), glm::abs(b.y));
+        });
+    }
+    return order;
+}
+
+Horizon::Horizon(OpenGLContext* context)
+    : Drawable(context), m_workers(), m_finishedLock(), m_finished(), m_pending(), m_slotZone(), m_tiles(0)
+{
+    //stays out of the way of chunk generation, the horizon can lag behind
+    m_workers.setMaxThreadCount(2);
+}
+
+Horizon::~Horizon() {
+    m_workers.clear();
+    m_workers.waitForDone();
+}
+
+void Horizon::createVBOdata() {
+    int count = HORIZON_GRID * HORIZON_GRID;
+    std::vector<GLuint> idx;
+    idx.reserve(count * HORIZON_INDICES);
+    for(int s = 0; s < count; s++) {
+        GLuint base = s * HORIZON_VERTS;
+        for(int j = 0; j < HORIZON_SAMPLES - 1; j++) {
+            for(int i = 0; i < HORIZON_SAMPLES - 1; i++) {
+                GLuint v = base + i + j * HORIZON_SAMPLES;
+                idx.insert(idx.end(), {v, v + HORIZON_SAMPLES, v + HORIZON_SAMPLES + 1,
+                                       v, v + HORIZON_SAMPLES + 1, v + 1});
+            }
+        }
+    }
+    m_count = idx.size();
+
+    //empty slots are all zero, degenerate triangles that rasterize nothing
+    std::vector<glm::vec4> zero(count * HORIZON_VERTS, glm::vec4(0));
+
+    generateIdx();
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+    generatePos();
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, zero.size() * sizeof(glm::vec4), zero.data(), GL_DYNAMIC_DRAW);
+    generateCol();
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufCol);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, zero.size() * sizeof(glm::vec4), zero.data(), GL_DYNAMIC_DRAW);
+
+    m_slotZone.assign(count, NO_ZONE);
+    m_tiles = 0;
+}
+
+GLenum Horizon::drawMode() {
+    return GL_TRIANGLES;
+}
+
+void Horizon::buildTile(int zx, int zz) {
+    //one sample of border on every side so edge normals match the neighboring tile
+    const int n = HORIZON_SAMPLES + 2;
+    int x0 = zx * HORIZON_ZONE - HORIZON_STEP, z0 = zz * HORIZON_ZONE - HORIZON_STEP;
+    std::vector<Ground> grid;
+    grid.reserve(n * n);
+    for(int j = 0; j < n; j++) {
+        for(int i = 0; i < n; i++) {
+            grid.push_back(groundAt(x0 + i * HORIZON_STEP, z0 + j * HORIZON_STEP));
+        }
+    }
+
+    Tile t{zx, zz, {}, {}};
+    t.pos.reserve(HORIZON_VERTS);
+    t.col.reserve(HORIZON_VERTS);
+    for(int j = 1; j <= HORIZON_SAMPLES; j++) {
+        for(int i = 1; i <= HORIZON_SAMPLES; i++) {
+            const Ground &g = grid[i + j * n];
+            float y = g.height - HORIZON_SINK;
+            t.pos.emplace_back(x0 + i * HORIZON_STEP, y, z0 + j * HORIZON_STEP, 1);
+
+            float dx = grid[i + 1 + j * n].height - grid[i - 1 + j * n].height;
+            float dz = grid[i + (j + 1) * n].height - grid[i + (j - 1) * n].height;
+            glm::vec3 nor = glm::normalize(glm::vec3(-dx, 2 * HORIZON_STEP, -dz));
+            float light = 0.6f + 0.4f * glm::max(glm::dot(nor, lightDir), 0.f);
+            t.col.emplace_back(biomeColors[g.biome] * light, 1);
+        }
+    }
+
+    m_finishedLock.lock();
+    m_finished.push_back(std::move(t));
+    m_finishedLock.unlock();
+}
+
+void Horizon::clearSlot(int slot) {
+    static const std::vector<glm::vec4> zero(HORIZON_VERTS, glm::vec4(0));
+    mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
+    mp_context->glBufferSubData(GL_ARRAY_BUFFER, slot * HORIZON_VERTS * sizeof(glm::vec4), HORIZON_VERTS * sizeof(glm::vec4), zero.data());
+    m_slotZone[slot] = NO_ZONE;
+    m_tiles--;
+}
+
+void Horizon::update(glm::vec3 eye, int nearZones) {
+    if(m_slotZone.empty()) return;
+    int czx = glm::floor(eye.x / HORIZON_ZONE);
+    int czz = glm::floor(eye.z / HORIZON_ZONE);
+
+    m_finishedLock.lock();
+    std::vector<Tile> done;
+    done.swap(m_finished);
+    m_finishedLock.unlock();
+
+    for(Tile &t : done) {
+        int64_t key = toKey(t.zx, t.zz);
+        m_pending.erase(key);
+        int dx = t.zx - czx, dz = t.zz - czz;
+        //the player moved on while it was being built
+        if(dx < -HORIZON_GRID/2 || dx >= HORIZON_GRID/2 || dz < -HORIZON_GRID/2 || dz >= HORIZON_GRID/2) continue;
+        if(glm::max(glm::abs(dx), glm::abs(dz)) < nearZones) continue;
+
+        int slot = slotOf(t.zx, t.zz);
+        GLintptr offset = slot * HORIZON_VERTS * sizeof(glm::vec4);
+        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
+        mp_context->glBufferSubData(GL_ARRAY_BUFFER, offset, HORIZON_VERTS * sizeof(glm::vec4), t.pos.data());
+        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufCol);
+        mp_context->glBufferSubData(GL_ARRAY_BUFFER, offset, HORIZON_VERTS * sizeof(glm::vec4), t.col.data());
+        if(m_slotZone[slot] == NO_ZONE) m_tiles++;
+        m_slotZone[slot] = key;
+    }
+
+    for(glm::ivec2 d : windowOrder()) {
+        int zx = czx + d.x, zz = czz + d.y;
+        int slot = slotOf(zx, zz);
+        int64_t key = toKey(zx, zz);
+        int ring = glm::max(glm::abs(d.x), glm::abs(d.y));
+        //the outermost generated ring keeps its tile as a stand-in until its chunks come in
+        if(ring < nearZones) {
+            if(m_slotZone[slot] != NO_ZONE) clearSlot(slot);
+            continue;
+        }
+        if(m_slotZone[slot] == key) continue;
+        //wrapped around, whatever it held is now on the other side of the grid
+        if(m_slotZone[slot] != NO_ZONE) clearSlot(slot);
+        if(ring > nearZones && !m_pending.count(key) && m_pending.size() < HORIZON_IN_FLIGHT) {
+            m_pending.insert(key);
+            m_workers.start(new HorizonWorker(this, zx, zz));
+        }
+    }
+}
+
+int Horizon::tiles() const {
+    return m_tiles;
+}
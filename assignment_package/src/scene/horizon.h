@@ -0,0 +1,52 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <unordered_set>
+#include <QThreadPool>
+#include "drawable.h"
+#include "glm_includes.h"
+
+//blocks per side of a horizon tile, same as a generation zone
+#define HORIZON_ZONE 64
+//blocks between heightmap samples
+#define HORIZON_STEP 16
+#define HORIZON_SAMPLES (HORIZON_ZONE / HORIZON_STEP + 1)
+//zones per side of the square the horizon covers, centered on the player
+#define HORIZON_GRID 48
+
+// Heightmap-only stand-in for the world past the generated terrain. One coarse
+// tile per 64x64 zone, built straight from groundAt so it never waits on caves,
+// structures or meshing. Tiles live in fixed slots of a single buffer, zone
+// (zx, zz) in slot (zx mod HORIZON_GRID, zz mod HORIZON_GRID), so moving only
+// rewrites the slots that wrapped around and all of it draws in one call
+class Horizon : public Drawable {
+public:
+    struct Tile {
+        int zx, zz;
+        std::vector<glm::vec4> pos, col;
+    };
+
+    Horizon(OpenGLContext* context);
+    ~Horizon();
+
+    void createVBOdata() override;
+    GLenum drawMode() override;
+
+    // uploads finished tiles and asks for the ones the player now needs. Zones
+    // within nearZones of the player's are left to real chunks
+    void update(glm::vec3 eye, int nearZones);
+    // worker side, samples zone (zx, zz) and hands it to the next update
+    void buildTile(int zx, int zz);
+    // slots holding a tile
+    int tiles() const;
+
+private:
+    QThreadPool m_workers;
+    std::mutex m_finishedLock;
+    std::vector<Tile> m_finished;
+    std::unordered_set<int64_t> m_pending; //requested and not uploaded yet, main thread only
+    std::vector<int64_t> m_slotZone; //zone key each slot holds, NO_ZONE when empty
+    int m_tiles;
+
+    void clearSlot(int slot);
+};
@@ -0,0 +1,135 @@
+#include "jobqueue.h"
+#include <algorithm>
+
+//jobs for chunks closer than this count as in view whichever way the player faces
+#define NEAR_RADIUS 48
+//cosine of the half angle counted as in view, wider than the frustum so chunks
+//straddling its edge and a quick turn are covered
+#define VIEW_COS 0.5f
+//puts every job out of view behind every job in view
+#define OUT_OF_VIEW 1e6f
+
+// one per queued job, runs whichever job is best when a thread picks it up
+class JobRunner: public QRunnable {
+private:
+    JobQueue* q;
+public:
+    JobRunner(JobQueue* q):q(q){}
+
+    void run() {
+        QRunnable* r = q->take();
+        if(!r) return;
+        r->run();
+        if(r->autoDelete()) delete r;
+        q->finished();
+    }
+};
+
+// lower runs first: the visible frontier nearest first, then everything else nearest first
+static float priority(glm::vec2 center, glm::vec2 eye, glm::vec2 forward) {
+    glm::vec2 to = center - eye;
+    float dist = glm::length(to);
+    bool inView = dist < NEAR_RADIUS || forward == glm::vec2(0) || glm::dot(to, forward) > VIEW_COS * dist;
+    return inView ? dist : dist + OUT_OF_VIEW;
+}
+
+// by whichever eye ranks it first
+static float priority(glm::vec2 center, const std::vector<glm::vec2> &eyes, glm::vec2 forward) {
+    if(eyes.empty()) return 0;
+    float best = priority(center, eyes[0], forward);
+    for(size_t i = 1; i < eyes.size(); i++) {
+        best = std::min(best, priority(center, eyes[i], forward));
+    }
+    return best;
+}
+
+JobQueue::JobQueue()
+    : m_pool(), m_lock(), m_jobs(), m_running(0), m_eyes(1, glm::vec2(0)), m_forward(0), m_busySince(std::chrono::steady_clock::now())
+{}
+
+JobQueue::~JobQueue() {
+    m_lock.lock();
+    for(Job &j : m_jobs) {
+        if(j.r->autoDelete()) delete j.r;
+    }
+    m_jobs.clear();
+    m_lock.unlock();
+    //the runners left find nothing to take
+    m_pool.waitForDone();
+}
+
+void JobQueue::start(QRunnable* r, glm::vec2 center) {
+    m_lock.lock();
+    if(m_jobs.empty() && m_running == 0) m_busySince = std::chrono::steady_clock::now();
+    m_jobs.push_back({r, center});
+    m_lock.unlock();
+    m_pool.start(new JobRunner(this));
+}
+
+void JobQueue::setView(glm::vec3 eye, glm::vec3 forward) {
+    glm::vec2 f(forward.x, forward.z);
+    m_lock.lock();
+    m_eyes.assign(1, glm::vec2(eye.x, eye.z));
+    m_forward = glm::length(f) > 0.01f ? glm::normalize(f) : glm::vec2(0);
+    m_lock.unlock();
+}
+
+void JobQueue::setViews(const std::vector<glm::vec3> &eyes) {
+    m_lock.lock();
+    m_eyes.clear();
+    for(const glm::vec3 &e : eyes) m_eyes.emplace_back(e.x, e.z);
+    //no facing to go by, every player's surroundings count as in view
+    m_forward = glm::vec2(0);
+    m_lock.unlock();
+}
+
+int JobQueue::queued() {
+    m_lock.lock();
+    int n = m_jobs.size();
+    m_lock.unlock();
+    return n;
+}
+
+bool JobQueue::idle() {
+    m_lock.lock();
+    bool idle = m_jobs.empty() && m_running == 0;
+    m_lock.unlock();
+    return idle;
+}
+
+std::chrono::steady_clock::time_point JobQueue::busySince() {
+    m_lock.lock();
+    auto t = m_jobs.empty() && m_running == 0 ? std::chrono::steady_clock::now() : m_busySince;
+    m_lock.unlock();
+    return t;
+}
+
+QRunnable* JobQueue::take() {
+    m_lock.lock();
+    if(m_jobs.empty()) {
+        m_lock.unlock();
+        return nullptr;
+    }
+    //a few hundred jobs at most, scanning is cheaper than keeping a heap sorted for a moving player
+    size_t best = 0;
+    float bestPriority = priority(m_jobs[0].center, m_eyes, m_forward);
+    for(size_t i = 1; i < m_jobs.size(); i++) {
+        float p = priority(m_jobs[i].center, m_eyes, m_forward);
+        if(p < bestPriority) {
+            best = i;
+            bestPriority = p;
+        }
+    }
+    QRunnable* r = m_jobs[best].r;
+    m_jobs[best] = m_jobs.back();
+    m_jobs.pop_back();
+    m_running++;
+    m_lock.unlock();
+    return r;
+}
+
+void JobQueue::finished() {
+    m_lock.lock();
+    m_running--;
+    m_lock.unlock();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <QThreadPool>
+#include <QRunnable>
+#include "glm_includes.h"
+
+// A thread pool that runs its jobs nearest the player's view first instead of
+// in the order they were started. A job is only picked when a thread frees up,
+// against where the player is and where they look at that moment, so moving
+// reorders everything still waiting without touching the queue
+class JobQueue {
+public:
+    JobQueue();
+    // drops the jobs that haven't started and waits for the rest
+    ~JobQueue();
+
+    // queues r for the chunk column centered at center, owns it like QThreadPool::start
+    void start(QRunnable* r, glm::vec2 center);
+    // what the jobs are ordered by, the main thread sets it every frame
+    void setView(glm::vec3 eye, glm::vec3 forward);
+    // orders jobs by the nearest of several eyes, for the server's players
+    void setViews(const std::vector<glm::vec3> &eyes);
+
+    int queued();
+    // nothing queued or running
+    bool idle();
+    // when the queue last stopped being idle, now if it is
+    std::chrono::steady_clock::time_point busySince();
+
+private:
+    struct Job {
+        QRunnable* r;
+        glm::vec2 center;
+    };
+
+    QThreadPool m_pool;
+    std::mutex m_lock;
+    std::vector<Job> m_jobs;
+    int m_running;
+    std::vector<glm::vec2> m_eyes;
+    glm::vec2 m_forward; //horizontal look direction, zero looking straight up or down or with several eyes
+    std::chrono::steady_clock::time_point m_busySince;
+
+    // removes and returns the job that should run next, nullptr if none
+    QRunnable* take();
+    void finished();
+
+    friend class JobRunner;
+};
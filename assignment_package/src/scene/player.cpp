@@ -100,9 +100,10 @@ bool Player::checkAirborne() {
                                      glm::vec3(m_position.x - 0.3, m_position.y, m_position.z - 0.3)};
 
     glm::vec3 down(0, -0.125, 0);
+    BlockCursor cur(mcr_terrain);
     for (auto &c : corners) {
         float dist; glm::ivec3 outblock; Direction d;
-        mcr_terrain.gridMarch(c, down, &dist, &outblock, d);
+        mcr_terrain.gridMarch(cur, c, down, &dist, &outblock, d);
         if (dist <= 0.10) return false;
     }
     return true;
@@ -151,6 +152,8 @@ void Player::checkCollision()
                                      glm::vec3(p.x+0.3, p.y, p.z+0.3),
                                      glm::vec3(p.x-0.3, p.y, p.z+0.3),
                                      glm::vec3(p.x-0.3, p.y, p.z-0.3)};
+    //every corner and ray lands in the same few chunks
+    BlockCursor blocks(mcr_terrain);
     bool liquid = true;
     in_liquid = false; bott_in_liquid = false;
     for (int i = 0; i < corners.size(); i++) {
@@ -158,14 +161,14 @@ void Player::checkCollision()
             in_liquid = in_liquid || liquid;
             liquid = true;
         }
-        glm::vec3 cur = corners[i];
-        BlockType bt = mcr_terrain.getBlockAt(cur.x, cur.y, cur.z);
-        liquid = liquid && (bt == WATER || bt == LAVA);
+        glm::ivec3 cur = glm::ivec3(glm::floor(corners[i]));
+        BlockType bt = blocks.get(cur);
+        liquid = liquid && blockInfo(bt).liquid;
     }
     for (int i = 0; i < 4; i++) {
         glm::vec3 cur = corners[i];
-        BlockType bt = mcr_terrain.getBlockAt(cur.x, p.y - 0.1f, cur.z);
-        bott_in_liquid = bott_in_liquid || (bt == WATER || bt == LAVA);
+        BlockType bt = blocks.get(glm::ivec3(glm::floor(glm::vec3(cur.x, p.y - 0.1f, cur.z))));
+        bott_in_liquid = bott_in_liquid || blockInfo(bt).liquid;
     }
 
     glm::vec3 min = glm::vec3(m_velocity.x, m_velocity.y, m_velocity.z);
@@ -173,11 +176,11 @@ void Player::checkCollision()
         float x, y, z;
         glm::ivec3 b;
         Direction d;
-        bool xF = mcr_terrain.gridMarch(origin, glm::vec3(m_velocity.x, 0, 0),
+        bool xF = mcr_terrain.gridMarch(blocks, origin, glm::vec3(m_velocity.x, 0, 0),
                                     &x, &b, d);
-        bool yF = mcr_terrain.gridMarch(origin, glm::vec3(0, m_velocity.y, 0),
+        bool yF = mcr_terrain.gridMarch(blocks, origin, glm::vec3(0, m_velocity.y, 0),
                                     &y, &b, d);
-        bool zF = mcr_terrain.gridMarch(origin, glm::vec3(0, 0, m_velocity.z),
+        bool zF = mcr_terrain.gridMarch(blocks, origin, glm::vec3(0, 0, m_velocity.z),
                                     &z, &b, d);
         float eps = 0.21f;
         if (xF && x < glm::abs(min.x)) {
@@ -0,0 +1,265 @@
+#include "region.h"
+#include "chunk.h"
+#include <QDir>
+#include <QDebug>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "glm_includes.h"
+
+static const char REGION_MAGIC[8] = {'M', 'M', 'R', 'E', 'G', 'I', 'O', 'N'};
+#define REGION_ENTRIES (REGION_CHUNKS * REGION_CHUNKS)
+#define REGION_HEADER (sizeof(REGION_MAGIC) + REGION_ENTRIES * 2 * sizeof(uint32_t))
+#define REGION_SECTOR 4096
+
+static uint64_t sectorFloor(uint64_t n) {
+    return n & ~uint64_t(REGION_SECTOR - 1);
+}
+
+static uint64_t sectorCeil(uint64_t n) {
+    return sectorFloor(n + REGION_SECTOR - 1);
+}
+
+RegionFile::RegionFile(const QString &path, bool readOnly)
+    : m_fd(-1), m_readOnly(readOnly), m_map(nullptr), m_mapSize(0), m_end(0), m_dirty(false), m_free(), m_released(), m_mutex()
+{
+    QByteArray p = path.toLocal8Bit();
+    m_fd = ::open(p.constData(), readOnly ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+    if(m_fd < 0) return;
+
+    struct stat st;
+    fstat(m_fd, &st);
+    if(st.st_size == 0 && !readOnly) {
+        //new file, write an empty table
+        QByteArray header(REGION_HEADER, 0);
+        std::memcpy(header.data(), REGION_MAGIC, sizeof(REGION_MAGIC));
+        if(pwrite(m_fd, header.constData(), header.size(), 0) != header.size()) {
+            qDebug() << "could not initialize region file" << path;
+        }
+        fstat(m_fd, &st);
+    }
+    if(size_t(st.st_size) < REGION_HEADER || !remap() || std::memcmp(m_map, REGION_MAGIC, sizeof(REGION_MAGIC)) != 0) {
+        qDebug() << "ignoring malformed region file" << path;
+        if(m_map) munmap(const_cast<char*>(m_map), m_mapSize);
+        m_map = nullptr;
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    m_end = sectorCeil(glm::max<uint64_t>(st.st_size, REGION_HEADER));
+    if(!readOnly) buildFreeList();
+}
+
+RegionFile::~RegionFile() {
+    if(m_map) munmap(const_cast<char*>(m_map), m_mapSize);
+    if(m_fd >= 0) ::close(m_fd);
+}
+
+// maps the whole file again after it grew, caller holds m_mutex
+bool RegionFile::remap() {
+    struct stat st;
+    if(fstat(m_fd, &st) != 0) return false;
+    if(m_map) munmap(const_cast<char*>(m_map), m_mapSize);
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if(p == MAP_FAILED) {
+        m_map = nullptr;
+        m_mapSize = 0;
+        return false;
+    }
+    m_map = static_cast<const char*>(p);
+    m_mapSize = st.st_size;
+    return true;
+}
+
+void RegionFile::buildFreeList() {
+    std::vector<std::pair<uint64_t, uint64_t>> used;
+    for(int i = 0; i < REGION_ENTRIES; i++) {
+        uint32_t entry[2];
+        std::memcpy(entry, m_map + sizeof(REGION_MAGIC) + i * sizeof(entry), sizeof(entry));
+        //files from before sectors have unaligned payloads, the sectors they touch count as used
+        if(entry[0] != 0) used.emplace_back(sectorFloor(entry[0]), sectorCeil(uint64_t(entry[0]) + entry[1]));
+    }
+    std::sort(used.begin(), used.end());
+    uint64_t at = sectorCeil(REGION_HEADER);
+    for(auto &u : used) {
+        if(u.first > at) m_free[at] = u.first - at;
+        at = glm::max(at, u.second);
+    }
+    if(m_end > at) m_free[at] = m_end - at;
+}
+
+uint64_t RegionFile::allocate(uint64_t bytes) {
+    bytes = sectorCeil(bytes);
+    for(auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if(it->second < bytes) continue;
+        uint64_t offset = it->first, left = it->second - bytes;
+        m_free.erase(it);
+        if(left > 0) m_free[offset + bytes] = left;
+        return offset;
+    }
+    uint64_t offset = glm::max(m_end, sectorCeil(REGION_HEADER));
+    m_end = offset + bytes;
+    return offset;
+}
+
+void RegionFile::release(uint64_t offset, uint64_t bytes) {
+    uint64_t start = sectorFloor(offset), end = sectorCeil(offset + bytes);
+    //merge with the runs on either side
+    auto next = m_free.lower_bound(start);
+    if(next != m_free.end() && next->first == end) {
+        end += next->second;
+        next = m_free.erase(next);
+    }
+    if(next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if(prev->first + prev->second == start) {
+            start = prev->first;
+            m_free.erase(prev);
+        }
+    }
+    m_free[start] = end - start;
+}
+
+void RegionFile::releaseEntry(int i, uint64_t offset, uint64_t bytes) {
+    uint64_t start = sectorFloor(offset), end = sectorCeil(offset + bytes);
+    //payloads from before sectors were packed back to back, keep sectors a neighbor still uses
+    bool firstShared = false, lastShared = false;
+    for(int j = 0; j < REGION_ENTRIES; j++) {
+        uint32_t entry[2];
+        std::memcpy(entry, m_map + sizeof(REGION_MAGIC) + j * sizeof(entry), sizeof(entry));
+        if(j == i || entry[0] == 0) continue;
+        uint64_t s0 = sectorFloor(entry[0]), s1 = sectorCeil(uint64_t(entry[0]) + entry[1]);
+        if(s0 < start + REGION_SECTOR && s1 > start) firstShared = true;
+        if(s0 < end && s1 > end - REGION_SECTOR) lastShared = true;
+    }
+    if(firstShared) start += REGION_SECTOR;
+    if(lastShared) end -= REGION_SECTOR;
+    if(end > start) m_released.emplace_back(start, end - start);
+}
+
+bool RegionFile::isOpen() const {
+    return m_fd >= 0;
+}
+
+QByteArray RegionFile::read(int i) {
+    if(m_fd < 0 || i < 0 || i >= REGION_ENTRIES) return QByteArray();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t entry[2];
+    std::memcpy(entry, m_map + sizeof(REGION_MAGIC) + i * sizeof(entry), sizeof(entry));
+    if(entry[0] == 0) return QByteArray();
+    //appended by someone else since we last mapped
+    if(size_t(entry[0]) + entry[1] > m_mapSize && (!remap() || size_t(entry[0]) + entry[1] > m_mapSize)) {
+        return QByteArray();
+    }
+    return qUncompress(reinterpret_cast<const uchar*>(m_map + entry[0]), entry[1]);
+}
+
+bool RegionFile::write(int i, const QByteArray &payload) {
+    if(m_fd < 0 || m_readOnly || i < 0 || i >= REGION_ENTRIES) return false;
+    QByteArray data = qCompress(payload);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty = true;
+    uint64_t offset = allocate(data.size());
+    if(offset + data.size() > UINT32_MAX) {
+        release(offset, data.size());
+        qDebug() << "region file full";
+        return false;
+    }
+    //payload first, so the table never points at a half written chunk
+    if(pwrite(m_fd, data.constData(), data.size(), offset) != data.size()) {
+        release(offset, data.size());
+        return false;
+    }
+    uint32_t old[2];
+    std::memcpy(old, m_map + sizeof(REGION_MAGIC) + i * sizeof(old), sizeof(old));
+    uint32_t entry[2] = {uint32_t(offset), uint32_t(data.size())};
+    if(pwrite(m_fd, entry, sizeof(entry), sizeof(REGION_MAGIC) + i * sizeof(entry)) != sizeof(entry)) {
+        release(offset, data.size());
+        return false;
+    }
+    //nothing points at the old copy anymore, once that is on disk
+    if(old[0] != 0) releaseEntry(i, old[0], old[1]);
+    return true;
+}
+
+bool RegionFile::sync() {
+    if(m_fd < 0 || m_readOnly || !m_dirty.exchange(false)) return true;
+    //only what was repointed before the fdatasync starts is durable after it
+    std::vector<std::pair<uint64_t, uint64_t>> released;
+    m_mutex.lock();
+    released.swap(m_released);
+    m_mutex.unlock();
+    bool ok = fdatasync(m_fd) == 0;
+    m_mutex.lock();
+    if(ok) {
+        for(auto &r : released) release(r.first, r.second);
+    }
+    else {
+        m_released.insert(m_released.end(), released.begin(), released.end());
+        m_dirty = true;
+    }
+    m_mutex.unlock();
+    return ok;
+}
+
+RegionStore::RegionStore(const QString &dir, bool readOnly)
+    : m_dir(dir), m_readOnly(readOnly), m_files_mutex(), m_files()
+{
+    if(!readOnly) QDir().mkpath(dir);
+}
+
+bool RegionStore::readOnly() const {
+    return m_readOnly;
+}
+
+RegionFile* RegionStore::regionFor(int x, int z) {
+    int rx = static_cast<int>(std::floor(x / (16.f * REGION_CHUNKS)));
+    int rz = static_cast<int>(std::floor(z / (16.f * REGION_CHUNKS)));
+    int64_t key = (int64_t(rx) << 32) | uint32_t(rz);
+    std::lock_guard<std::mutex> lock(m_files_mutex);
+    auto it = m_files.find(key);
+    if(it == m_files.end()) {
+        QString path = m_dir + "/r." + QString::number(rx) + "." + QString::number(rz) + ".region";
+        uPtr<RegionFile> r = mkU<RegionFile>(path, m_readOnly);
+        //a reader tries again later in case the writer creates the file
+        if(!r->isOpen()) return nullptr;
+        it = m_files.emplace(key, std::move(r)).first;
+    }
+    return it->second.get();
+}
+
+// chunk index inside its region
+static int regionIndex(int x, int z) {
+    int cx = static_cast<int>(std::floor(x / 16.f)) & (REGION_CHUNKS - 1);
+    int cz = static_cast<int>(std::floor(z / 16.f)) & (REGION_CHUNKS - 1);
+    return cx + REGION_CHUNKS * cz;
+}
+
+QByteArray RegionStore::load(int x, int z) {
+    RegionFile* r = regionFor(x, z);
+    if(r == nullptr) return QByteArray();
+    return r->read(regionIndex(x, z));
+}
+
+bool RegionStore::save(int x, int z, const Chunk* c) {
+    if(m_readOnly) return false;
+    RegionFile* r = regionFor(x, z);
+    if(r == nullptr) return false;
+    QByteArray data;
+    c->serialize(data);
+    return r->write(regionIndex(x, z), data);
+}
+
+bool RegionStore::sync() {
+    std::lock_guard<std::mutex> lock(m_files_mutex);
+    bool ok = true;
+    for(auto &kv : m_files) {
+        ok = kv.second->sync() && ok;
+    }
+    return ok;
+}
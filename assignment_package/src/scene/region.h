@@ -0,0 +1,79 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "smartpointerhelp.h"
+
+class Chunk;
+
+#define REGION_CHUNKS 32 //region files are REGION_CHUNKS x REGION_CHUNKS chunks
+
+// One region file, holding up to 32 x 32 chunks.
+// Layout: an 8 byte magic, then a table of 1024 (offset, length) pairs of
+// uint32s indexed by (x + 32 * z) in chunk units, then compressed chunk payloads.
+// An offset of 0 means the chunk was never saved.
+// Payloads take whole REGION_SECTOR sized extents. A write goes into a free extent
+// and then repoints the table entry, so an interrupted write leaves the old copy
+// in place. The old extent is only reused once sync has made the repoint durable,
+// until then a crash could still bring back the table pointing at it.
+// The free list isn't stored, it is rebuilt from the table on open. Reads go through mmap.
+class RegionFile {
+private:
+    int m_fd;
+    bool m_readOnly;
+    const char* m_map;
+    size_t m_mapSize;
+    uint64_t m_end; //end of the last extent, sector aligned
+    std::atomic_bool m_dirty; //written since the last sync
+    std::map<uint64_t, uint64_t> m_free; //offset to length of free sector runs below m_end
+    std::vector<std::pair<uint64_t, uint64_t>> m_released; //freed since the last sync, not reusable yet
+    std::mutex m_mutex;
+
+    bool remap();
+    // free space is everything between the header and m_end no table entry covers
+    void buildFreeList();
+    // caller holds m_mutex for both
+    uint64_t allocate(uint64_t bytes);
+    void release(uint64_t offset, uint64_t bytes);
+    // queues what entry i pointed at before it was repointed for the next sync to free
+    void releaseEntry(int i, uint64_t offset, uint64_t bytes);
+public:
+    RegionFile(const QString &path, bool readOnly);
+    ~RegionFile();
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+
+    bool isOpen() const;
+    // i is the chunk index inside the region, returns an empty array if missing
+    QByteArray read(int i);
+    bool write(int i, const QByteArray &payload);
+    // fdatasyncs if anything was written since the last sync, then frees the
+    // extents written over before it
+    bool sync();
+};
+
+// All region files of one world directory, opened on first use.
+class RegionStore {
+private:
+    QString m_dir;
+    bool m_readOnly;
+    std::mutex m_files_mutex;
+    std::map<int64_t, uPtr<RegionFile>> m_files;
+
+    // nullptr if the file can't be opened
+    RegionFile* regionFor(int x, int z);
+public:
+    RegionStore(const QString &dir, bool readOnly);
+
+    bool readOnly() const;
+    // x and z are the chunk corner in world space.
+    // Returns what Chunk::serialize wrote, or an empty array if the chunk was never saved
+    QByteArray load(int x, int z);
+    bool save(int x, int z, const Chunk* c);
+    // syncs every open region file, false if one failed
+    bool sync();
+};
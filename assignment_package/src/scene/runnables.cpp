@@ -6,17 +6,40 @@ BlockTypeWorker::~BlockTypeWorker(){
 };
 void BlockTypeWorker::run() {
     //QThread::currentThread()->setPriority(QThread::LowestPriority);
+    Epoch::Guard g;
     t->instantiateChunkAt(x, z);
 }
 
-VBOWorker::VBOWorker(Chunk* cc):c(cc){
+VBOWorker::VBOWorker(Terrain* tt, Chunk* cc, bool full):t(tt), c(cc), full(full){
     QThread::currentThread()->setPriority(QThread::HighestPriority);
 };
 VBOWorker::~VBOWorker(){
 
 };
 void VBOWorker::run(){
-    c->createVBOdata();
+    Epoch::Guard g;
+    if(full) c->createVBOdata();
+    else c->updateVBOdata();
+    //before endJob, so the chunk can't be evicted while it is being queued
+    t->chunkMeshed(c);
+    c->endJob();
+}
+
+LODWorker::LODWorker(Terrain* tt, Chunk* cc, int level):t(tt), c(cc), level(level){}
+LODWorker::~LODWorker(){}
+
+void LODWorker::run(){
+    Epoch::Guard g;
+    c->createLODdata(level);
+    t->chunkMeshed(c);
+    c->endJob();
+}
+
+HorizonWorker::HorizonWorker(Horizon* hh, int zx, int zz):h(hh), zx(zx), zz(zz){}
+HorizonWorker::~HorizonWorker(){}
+
+void HorizonWorker::run(){
+    h->buildTile(zx, zz);
 }
 
 StructureWorker::StructureWorker(Terrain* tt, StructureType ss, int xx, int yy, int zz):
@@ -24,6 +47,7 @@ t(tt), s(ss), x(xx), y(yy), z(zz){}
 StructureWorker::~StructureWorker(){};
 
 void StructureWorker:: run() {
+    Epoch::Guard g;
     switch(s) {
     case VILLAGE_CENTER:{
         t->processMegaStructure(generateVillage(glm::vec2(x, z)));
@@ -5,6 +5,7 @@
 #include "glm_includes.h"
 #include "mygl.h"
 #include "terrain.h"
+#include "horizon.h"
 #include "server/server.h"
 
 //runnables
@@ -21,14 +22,41 @@ public:
 
 class VBOWorker: public QRunnable {
 private:
+    Terrain* t;
     Chunk* c;
+    bool full; //false only remeshes stale sections
 public:
-    VBOWorker(Chunk* cc);
+    VBOWorker(Terrain* tt, Chunk* cc, bool full = true);
     ~VBOWorker();
 
     void run();
 };
 
+// builds a chunk's reduced detail mesh, see Chunk::createLODdata
+class LODWorker: public QRunnable {
+private:
+    Terrain* t;
+    Chunk* c;
+    int level;
+public:
+    LODWorker(Terrain* tt, Chunk* cc, int level);
+    ~LODWorker();
+
+    void run();
+};
+
+// samples one zone of the horizon, see Horizon::buildTile
+class HorizonWorker: public QRunnable {
+private:
+    Horizon* h;
+    int zx, zz;
+public:
+    HorizonWorker(Horizon* hh, int zx, int zz);
+    ~HorizonWorker();
+
+    void run();
+};
+
 class StructureWorker: public QRunnable {
 private:
     Terrain* t;
@@ -8,6 +8,8 @@
 #include "runnables.h"
 #include <thread>
 #include <queue>
+#include <algorithm>
+#include <chrono>
 #include "algo/noise.h"
 #include "algo/seed.h"
 #include "algo/fractal.h"
@@ -20,8 +22,22 @@
 #define BEDROCK_LEVEL 32
 #define beach_level 0.1
 
+//zones are generated up to 192 + 64 blocks out, never evict inside that
+#define MIN_KEEP_RADIUS 320
+#define DEFAULT_MEMORY_BUDGET (256 * 1024 * 1024)
+//mesh data uploaded per frame, the nearest chunk always goes even if it's bigger
+#define UPLOAD_BYTES_PER_FRAME (4 << 20)
+#define UPLOAD_MS_PER_FRAME 2.0
+#define DEFAULT_VRAM_BUDGET (512 << 20)
+//chunks further than this many blocks go down a detail level, and again every time after
+#define LOD_DISTANCE 128
+//blocks past a level boundary a chunk has to be before it switches
+#define LOD_HYSTERESIS 8
+
 Terrain::Terrain(OpenGLContext *context)
-    : m_chunks(), mp_context(context), m_generatedTerrain(), setSpawn(false), item_entity_id(0)
+    : m_chunks(), mp_context(context), m_arena(nullptr), m_renderStats{0, 0, 0, 0, 0, 0, 0, 0, 0, DEFAULT_VRAM_BUDGET, 0, 0, 0, false, 0}, m_drawMinX(0), m_drawMinZ(0), m_drawW(0), m_drawD(0), m_drawGrid(), m_drawChunks(0),
+      m_visibleSections(), m_reachedColumns(), m_meshedChunks_mutex(), m_meshedChunks(), m_uploads(), m_vramBudget(DEFAULT_VRAM_BUDGET), m_frame(0), m_loadStart(std::chrono::steady_clock::now()), m_spawnLoaded(false), m_generatedTerrain(), m_memoryBudget(DEFAULT_MEMORY_BUDGET), m_evictTick(0),
+      m_regions(nullptr), setSpawn(false), item_entity_id(0)
 {
 }
 
@@ -66,13 +82,15 @@ glm::ivec2 toCoords(int64_t k) {
 // the coordinates at x, y, z have a corresponding Chunk
 BlockType Terrain::getBlockAt(int x, int y, int z) const
 {
-    if(hasChunkAt(x, z)) {
+    //one lookup, the chunk can be evicted between a hasChunkAt and a second one
+    Epoch::Guard g;
+    const Chunk* c = getChunkAt(x, z);
+    if(c) {
         // Just disallow action below or above min/max height,
         // but don't crash the game over it.
         if(y < 0 || y >= 256) {
             return EMPTY;
         }
-        const uPtr<Chunk> &c = getChunkAt(x, z);
         glm::ivec2 chunkOrigin = glm::ivec2(16*static_cast<int>(glm::floor(x / 16.f)),
                                             16*static_cast<int>(glm::floor(z / 16.f)));
         return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
@@ -91,6 +109,43 @@ BlockType Terrain::getBlockAt(glm::vec3 p) const {
     return getBlockAt(floorf(p.x), floorf(p.y), floorf(p.z));
 }
 
+size_t Terrain::blockMemoryUsage(int *out_chunks) const {
+    size_t bytes = 0;
+    m_chunks.forEach([&bytes](int, int, Chunk* c) {
+        bytes += c->memoryUsage();
+    });
+    *out_chunks = m_chunks.size();
+    return bytes;
+}
+
+void Terrain::setGreedyMeshing(bool greedy) {
+    Chunk::greedyMeshing = greedy;
+    Chunk::meshNanos = 0;
+    Chunk::meshCount = 0;
+    //remesh everything that already has a mesh so the stats compare like for like
+    m_chunks.forEach([this](int, int, Chunk* c) {
+        if(c->dataGen) createVBOThread(c);
+    });
+}
+
+MeshStats Terrain::meshStats() const {
+    MeshStats st = {};
+    m_chunks.forEach([&st](int, int, Chunk* c) {
+        if(!c->dataGen) return;
+        st.chunks++;
+        st.vertices += c->vertexCount;
+        st.gpuBytes += c->gpuBytes;
+        st.cpuBytes += c->meshMemory();
+    });
+    int count = Chunk::meshCount;
+    st.msPerMesh = count > 0 ? Chunk::meshNanos / 1e6 / count : 0;
+    return st;
+}
+
+RenderStats Terrain::renderStats() const {
+    return m_renderStats;
+}
+
 bool Terrain::hasChunkAt(int x, int z) const {
     // Map x and z to their nearest Chunk corner
     // By flooring x and z, then multiplying by 16,
@@ -101,37 +156,29 @@ bool Terrain::hasChunkAt(int x, int z) const {
     // opposed to (int)(-1 / 16.f) giving us 0 (incorrect!).
     int xFloor = static_cast<int>(glm::floor(x / 16.f));
     int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    m_chunks_mutex.lock();
-    bool b= m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
+    bool b = m_chunks.find(16 * xFloor, 16 * zFloor) != nullptr;
     //qDebug() << x << z << b;
-    m_chunks_mutex.unlock();
     return b;
 }
 
 
-uPtr<Chunk>& Terrain::getChunkAt(int x, int z) {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    m_chunks_mutex.lock();
-    uPtr<Chunk>& c = m_chunks[toKey(16 * xFloor, 16 * zFloor)];
-    m_chunks_mutex.unlock();
-    return c;
+Chunk* Terrain::getChunkAt(int x, int z) {
+    return m_chunks.find(x, z);
 }
 
 
-const uPtr<Chunk>& Terrain::getChunkAt(int x, int z) const {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks.at(toKey(16 * xFloor, 16 * zFloor));
+const Chunk* Terrain::getChunkAt(int x, int z) const {
+    return m_chunks.find(x, z);
 }
 
 void Terrain::setBlockAt(int x, int y, int z, BlockType t)
 {
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
+    Epoch::Guard g;
+    Chunk* c = getChunkAt(x, z);
+    if(c) {
         glm::ivec2 chunkOrigin = glm::ivec2(16*static_cast<int>(glm::floor(x / 16.f)),
                                             16*static_cast<int>(glm::floor(z / 16.f)));
-        if(c->m_changes.find(glm::ivec3(x - chunkOrigin.x, y, z - chunkOrigin.y)) == c->m_changes.end()) {
+        if(!c->hasChange(x - chunkOrigin.x, y, z - chunkOrigin.y)) {
             c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
                           static_cast<unsigned int>(y),
                           static_cast<unsigned int>(z - chunkOrigin.y),
@@ -156,15 +203,16 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
 
 void Terrain::changeBlockAt(int x, int y, int z, BlockType t)
 {
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
+    Epoch::Guard g;
+    Chunk* c = getChunkAt(x, z);
+    if(c) {
         glm::ivec2 chunkOrigin = glm::ivec2(16*static_cast<int>(glm::floor(x / 16.f)),
                                             16*static_cast<int>(glm::floor(z / 16.f)));
         c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
                       static_cast<unsigned int>(y),
                       static_cast<unsigned int>(z - chunkOrigin.y),
                       t);
-        c->m_changes[glm::ivec3(x - chunkOrigin.x, y, z - chunkOrigin.y)] = t;
+        c->recordChange(x - chunkOrigin.x, y, z - chunkOrigin.y, t);
     }
     else {
         int xFloor = static_cast<int>(glm::floor(x / 16.f));
@@ -183,12 +231,13 @@ void Terrain::changeBlockAt(int x, int y, int z, BlockType t)
 }
 
 void Terrain::setBlockAt(int x, int y, int z, BlockType t, bool(*con)(int,int,int,Chunk*)) {
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
+    Epoch::Guard g;
+    Chunk* c = getChunkAt(x, z);
+    if(c) {
         int xFloor = 16*static_cast<int>(glm::floor(x / 16.f));
         int zFloor = 16*static_cast<int>(glm::floor(z / 16.f));
-        if(con(x-xFloor, y, z-zFloor, c.get())){
-            if(c->m_changes.find(glm::ivec3(x - xFloor, y, z - zFloor)) == c->m_changes.end()) {
+        if(con(x-xFloor, y, z-zFloor, c)){
+            if(!c->hasChange(x - xFloor, y, z - zFloor)) {
                 c->setBlockAt(static_cast<unsigned int>(x - xFloor),
                               static_cast<unsigned int>(y),
                               static_cast<unsigned int>(z - zFloor),
@@ -212,74 +261,65 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t, bool(*con)(int,int,in
     }
 }
 
-Chunk* Terrain::instantiateChunkAt(int x, int z) {
-    x = floor(x/16.f)*16;
-    z = floor(z/16.f)*16;
+void Terrain::setBlockAt(BlockCursor &cur, int x, int y, int z, BlockType t, bool(*con)(int,int,int,Chunk*)) {
+    Chunk* c = cur.chunkAt(x, z);
+    if(c == nullptr) {
+        //queues it as meta data, and catches a chunk that got loaded since the cursor looked
+        if(con) setBlockAt(x, y, z, t, con);
+        else setBlockAt(x, y, z, t);
+        return;
+    }
+    int lx = x & 15, lz = z & 15;
+    if(con && !con(lx, y, lz, c)) return;
+    if(!c->hasChange(lx, y, lz)) {
+        c->setBlockAt(static_cast<unsigned int>(lx), static_cast<unsigned int>(y), static_cast<unsigned int>(lz), t);
+    }
+}
 
-    int64_t key = toKey(x, z);
+// for(; y > bottom; y--) c->setBlockAt(x, y, z, t) as one bulk write, returns where y ends up
+static int fillDown(Chunk* c, int x, int z, int y, int bottom, BlockType t) {
+    if(y <= bottom) return y;
+    c->fillColumn(x, z, bottom + 1, y + 1, t);
+    return bottom;
+}
 
-    uPtr<Chunk> chunk = mkU<Chunk>(mp_context);
-    Chunk *cPtr = chunk.get();
+Ground groundAt(int x, int z) {
+    float bedrock = generateBedrock(glm::vec2(x,z));
+    float beachhead = beach_level*generateBeach(glm::vec2(x,z));
+    std::pair<float, BiomeType> groundInfo = generateGround(glm::vec2(x,z));
+
+    //deep and shallow ocean
+    if(bedrock < ocean_level) {
+        return Ground{OCEAN_LEVEL, OCEAN, false};
+    }
+    //beach
+    if(bedrock < ocean_level+beachhead) {
+        //float erosion = generateErosion(vec2(xx,zz));
+        //shoreline
+        int height = glm::clamp((int)(OCEAN_LEVEL + pow((bedrock-ocean_level)/beachhead,2)*(groundInfo.first+(bedrock-ocean_level)*BEDROCK_LEVEL)),
+                                0, 256);
+        bool sand = height <= OCEAN_LEVEL+5 && groundInfo.second != RIVER;
+        return Ground{height, sand ? BEACH : groundInfo.second, true};
+    }
+    //land
+    int height = glm::clamp((int)(OCEAN_LEVEL + groundInfo.first +(bedrock-ocean_level)*BEDROCK_LEVEL), 0, 256);
+    return Ground{height, groundInfo.second, false};
+}
 
+// base terrain from the seed: height, biome blocks, water and caves
+void Terrain::fillChunk(Chunk* cPtr, int x, int z) {
     //biome info to generate with blocktype later
     BiomeType biomeMap[16][16];
 
     //terrain initialization
     for(int xx = x; xx < x+16; xx++) {
         for(int zz = z; zz < z+16; zz++) {
-            float bedrock = generateBedrock(glm::vec2(xx,zz));
-            float beachhead = beach_level*generateBeach(glm::vec2(xx,zz));
-            std::pair<float, BiomeType> groundInfo = generateGround(glm::vec2(xx,zz));
-
-            //deep ocean
-            if(bedrock < ocean_level/2) {
-                //use center of chunk as the biome of the chunk
-                if(xx == x+8 && zz == z+8) {
-                    cPtr->biome = OCEAN;
-                }
-                //height
-                cPtr->heightMap[xx-x][zz-z] = OCEAN_LEVEL;
-                biomeMap[xx-x][zz-z] = OCEAN;
-            }
-            //shallow ocean
-            else if(bedrock < ocean_level) {
-                //use center of chunk as the biome of the chunk
-                if(xx == x+8 && zz == z+8) {
-                    cPtr->biome = OCEAN;
-                }
-                //height
-                cPtr->heightMap[xx-x][zz-z] = OCEAN_LEVEL;
-                biomeMap[xx-x][zz-z] = OCEAN;
-            }
-            //beach
-            else if(bedrock < ocean_level+beachhead) {
-                //use center of chunk as the biome of the chunk
-                if(xx == x+8 && zz == z+8) {
-                    cPtr->biome = BEACH;
-                }
-                //height
-                //float erosion = generateErosion(vec2(xx,zz));
-                //shoreline
-                float height = glm::clamp((int)(OCEAN_LEVEL + pow((bedrock-ocean_level)/beachhead,2)*(groundInfo.first+(bedrock-ocean_level)*BEDROCK_LEVEL)),
-                                     0, 256);
-                cPtr->heightMap[xx-x][zz-z] = height;
-                if(height <= OCEAN_LEVEL+5 && groundInfo.second != RIVER){
-                    biomeMap[xx-x][zz-z] = BEACH;
-                }
-                else {
-                    biomeMap[xx-x][zz-z] = groundInfo.second;
-                }
-            }
-            //land
-            else {
-                //use center of chunk as the biome of the chunk
-                if(xx == x+8 && zz == z+8) {
-                    cPtr->biome = groundInfo.second;
-                }
-                //height
-                float height = glm::clamp((int)(OCEAN_LEVEL + groundInfo.first +(bedrock-ocean_level)*BEDROCK_LEVEL), 0, 256);
-                cPtr->heightMap[xx-x][zz-z] = height;
-                biomeMap[xx-x][zz-z] = groundInfo.second;
+            Ground g = groundAt(xx, zz);
+            cPtr->heightMap[xx-x][zz-z] = g.height;
+            biomeMap[xx-x][zz-z] = g.biome;
+            //use center of chunk as the biome of the chunk
+            if(xx == x+8 && zz == z+8) {
+                cPtr->biome = g.shore ? BEACH : g.biome;
             }
         }
     }
@@ -292,119 +332,154 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
             switch(biomeMap[xx][zz]) {
             case TUNDRA: {
                 int y = maxy;
-                for(; y > maxy-3; y--) cPtr->setBlockAt(xx, y, zz, SNOW);
-                for(; y > maxy-6; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                y = fillDown(cPtr, xx, zz, y, maxy-3, SNOW);
+                y = fillDown(cPtr, xx, zz, y, maxy-6, DIRT);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
             case PLAINS: {
                 int y = maxy;
-                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, SNOW);
-                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, STONE);
+                BlockType top = GRASS_BLOCK;
+                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) top = SNOW;
+                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) top = STONE;
                 else {
                     if(noise1D(glm::vec2(xx+x, zz+z), SEED.getSeed(57.2, 12.3, 25.2)) < 0.1) {
                         //cPtr->setBlockAt(xx, y+1, zz, GRASS);
                     }
-                    cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
                 }
-                y--;
-                if(y < 100) for(; y > maxy-4; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                y = fillDown(cPtr, xx, zz, y, y-1, top);
+                if(y < 100) y = fillDown(cPtr, xx, zz, y, maxy-4, DIRT);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
             case DESERT:{
                 int y = maxy;
-                for(; y > maxy-3; y--) cPtr->setBlockAt(xx, y, zz, SAND);
-                for(; y > maxy-8; y--) cPtr->setBlockAt(xx, y, zz, SANDSTONE);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                y = fillDown(cPtr, xx, zz, y, maxy-3, SAND);
+                y = fillDown(cPtr, xx, zz, y, maxy-8, SANDSTONE);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
-            case TAIGA: {
+            case TAIGA:
+            case SAVANNA:
+            case RAINFOREST: {
                 int y = maxy;
-                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, SNOW);
-                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, STONE);
-                else cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
-                y--;
-                if(y < 100) for(; y > maxy-4; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                BlockType top = GRASS_BLOCK;
+                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) top = SNOW;
+                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) top = STONE;
+                y = fillDown(cPtr, xx, zz, y, y-1, top);
+                if(y < 100) y = fillDown(cPtr, xx, zz, y, maxy-4, DIRT);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
             case FOREST: {
                 int y = maxy;
-                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, SNOW);
-                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, STONE);
-                else cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
-                y--;
-                for(; y > maxy-4; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
-                break;
-            }
-            case SAVANNA: {
-                int y = maxy;
-                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, SNOW);
-                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, STONE);
-                else cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
-                y--;
-                if(y < 100) for(; y > maxy-4; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
-                break;
-            }
-            case RAINFOREST: {
-                int y = maxy;
-                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, SNOW);
-                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) cPtr->setBlockAt(xx, y, zz, STONE);
-                else cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
-                y--;
-                if(y < 100) for(; y > maxy-4; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                BlockType top = GRASS_BLOCK;
+                if(y > generateSnowLayer(glm::vec2(xx+x, zz+z))) top = SNOW;
+                else if(y>generateRockLayer(glm::vec2(xx+x, zz+z))) top = STONE;
+                y = fillDown(cPtr, xx, zz, y, y-1, top);
+                y = fillDown(cPtr, xx, zz, y, maxy-4, DIRT);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
             case BEACH:{
                 int y = maxy;
-                for(; y > maxy-6; y--) cPtr->setBlockAt(xx, y, zz, SAND);
-                for(; y > maxy-12; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, STONE);
+                y = fillDown(cPtr, xx, zz, y, maxy-6, SAND);
+                y = fillDown(cPtr, xx, zz, y, maxy-12, DIRT);
+                fillDown(cPtr, xx, zz, y, -1, STONE);
                 break;
             }
             case OCEAN:{
                 float bedrock = generateBedrock(glm::vec2(x+xx,z+zz));
                 int y = maxy;
-                for(; y >= glm::max(3.0, OCEAN_LEVEL*bedrock/ocean_level); y--) cPtr->setBlockAt(xx, y, zz, WATER);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, SAND);
+                //water goes down to and including the first y >= the sea floor
+                int seaFloor = static_cast<int>(glm::ceil(glm::max(3.0, OCEAN_LEVEL*bedrock/ocean_level)));
+                y = fillDown(cPtr, xx, zz, y, seaFloor-1, WATER);
+                fillDown(cPtr, xx, zz, y, -1, SAND);
                 break;
             }
             case RIVER: {
                 int y = maxy;
                 float depth = 10*(1-glm::sqrt(abs(0.5-generateRiver(glm::vec2(xx+x, zz+z)))/river_width));
-                for(; y > maxy-depth; y--) cPtr->setBlockAt(xx, y, zz, WATER);
-                for(; y >= 0; y--) cPtr->setBlockAt(xx, y, zz, DIRT);
+                y = fillDown(cPtr, xx, zz, y, static_cast<int>(glm::floor(maxy-depth)), WATER);
+                fillDown(cPtr, xx, zz, y, -1, DIRT);
                 break;
             }
             default:{
-                for(int y = 0; y < cPtr->heightMap[xx][zz]; y++)
-                    cPtr->setBlockAt(xx, y, zz, GRASS_BLOCK);
+                cPtr->fillColumn(xx, zz, 0, cPtr->heightMap[xx][zz], GRASS_BLOCK);
                 break;
             }
             }
             float rd = std::rand() % 1;
             float mx = maxy * (rd / 10.f + 0.95);
-            for(int y = fmin(128, mx); y > 0; y--) {
-                if(cPtr->getBlockAt(xx, y, zz) != WATER) {
-                    float cave_coef = generateCaves(vec3(x+xx, y, z+zz));
-                    if (cave_coef < 0.1 && cave_coef > -0.1) {
-                        if (y < 25) cPtr->setBlockAt(xx, y, zz, LAVA);
-                        else cPtr->setBlockAt(xx, y, zz, EMPTY);
+            //carve the column in a local copy and write it back once
+            int top = fmin(128, mx);
+            if(top > 0) {
+                BlockType column[128]; //y - 1
+                bool carved = false;
+                for(int y = top; y > 0; y--) {
+                    BlockType &b = column[y-1];
+                    b = cPtr->getLocalBlock(xx, y, zz);
+                    if(b != WATER) {
+                        float cave_coef = generateCaves(vec3(x+xx, y, z+zz));
+                        if (cave_coef < 0.1 && cave_coef > -0.1) {
+                            b = y < 25 ? LAVA : EMPTY;
+                            carved = true;
+                        }
                     }
                 }
+                if(carved) cPtr->writeColumn(xx, zz, 1, column, top);
             }
         }
     }
+}
+
+Chunk* Terrain::instantiateChunkAt(int x, int z) {
+    x = floor(x/16.f)*16;
+    z = floor(z/16.f)*16;
+
+    int64_t key = toKey(x, z);
+
+    uPtr<Chunk> chunk = mkU<Chunk>(mp_context);
+    Chunk *cPtr = chunk.get();
+
+    //saved chunks skip straight to structures, which only restamp what is already there.
+    //One kept in memory at eviction is newer than anything on disk
+    bool restored = false, fromMemory = false;
+    QByteArray data;
+    m_evictedChunks_mutex.lock();
+    auto kept = m_evictedChunks.find(key);
+    if(kept != m_evictedChunks.end()) data = qUncompress(kept->second);
+    m_evictedChunks_mutex.unlock();
+    fromMemory = !data.isEmpty();
+    if(!fromMemory && m_regions) data = m_regions->load(x, z);
+    if(!data.isEmpty()) {
+        cPtr->origin = glm::ivec2(x, z);
+        restored = cPtr->deserialize(data);
+        if(!restored) {
+            qDebug() << "corrupt saved chunk at" << x << z << ", regenerating";
+            chunk = mkU<Chunk>(mp_context);
+            cPtr = chunk.get();
+        }
+        //still only in memory, so eviction has to keep it again
+        else if(fromMemory) cPtr->unsaved = true;
+    }
+    if(!restored) fillChunk(cPtr, x, z);
+    cPtr->origin = glm::ivec2(x, z);
+
+    //no other thread can see the chunk yet, so repack its blocks now
+    cPtr->compactBlocks();
 
     //inserts chunk into m_chunks
     //meta data will no longer be added and changes will instead be directly made to the chunk
-    m_chunks_mutex.lock();
-    m_chunks[toKey(x, z)] = move(chunk);
-    m_chunks_mutex.unlock();
+    //if another worker got here first keep theirs, neighbors may already point at it
+    if(m_chunks.insertIfAbsent(x, z, move(chunk)) != cPtr) {
+        return getChunkAt(x, z);
+    }
+    if(fromMemory) {
+        m_evictedChunks_mutex.lock();
+        m_evictedChunks.erase(key);
+        m_evictedChunks_mutex.unlock();
+    }
 
     std::vector<Structure> chunkStructures = getStructureZones(cPtr, x, z);
 
@@ -424,7 +499,7 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
             //unlock the map so other threads can use it after marking this one as generating
             metaStructures_mutex.unlock();
             StructureWorker* sw = new StructureWorker(this, metaS.second, toCoords(metaS.first.first).x, metaS.first.second, toCoords(metaS.first.first).y);
-            terrainWorkers.start(sw);
+            terrainWorkers.start(sw, glm::vec2(toCoords(metaS.first.first)));
         }
         else{
             metaStructures_mutex.unlock();
@@ -452,9 +527,8 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
     if(metaChangeData.find(key) != metaChangeData.end()) {
         for(metadata md: metaChangeData[key]){
             if(md.con == nullptr || md.con(md.pos.x, md.pos.y, md.pos.z, cPtr)){
-                qDebug() << md.pos.x << md.pos.y << md.pos.z << md.type;
                 cPtr->setBlockAt(md.pos.x, md.pos.y, md.pos.z, md.type);
-                cPtr->m_changes[glm::ivec3(md.pos.x, md.pos.y, md.pos.z)] = md.type;
+                cPtr->recordChange(md.pos.x, md.pos.y, md.pos.z, md.type);
             }
         }
         metaChangeData.erase(key);
@@ -465,94 +539,347 @@ Chunk* Terrain::instantiateChunkAt(int x, int z) {
     cPtr->blocksChanged = true;
     //createVBOThread(cPtr);
     // Set the neighbor pointers of itself and its neighbors
-    if(hasChunkAt(x, z + 16)) {
-        auto &chunkNorth = m_chunks[toKey(x, z + 16)];
-        cPtr->linkNeighbor(chunkNorth, ZPOS);
+    if(Chunk* n = getChunkAt(x, z + 16)) {
+        cPtr->linkNeighbor(n, ZPOS);
     }
-    if(hasChunkAt(x, z - 16)) {
-        auto &chunkSouth = m_chunks[toKey(x, z - 16)];
-        cPtr->linkNeighbor(chunkSouth, ZNEG);
+    if(Chunk* n = getChunkAt(x, z - 16)) {
+        cPtr->linkNeighbor(n, ZNEG);
     }
-    if(hasChunkAt(x + 16, z)) {
-        auto &chunkEast = m_chunks[toKey(x + 16, z)];
-        cPtr->linkNeighbor(chunkEast, XPOS);
+    if(Chunk* n = getChunkAt(x + 16, z)) {
+        cPtr->linkNeighbor(n, XPOS);
     }
-    if(hasChunkAt(x - 16, z)) {
-        auto &chunkWest = m_chunks[toKey(x - 16, z)];
-        cPtr->linkNeighbor(chunkWest, XNEG);
+    if(Chunk* n = getChunkAt(x - 16, z)) {
+        cPtr->linkNeighbor(n, XNEG);
     }
 
 
     return cPtr;
 }
 
-void Terrain::draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram) {
-    std::vector<glm::vec2> transparentChunks;
-
-    for(int x = minX; x < maxX; x += 16) {
-        for(int z = minZ; z < maxZ; z += 16) {
-            if(hasChunkAt(x, z)){
-                uPtr<Chunk> &chunk = getChunkAt(x, z);
-                //only renders chunks with generated terrain data                
-                if(chunk != NULL && chunk->dataGen){
-                    if (chunk->hasTransparent) {
-                        transparentChunks.push_back(glm::vec2(x, z));
-                    } else {
-                        //since only main thread can add
-                        if(!chunk->dataBound){
-                            chunk->bindVBOdata();
-                        }
-                        shaderProgram->setModelMatrix(glm::translate(glm::mat4(1.f), glm::vec3(x, 0, z)));
-                        shaderProgram->drawInterleaved(*chunk.get());
-                    }
-                }
-            }
-            else {
-                //qDebug() << "missing chunk at " << x << z;
-            }
-        }
+int Terrain::drawCell(int x, int z) const {
+    if(m_drawGrid.empty()) return -1;
+    int gx = (x - m_drawMinX) / 16 + 1, gz = (z - m_drawMinZ) / 16 + 1;
+    if(x < m_drawMinX - 16 || z < m_drawMinZ - 16 || gx >= m_drawW + 2 || gz >= m_drawD + 2) return -1;
+    return gx * (m_drawD + 2) + gz;
+}
+
+bool Terrain::inDrawRange(int cell) const {
+    int gx = cell / (m_drawD + 2), gz = cell % (m_drawD + 2);
+    return gx > 0 && gz > 0 && gx <= m_drawW && gz <= m_drawD;
+}
+
+// binds a chunk in the render set's range, or patches in what changed since
+static void refreshChunk(Chunk* c, ChunkArena &arena) {
+    if(!c->dataBound) {
+        c->bindVBOdata(arena);
     }
+    else if(c->dirtySections) {
+        c->patchVBOdata(arena);
+    }
+}
+
+void Terrain::moveRenderSet(int minX, int maxX, int minZ, int maxZ) {
+    int w = (maxX - minX + 15) / 16, d = (maxZ - minZ + 15) / 16;
+    if(!m_drawGrid.empty() && minX == m_drawMinX && minZ == m_drawMinZ && w == m_drawW && d == m_drawD) return;
 
-    for (glm::vec2 v: transparentChunks) {
-        uPtr<Chunk> &chunk = getChunkAt(v.x, v.y);
-        //since only main thread can add
-        if(!chunk->dataBound){
-            chunk->bindVBOdata();
+    std::vector<Chunk*> old;
+    old.swap(m_drawGrid);
+    int oldMinX = m_drawMinX, oldMinZ = m_drawMinZ, oldD = m_drawD;
+    m_drawMinX = minX;
+    m_drawMinZ = minZ;
+    m_drawW = w;
+    m_drawD = d;
+    m_drawGrid.assign((w + 2) * (d + 2), nullptr);
+    m_drawChunks = 0;
+    m_visibleSections.assign(w * d, 0);
+    m_reachedColumns.clear();
+
+    for(int gx = 0; gx < w + 2; gx++) {
+        for(int gz = 0; gz < d + 2; gz++) {
+            Chunk* c = m_chunks.find(minX + 16 * (gx - 1), minZ + 16 * (gz - 1));
+            //only renders chunks with generated terrain data
+            if(c == nullptr || !c->dataGen) continue;
+            int cell = gx * (d + 2) + gz;
+            m_drawGrid[cell] = c;
+            //the margin keeps whatever it has
+            if(!inDrawRange(cell)) continue;
+            m_drawChunks++;
+            queueUpload(c);
         }
-        shaderProgram->setModelMatrix(glm::translate(glm::mat4(1.f), glm::vec3(v.x, 0, v.y)));
-        shaderProgram->drawInterleaved(*chunk.get());
     }
+    //whatever fell out of the grid gives its geometry back
+    for(size_t i = 0; i < old.size(); i++) {
+        Chunk* c = old[i];
+        if(c == nullptr || !c->dataBound) continue;
+        int x = oldMinX + 16 * (int(i) / (oldD + 2) - 1), z = oldMinZ + 16 * (int(i) % (oldD + 2) - 1);
+        if(drawCell(x, z) < 0) c->unbindVBOdata(*m_arena);
+    }
+}
+
+void Terrain::chunkMeshed(Chunk* c) {
+    m_meshedChunks_mutex.lock();
+    m_meshedChunks.push_back(c);
+    m_meshedChunks_mutex.unlock();
+}
+
+void Terrain::takeMeshedChunks() {
+    std::vector<Chunk*> meshed;
+    m_meshedChunks_mutex.lock();
+    meshed.swap(m_meshedChunks);
+    m_meshedChunks_mutex.unlock();
+
+    for(Chunk* c: meshed) {
+        int cell = drawCell(c->origin.x, c->origin.y);
+        if(cell < 0) continue;
+        bool inRange = inDrawRange(cell);
+        if(m_drawGrid[cell] == nullptr) {
+            m_drawGrid[cell] = c;
+            if(inRange) m_drawChunks++;
+        }
+        if(inRange) queueUpload(c);
+    }
+}
 
-    //check if we should clear unloaded chunk vbos
-    for(int x = minX - 32; x < maxX + 32; x+= 16) {
-        if(hasChunkAt(x, minZ - 32)) {
-            uPtr<Chunk> &chunk = getChunkAt(x, minZ - 32);
-            if(chunk->dataGen && chunk->dataBound) {
-                chunk->unbindVBOdata();
-            }
-        }
-        if(hasChunkAt(x, maxZ+16)) { //not that we don't actually hit maxZ in the drawloop
-            uPtr<Chunk> &chunk = getChunkAt(x, maxZ+16);
-            if(chunk->dataGen && chunk->dataBound) {
-                chunk->unbindVBOdata();
-            }
+void Terrain::queueUpload(Chunk* c) {
+    if(c->uploadQueued) return;
+    c->uploadQueued = true;
+    m_uploads.push_back(c);
+}
+
+static glm::vec2 centerOf(const Chunk* c) {
+    return glm::vec2(c->origin) + glm::vec2(8);
+}
+
+// detail level of c when the camera is at eye, 0 is full detail. Near a
+// boundary it stays at the level it had so it doesn't flip back and forth
+static int lodFor(const Chunk* c, glm::vec3 eye) {
+    float dist = glm::length(glm::vec2(c->origin) + glm::vec2(8) - glm::vec2(eye.x, eye.z));
+    int level = glm::clamp(int(dist / LOD_DISTANCE), 0, LOD_LEVELS);
+    if(level != c->lod && glm::abs(dist - LOD_DISTANCE * glm::max(level, c->lod)) < LOD_HYSTERESIS) return c->lod;
+    return level;
+}
+
+void Terrain::requestLOD(Chunk* c, int level) {
+    //something is meshing it already, or this level is built and waiting to go up
+    if(c->jobs > 0 || c->lodPending() == level) return;
+    if(!c->beginJob()) return;
+    LODWorker* lw = new LODWorker(this, c, level);
+    VBOWorkers.start(lw, centerOf(c));
+}
+
+void Terrain::runUploads(glm::vec3 eye) {
+    m_renderStats.uploadBytes = 0;
+    if(!m_uploads.empty()) trimGPUMeshes(UPLOAD_BYTES_PER_FRAME);
+    auto start = std::chrono::high_resolution_clock::now();
+    //from chunk centers
+    glm::vec2 eye2(eye.x - 8, eye.z - 8);
+    auto dist = [eye2](const Chunk* c) {
+        glm::vec2 d = glm::vec2(c->origin) - eye2;
+        return glm::dot(d, d);
+    };
+    std::sort(m_uploads.begin(), m_uploads.end(), [&dist](const Chunk* a, const Chunk* b) {
+        return dist(a) < dist(b);
+    });
+    size_t bytes = 0, done = 0;
+    for(; done < m_uploads.size(); done++) {
+        Chunk* c = m_uploads[done];
+        int cell = drawCell(c->origin.x, c->origin.y);
+        c->lod = lodFor(c, eye);
+        //far chunks only take their reduced detail mesh, near ones their sections
+        bool lod = c->lod > 0 && c->lodPending() == c->lod;
+        bool sections = c->lod == 0 && (!c->dataBound || c->dirtySections) && c->hasMesh();
+        //left the range since, moveRenderSet queues it again if it comes back.
+        //One with nothing to upload waits for the visibility walk to mesh it
+        if(cell < 0 || m_drawGrid[cell] != c || !inDrawRange(cell) || (!lod && !sections)) {
+            c->uploadQueued = false;
+            continue;
+        }
+        int n = lod ? c->lodUploadBytes() : c->uploadBytes();
+        if(arenaBytes() + n > m_vramBudget) break;
+        if(bytes > 0) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            if(bytes + n > UPLOAD_BYTES_PER_FRAME || ms > UPLOAD_MS_PER_FRAME) break;
+        }
+        //all of the chunk's writes go in one stretch of the ring. No room means the GPU
+        //hasn't finished with it yet, and waiting for it is the hitch we're avoiding
+        if(!m_arena->staging.reserve(n) && bytes > 0) break;
+        c->uploadQueued = false;
+        if(lod) c->bindLODdata(*m_arena);
+        else refreshChunk(c, *m_arena);
+        bytes += n;
+    }
+    m_uploads.erase(m_uploads.begin(), m_uploads.begin() + done);
+    m_arena->staging.endFrame();
+    m_renderStats.uploadBytes = bytes;
+    m_renderStats.uploadsQueued = m_uploads.size();
+}
+
+size_t Terrain::arenaBytes() const {
+    return size_t(m_arena->vertices.used()) * sizeof(PackedVertex);
+}
+
+void Terrain::trimGPUMeshes(size_t headroom) {
+    if(arenaBytes() + headroom <= m_vramBudget) return;
+    std::vector<Chunk*> bound;
+    for(Chunk* c: m_drawGrid) {
+        if(c && (c->dataBound || c->lodLevel()) && c->lastDrawn < m_frame - 1) bound.push_back(c);
+    }
+    std::sort(bound.begin(), bound.end(), [](const Chunk* a, const Chunk* b) {
+        return a->lastDrawn < b->lastDrawn;
+    });
+    for(Chunk* c: bound) {
+        if(arenaBytes() + headroom <= m_vramBudget) break;
+        c->unbindVBOdata(*m_arena);
+        m_renderStats.meshesEvicted++;
+    }
+}
+
+// one step of the visibility walk: a section, the face it was entered
+// through, and every direction taken since the camera
+struct VisibilityStep {
+    int gx, gz, s;
+    int from;
+    int dirs;
+};
+
+void Terrain::findVisibleSections(glm::vec3 eye, const Frustum &frustum) {
+    int w = m_drawW, d = m_drawD;
+    for(int i: m_reachedColumns) m_visibleSections[i] = 0;
+    m_reachedColumns.clear();
+    int gx = int(glm::floor((eye.x - m_drawMinX) / 16)), gz = int(glm::floor((eye.z - m_drawMinZ) / 16));
+    //nothing to wall the camera off from the world, or no section to start in
+    if(eye.y < 0 || gx < 0 || gx >= w || gz < 0 || gz >= d) {
+        for(int i = 0; i < w * d; i++) {
+            m_visibleSections[i] = 0xffff;
+            m_reachedColumns.push_back(i);
+        }
+        return;
+    }
+
+    static const glm::ivec3 step[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    std::vector<VisibilityStep> queue;
+    if(eye.y >= 256) {
+        //above the world, looking in through the tops of the columns
+        for(int i = 0; i < w * d; i++) {
+            m_visibleSections[i] = 1 << 15;
+            m_reachedColumns.push_back(i);
+            queue.push_back({i / d, i % d, 15, YPOS, 1 << YNEG});
         }
     }
-    //dont need to recheck corners, lower bounds by 1 chunk
-    for(int z = minZ - 16; z < maxZ+16; z+= 16) {
-        if(hasChunkAt(minX-32, z)) {
-            uPtr<Chunk> &chunk = getChunkAt(minX-32, z);
-            if(chunk->dataGen && chunk->dataBound) {
-                chunk->unbindVBOdata();
-            }
+    else {
+        int s = int(eye.y) >> 4;
+        m_visibleSections[gx * d + gz] = 1 << s;
+        m_reachedColumns.push_back(gx * d + gz);
+        queue.push_back({gx, gz, s, -1, 0});
+    }
+
+    for(size_t head = 0; head < queue.size(); head++) {
+        VisibilityStep cur = queue[head];
+        Chunk* c = m_drawGrid[(cur.gx + 1) * (d + 2) + cur.gz + 1];
+        //unloaded columns don't block anything
+        uint64_t visibility = c ? c->sectionVisibility(cur.s) : VISIBLE_ALL;
+        for(int dir = 0; dir < 6; dir++) {
+            //never turn back, every section is reached from the camera's side
+            if(cur.dirs >> (dir ^ 1) & 1) continue;
+            if(cur.from >= 0 && !seesThrough(visibility, cur.from, dir)) continue;
+            int nx = cur.gx + step[dir].x, ns = cur.s + step[dir].y, nz = cur.gz + step[dir].z;
+            if(nx < 0 || nx >= w || nz < 0 || nz >= d || ns < 0 || ns >= 16) continue;
+            uint16_t &seen = m_visibleSections[nx * d + nz];
+            if(seen >> ns & 1) continue;
+            glm::vec3 lo(m_drawMinX + 16 * nx, 16 * ns, m_drawMinZ + 16 * nz);
+            if(!frustum.intersects(lo, lo + glm::vec3(16))) continue;
+            if(seen == 0) m_reachedColumns.push_back(nx * d + nz);
+            seen |= 1 << ns;
+            queue.push_back({nx, nz, ns, dir ^ 1, cur.dirs | 1 << dir});
         }
-        if(hasChunkAt(maxX+16, z)) { //not that we don't actually hit maxZ in the drawloop
-            uPtr<Chunk> &chunk = getChunkAt(maxX+16, z);
-            if(chunk->dataGen && chunk->dataBound) {
-                chunk->unbindVBOdata();
-            }
+    }
+}
+
+void Terrain::setJobViews(const std::vector<glm::vec3> &eyes) {
+    terrainWorkers.setViews(eyes);
+}
+
+void Terrain::draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram, const Camera &camera) {
+    if(!m_arena) m_arena = mkU<ChunkArena>(mp_context);
+    m_arena->clear();
+    m_frame++;
+    Frustum frustum = camera.getFrustum();
+    //whatever is still queued now goes by where the player is and looks
+    terrainWorkers.setView(camera.mcr_position, camera.m_forward);
+    VBOWorkers.setView(camera.mcr_position, camera.m_forward);
+    moveRenderSet(minX, maxX, minZ, maxZ);
+    takeMeshedChunks();
+    runUploads(camera.mcr_position);
+
+    glm::vec3 eye = camera.mcr_position;
+    findVisibleSections(eye, frustum);
+    int occluded = 0, reduced = 0;
+    for(int i: m_reachedColumns) {
+        int gx = i / m_drawD, gz = i % m_drawD;
+        Chunk* chunk = m_drawGrid[(gx + 1) * (m_drawD + 2) + gz + 1];
+        if(chunk == nullptr) continue;
+        int sections = m_visibleSections[i] & chunk->meshSections;
+        if(sections == 0) {
+            occluded++;
+            continue;
+        }
+        int x = m_drawMinX + 16 * gx, z = m_drawMinZ + 16 * gz;
+        chunk->lastDrawn = m_frame;
+        chunk->lod = lodFor(chunk, eye);
+        //whichever mesh is up stands in until the one we want is
+        bool full;
+        if(chunk->lod == 0) {
+            //in sight but trimmed off the GPU or drawn reduced, bring the sections back
+            if(!chunk->dataBound && !chunk->uploadQueued) {
+                if(chunk->hasMesh()) queueUpload(chunk);
+                else if(chunk->jobs == 0) createVBOThread(chunk);
+            }
+            if(chunk->dataBound && chunk->lodLevel()) chunk->unbindLODdata(*m_arena);
+            full = chunk->dataBound || !chunk->lodLevel();
+        }
+        else {
+            if(chunk->lodLevel() != chunk->lod || chunk->lodStale()) requestLOD(chunk, chunk->lod);
+            //full detail isn't coming back soon, drop it on the GPU and the cpu
+            if(chunk->lodLevel() == chunk->lod && (chunk->dataBound || (chunk->meshSections && chunk->hasMesh()))) {
+                chunk->unbindSections(*m_arena);
+            }
+            full = !chunk->lodLevel();
+        }
+        if(full) {
+            chunk->queueDraw(*m_arena, x, z, sections);
+        }
+        else {
+            chunk->queueDrawLOD(*m_arena, x, z);
+            reduced++;
         }
     }
+
+    //every chunk at once, opaque layers then clear ones
+    m_arena->upload();
+    m_renderStats.chunks = m_arena->chunks();
+    m_renderStats.culled = m_drawChunks - m_renderStats.chunks - occluded;
+    m_renderStats.occluded = occluded;
+    m_renderStats.reduced = reduced;
+    m_renderStats.drawCalls = shaderProgram->drawChunks(*m_arena);
+    m_renderStats.arenaBytes = arenaBytes();
+    m_renderStats.vramBudget = m_vramBudget;
+    m_renderStats.arenaCapacity = size_t(m_arena->vertices.capacity()) * sizeof(PackedVertex);
+    trackLoading();
+}
+
+void Terrain::trackLoading() {
+    auto now = std::chrono::steady_clock::now();
+    bool busy = !terrainWorkers.idle() || !VBOWorkers.idle() || !m_uploads.empty();
+    //the work may have been queued well before this frame, at spawn before the first one
+    if(busy && !m_renderStats.loading) m_loadStart = std::min(terrainWorkers.busySince(), VBOWorkers.busySince());
+    if(busy || m_renderStats.loading) m_renderStats.loadMs = std::chrono::duration<double, std::milli>(now - m_loadStart).count();
+    if(!busy && m_renderStats.loading && !m_spawnLoaded) {
+        m_spawnLoaded = true;
+        qDebug() << "spawn fully loaded in" << m_renderStats.loadMs << "ms";
+    }
+    m_renderStats.loading = busy;
+    m_renderStats.genQueued = terrainWorkers.queued();
+    m_renderStats.meshQueued = VBOWorkers.queued();
 }
 
 void Terrain::createSpawn()
@@ -590,14 +917,15 @@ void Terrain::createSpawn()
         }
         //finds available spawn chunks in same spiral pattern
         if(done) {
+            BlockCursor cur(*this);
             for(glm::vec2 pp: spiral) {
-                Chunk* c = getChunkAt(pp.x, pp.y).get();
+                Chunk* c = cur.chunkAt(pp.x, pp.y);
                 //checks if it is a water biome
                 if(c->biome!= OCEAN && c->biome!=RIVER){
                     for(int dx = 0; dx < 16; dx++) {
                         for(int dy = 0; dy < 16; dy++) {
                             //checks if the top block is a solid
-                            if(!isTransparent(dx, c->heightMap[dx][dy]-1, dy, c)) {
+                            if(!isTransparent(cur, pp.x+dx, c->heightMap[dx][dy]-1, pp.y+dy)) {
                                 worldSpawn = glm::vec3(pp.x+dx, c->heightMap[dx][dy]+1, pp.y+dy);
                                 setSpawn = true;
                                 break;
@@ -623,20 +951,20 @@ void Terrain::createGroundThread(glm::vec2 p) {
     if(hasChunkAt(p.x, p.y)) return;
 
     BlockTypeWorker* btw = new BlockTypeWorker(this, p.x, p.y);
-    terrainWorkers.start(btw);
+    terrainWorkers.start(btw, p + glm::vec2(8));
 }
 
 void Terrain::createVBOThread(Chunk* c) {
-    VBOWorker* vw = new VBOWorker(c);
-    VBOWorkers.start(vw);
+    //chunk is on its way out, nothing to mesh
+    if(!c->beginJob()) return;
+    VBOWorker* vw = new VBOWorker(this, c);
+    VBOWorkers.start(vw, centerOf(c));
 }
 
 void Terrain::processMegaStructure(const std::vector<Structure>& s) {
     for(const Structure &st: s) {
-        if(hasChunkAt(st.pos.x, st.pos.y)) {
-            buildStructure(st);
-        }
-        else{
+        //one lookup, the chunk can be evicted between a hasChunkAt and building
+        if(!buildStructure(st)) {
             int x = 16*static_cast<int>(glm::floor(st.pos.x / 16.f));
             int z = 16*static_cast<int>(glm::floor(st.pos.y / 16.f));
             metaSubStructures_mutex.lock();
@@ -649,11 +977,15 @@ void Terrain::processMegaStructure(const std::vector<Structure>& s) {
     }
 }
 
-void Terrain::buildStructure(const Structure& s) {
+bool Terrain::buildStructure(const Structure& s) {
     int xx = s.pos.x;
     int zz = s.pos.y;
 
-    Chunk* c = getChunkAt(xx, zz).get();
+    //structures write hundreds of blocks around one spot. The cursor's epoch guard
+    //keeps c alive until we're done even if it gets evicted meanwhile
+    BlockCursor cur(*this);
+    Chunk* c = cur.chunkAt(xx, zz);
+    if(c == nullptr) return false;
     glm::ivec2 chunkOrigin = glm::ivec2(16*static_cast<int>(glm::floor(xx / 16.f)),
                                         16*static_cast<int>(glm::floor(zz / 16.f)));
     int x = chunkOrigin.x;
@@ -671,62 +1003,62 @@ void Terrain::buildStructure(const Structure& s) {
             int yat = ymin+ymax-dy;
             switch(dy) {
                 case 0:
-                    setBlockAt(xx, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-1, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+1, OAK_LEAVES, isEmpty);
                     break;
                 case 1:
-                    setBlockAt(xx, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-1, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+1, OAK_LEAVES, isEmpty);
                     if(noise1D(glm::vec3(xx+1, yat, zz+1), SEED.getSeed(7785.015,5766.378,649.792,6102.897)) > 0.5) {
-                        setBlockAt(xx+1, yat, zz+1, OAK_LEAVES);
+                        setBlockAt(cur, xx+1, yat, zz+1, OAK_LEAVES);
                     }
                     if(noise1D(glm::vec3(xx+1, yat, zz-1), SEED.getSeed(1420.159,7503.537,1373.417,2979.007)) > 0.5) {
-                        setBlockAt(xx+1, yat, zz-1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+1, yat, zz-1, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-1, yat, zz+1), SEED.getSeed(464.713,1450.085,4383.409,6818.919)) > 0.5) {
-                        setBlockAt(xx-1, yat, zz+1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-1, yat, zz+1, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-1, yat, zz-1), SEED.getSeed(8513.165,8543.726,1277.831,9162.371)) > 0.5) {
-                        setBlockAt(xx-1, yat, zz-1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-1, yat, zz-1, OAK_LEAVES, isEmpty);
                     }
                     break;
                 default: //2, 3
                     for(int dx = xx-2; dx <= xx+2; dx++) {
                         for(int dz = zz-1; dz <= zz+1; dz++) {
                             if(dx != xx || dz != zz) {
-                                setBlockAt(dx, yat, dz, OAK_LEAVES, isEmpty);
+                                setBlockAt(cur, dx, yat, dz, OAK_LEAVES, isEmpty);
                             }
                         }
                     }
-                    setBlockAt(xx-1, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz-2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-2, OAK_LEAVES);
-                    setBlockAt(xx+1, yat, zz-2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz-2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-2, OAK_LEAVES);
+                    setBlockAt(cur, xx+1, yat, zz-2, OAK_LEAVES, isEmpty);
                     if(noise1D(glm::vec3(xx+2, yat, zz+2), SEED.getSeed(7798.159,7306.237,4491.404,966.212)) > 0.5) {
-                        setBlockAt(xx+2, yat, zz+2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+2, yat, zz+2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx+2, yat, zz-2), SEED.getSeed(3953.665,7624.82,5599.103,4681.367)) > 0.5) {
-                        setBlockAt(xx+2, yat, zz-2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+2, yat, zz-2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-2, yat, zz+2), SEED.getSeed(431.931,9230.515,2698.152,3252.572)) > 0.5) {
-                        setBlockAt(xx-2, yat, zz+2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-2, yat, zz+2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-2, yat, zz-2), SEED.getSeed(2799.543,9511.908,2472.754,4812.237)) > 0.5) {
-                        setBlockAt(xx-2, yat, zz-2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-2, yat, zz-2, OAK_LEAVES, isEmpty);
                     }
                     break;
             }
         }
         for(int y = ymin; y < ymin+ymax; y++){
-            setBlockAt(xx, y, zz, OAK_LOG);
+            setBlockAt(cur, xx, y, zz, OAK_LOG);
         }
         break;
     }
@@ -739,62 +1071,62 @@ void Terrain::buildStructure(const Structure& s) {
             int yat = ymin+ymax-dy;
             switch(dy) {
                 case 0:
-                    setBlockAt(xx, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-1, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+1, OAK_LEAVES, isEmpty);
                     break;
                 case 1:
-                    setBlockAt(xx, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-1, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-1, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+1, OAK_LEAVES, isEmpty);
                     if(noise1D(glm::vec3(xx+1, yat, zz+1), SEED.getSeed(7785.015,5766.378,649.792,6102.897)) > 0.5) {
-                        setBlockAt(xx+1, yat, zz+1, OAK_LEAVES);
+                        setBlockAt(cur, xx+1, yat, zz+1, OAK_LEAVES);
                     }
                     if(noise1D(glm::vec3(xx+1, yat, zz-1), SEED.getSeed(1420.159,7503.537,1373.417,2979.007)) > 0.5) {
-                        setBlockAt(xx+1, yat, zz-1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+1, yat, zz-1, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-1, yat, zz+1), SEED.getSeed(464.713,1450.085,4383.409,6818.919)) > 0.5) {
-                        setBlockAt(xx-1, yat, zz+1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-1, yat, zz+1, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-1, yat, zz-1), SEED.getSeed(8513.165,8543.726,1277.831,9162.371)) > 0.5) {
-                        setBlockAt(xx-1, yat, zz-1, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-1, yat, zz-1, OAK_LEAVES, isEmpty);
                     }
                     break;
                 default: //2, 3
                     for(int dx = xx-2; dx <= xx+2; dx++) {
                         for(int dz = zz-1; dz <= zz+1; dz++) {
                             if(dx != xx || dz != zz) {
-                                setBlockAt(dx, yat, dz, OAK_LEAVES, isEmpty);
+                                setBlockAt(cur, dx, yat, dz, OAK_LEAVES, isEmpty);
                             }
                         }
                     }
-                    setBlockAt(xx-1, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx+1, yat, zz+2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx-1, yat, zz-2, OAK_LEAVES, isEmpty);
-                    setBlockAt(xx, yat, zz-2, OAK_LEAVES);
-                    setBlockAt(xx+1, yat, zz-2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx+1, yat, zz+2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx-1, yat, zz-2, OAK_LEAVES, isEmpty);
+                    setBlockAt(cur, xx, yat, zz-2, OAK_LEAVES);
+                    setBlockAt(cur, xx+1, yat, zz-2, OAK_LEAVES, isEmpty);
                     if(noise1D(glm::vec3(xx+2, yat, zz+2), SEED.getSeed(7798.159,7306.237,4491.404,966.212)) > 0.5) {
-                        setBlockAt(xx+2, yat, zz+2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+2, yat, zz+2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx+2, yat, zz-2), SEED.getSeed(3953.665,7624.82,5599.103,4681.367)) > 0.5) {
-                        setBlockAt(xx+2, yat, zz-2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx+2, yat, zz-2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-2, yat, zz+2), SEED.getSeed(431.931,9230.515,2698.152,3252.572)) > 0.5) {
-                        setBlockAt(xx-2, yat, zz+2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-2, yat, zz+2, OAK_LEAVES, isEmpty);
                     }
                     if(noise1D(glm::vec3(xx-2, yat, zz-2), SEED.getSeed(2799.543,9511.908,2472.754,4812.237)) > 0.5) {
-                        setBlockAt(xx-2, yat, zz-2, OAK_LEAVES, isEmpty);
+                        setBlockAt(cur, xx-2, yat, zz-2, OAK_LEAVES, isEmpty);
                     }
                     break;
             }
         }
         for(int y = ymin; y < ymin+ymax; y++){
-            setBlockAt(xx, y, zz, BIRCH_LOG);
+            setBlockAt(cur, xx, y, zz, BIRCH_LOG);
         }
         break;
     }
@@ -806,17 +1138,17 @@ void Terrain::buildStructure(const Structure& s) {
         int ymin = c->heightMap[xx-x][zz-z];
         int ymax = 5+7*noise1D(glm::vec2(xx,zz), SEED.getSeed(9606.874,301.036,378.273));
         float leaves = 1;
-        setBlockAt(xx, ymax, zz, SPRUCE_LOG);
+        setBlockAt(cur, xx, ymax, zz, SPRUCE_LOG);
         for(int y = ymax+ymin-1; y > ymax; y--) {
             float transition = noise1D(glm::vec3(xx, y, zz), SEED.getSeed(7656.579,4083.936,4656.875,8280.13));
             if(leaves == 0){
                 leaves++;
             }
             else if(leaves == 1) { //radius 1
-                setBlockAt(xx-1, y, zz, OAK_LEAVES);
-                setBlockAt(xx+1, y, zz, OAK_LEAVES);
-                setBlockAt(xx, y, zz-1, OAK_LEAVES);
-                setBlockAt(xx, y, zz+1, OAK_LEAVES);
+                setBlockAt(cur, xx-1, y, zz, OAK_LEAVES);
+                setBlockAt(cur, xx+1, y, zz, OAK_LEAVES);
+                setBlockAt(cur, xx, y, zz-1, OAK_LEAVES);
+                setBlockAt(cur, xx, y, zz+1, OAK_LEAVES);
                 if(transition < 0.3) leaves--;
                 else leaves++;
             }
@@ -824,7 +1156,7 @@ void Terrain::buildStructure(const Structure& s) {
                 for(int xxx = xx-2; xxx <= xx+2; xxx++) {
                     for(int zzz = zz-2; zzz <= zz+2; zzz++) {
                         if(abs(xxx-xx)+abs(zzz-zz) != 4)
-                            setBlockAt(xxx, y, zzz, OAK_LEAVES);
+                            setBlockAt(cur, xxx, y, zzz, OAK_LEAVES);
                     }
                 }
                 if(transition<0.7) leaves--;
@@ -834,28 +1166,28 @@ void Terrain::buildStructure(const Structure& s) {
                 for(int xxx = xx-3; xxx <= xx+3; xxx++) {
                     for(int zzz = zz-3; zzz <= zz+3; zzz++) {
                         if(abs(xxx-xx)+abs(zzz-zz) != 6)
-                            setBlockAt(xxx, y, zzz, OAK_LEAVES);
+                            setBlockAt(cur, xxx, y, zzz, OAK_LEAVES);
                     }
                 }
                 leaves--;
             }
-            setBlockAt(xx, y, zz, SPRUCE_LOG);
+            setBlockAt(cur, xx, y, zz, SPRUCE_LOG);
         }
-        setBlockAt(xx, ymax+ymin, zz, OAK_LEAVES);
+        setBlockAt(cur, xx, ymax+ymin, zz, OAK_LEAVES);
         break;
     }
     case PINE_TREE: {
         int ymin = c->heightMap[xx-x][zz-z];
         int ymax = 5+4*noise1D(glm::vec2(xx,zz), SEED.getSeed(9606.874,301.036,378.273));
-        setBlockAt(xx, ymax, zz, SPRUCE_LOG);
+        setBlockAt(cur, xx, ymax, zz, SPRUCE_LOG);
         for(int y = ymax+ymin-1; y > ymin; y--) {
             if(y > ymin+ymax-4) {
-                setBlockAt(xx-1, y, zz, OAK_LEAVES);
-                setBlockAt(xx+1, y, zz, OAK_LEAVES);
-                setBlockAt(xx, y, zz-1, OAK_LEAVES);
-                setBlockAt(xx, y, zz+1, OAK_LEAVES);
+                setBlockAt(cur, xx-1, y, zz, OAK_LEAVES);
+                setBlockAt(cur, xx+1, y, zz, OAK_LEAVES);
+                setBlockAt(cur, xx, y, zz-1, OAK_LEAVES);
+                setBlockAt(cur, xx, y, zz+1, OAK_LEAVES);
             }
-            setBlockAt(xx, y, zz, SPRUCE_LOG);
+            setBlockAt(cur, xx, y, zz, SPRUCE_LOG);
         }
         break;
     }
@@ -863,25 +1195,25 @@ void Terrain::buildStructure(const Structure& s) {
         int ymin = c->heightMap[xx-x][zz-z];
         int ymax = 2+3*noise1D(glm::vec2(xx,zz), SEED.getSeed(9606.874,301.036,378.273));
         for(int y = ymin; y<= ymax+ymin; y++) {
-            setBlockAt(xx, y, zz, CACTUS);
+            setBlockAt(cur, xx, y, zz, CACTUS);
         }
         break;
     }
     case VILLAGE_CENTER:
         for(int i = -1; i <= 1; i++) {
             for(int j = -1; j <= 1; j++) {
-                setBlockAt(xx+i, 1000, zz+j, STONE);
+                setBlockAt(cur, xx+i, 1000, zz+j, STONE);
             }
         }
         for(int i = -5; i <= 5; i++) {
             for(int j = -5; j <= 5; j++) {
                 float f = noise1D(glm::vec2(xx+i, zz+j), SEED.getSeed(57091, 850135, 323));
                 if(f < 0.33)
-                    setBlockAt(xx+i, 1000-1, zz+j, PATH);
+                    setBlockAt(cur, xx+i, 1000-1, zz+j, PATH);
                 else if(f < 0.66)
-                    setBlockAt(xx+i, 1000-1, zz+j, STONE);
+                    setBlockAt(cur, xx+i, 1000-1, zz+j, STONE);
                 else
-                    setBlockAt(xx+i, 1000-1, zz+j, GRASS_BLOCK);
+                    setBlockAt(cur, xx+i, 1000-1, zz+j, GRASS_BLOCK);
             }
         }
         break;
@@ -889,12 +1221,12 @@ void Terrain::buildStructure(const Structure& s) {
         glm::vec2 perp = glm::vec2(dirToVec(s.orient).z, dirToVec(s.orient).x);
         if(c->getBlockAt(xx-x, c->heightMap[xx-x][zz-z]-1, zz-z) == WATER) {
             for(int i = -1; i <= 1; i++) {
-                setBlockAt(xx+i*perp.x, 1000-1, zz+i*perp.y, OAK_PLANKS);
+                setBlockAt(cur, xx+i*perp.x, 1000-1, zz+i*perp.y, OAK_PLANKS);
             }
         }
         else{
             for(int i = -1; i <= 1; i++) {
-                setBlockAt(xx+i*perp.x, 1000-1, zz+i*perp.y, PATH);
+                setBlockAt(cur, xx+i*perp.x, 1000-1, zz+i*perp.y, PATH);
             }
         }
         break;
@@ -910,33 +1242,33 @@ void Terrain::buildStructure(const Structure& s) {
             for(int j = -3; j <= 3; j++) {
                 for(int y = 0; y < 8; y++) {
                     pp = glm::vec2(xx, zz) + perp*(float)j + back*(float)i;
-                    setBlockAt(pp.x, floorh+y, pp.y, EMPTY);
+                    setBlockAt(cur, pp.x, floorh+y, pp.y, EMPTY);
                 }
             }
         }
         for(int i = -1; i <= 5; i++) {
             for(int j = -3; j <= 3; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)j + back*(float)i;
-                setBlockAt(pp.x, floorh-1, pp.y, baseBlock, isTransparent);
+                setBlockAt(cur, pp.x, floorh-1, pp.y, baseBlock, isTransparent);
             }
         }
         for(int i = 0; i <= 4; i++) {
             for(int j = -2; j <= 2; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)j + back*(float)i;
-                setBlockAt(pp.x, floorh-2, pp.y, DIRT, isTransparent);
+                setBlockAt(cur, pp.x, floorh-2, pp.y, DIRT, isTransparent);
             }
         }
         for(int i = 1; i <= 3; i++) {
             for(int j = -1; j <= 1; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)j + back*(float)i;
-                setBlockAt(pp.x, floorh-3, pp.y, DIRT, isTransparent);
+                setBlockAt(cur, pp.x, floorh-3, pp.y, DIRT, isTransparent);
             }
         }
         //floor
         for(int i = -1; i <= 1; i++) {
             for(int j = 1; j <= 3; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         //pillars
@@ -944,7 +1276,7 @@ void Terrain::buildStructure(const Structure& s) {
             for(int j = 0; j <= 4; j+= 4){
                 for(int y = 0; y < 4; y++) {
                     pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                    setBlockAt(pp.x, floorh+y, pp.y, OAK_LOG);
+                    setBlockAt(cur, pp.x, floorh+y, pp.y, OAK_LOG);
                 }
             }
         }
@@ -953,7 +1285,7 @@ void Terrain::buildStructure(const Structure& s) {
             for(int j = 1; j<=3; j++) {
                 for(int y = 0; y < 4; y++){
                     pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                    setBlockAt(pp.x, floorh+y, pp.y, COBBLESTONE);
+                    setBlockAt(cur, pp.x, floorh+y, pp.y, COBBLESTONE);
                 }
             }
         }
@@ -961,45 +1293,45 @@ void Terrain::buildStructure(const Structure& s) {
             for(int j = 0; j <= 4; j+= 4) {
                 for(int y = 0; y < 4; y++){
                     pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                    setBlockAt(pp.x, floorh+y, pp.y, COBBLESTONE);
+                    setBlockAt(cur, pp.x, floorh+y, pp.y, COBBLESTONE);
                 }
             }
         }
         //carve out windows+door
         pp = glm::vec2(xx, zz) - perp*2.f + back*2.f;
-        setBlockAt(pp.x, floorh+2, pp.y, GLASS);
+        setBlockAt(cur, pp.x, floorh+2, pp.y, GLASS);
         pp = glm::vec2(xx, zz) + perp*2.f + back*2.f;
-        setBlockAt(pp.x, floorh+2, pp.y, GLASS);
+        setBlockAt(cur, pp.x, floorh+2, pp.y, GLASS);
         pp = glm::vec2(xx, zz) + back*4.f;
-        setBlockAt(pp.x, floorh+2, pp.y, GLASS);
+        setBlockAt(cur, pp.x, floorh+2, pp.y, GLASS);
 
-        setBlockAt(xx, floorh+1, zz, EMPTY);
-        setBlockAt(xx, floorh+2, zz, EMPTY);
+        setBlockAt(cur, xx, floorh+1, zz, EMPTY);
+        setBlockAt(cur, xx, floorh+2, zz, EMPTY);
 
         //roof
         for(int i = -3; i <= 3; i++) {
-            setBlockAt(xx+i+2.f*back.x, floorh+4, zz+3+2.f*back.y, OAK_PLANKS);
-            setBlockAt(xx+i+2.f*back.x, floorh+4, zz-3+2.f*back.y, OAK_PLANKS);
-            setBlockAt(xx+3+2.f*back.x, floorh+4, zz+i+2.f*back.y, OAK_PLANKS);
-            setBlockAt(xx-3+2.f*back.x, floorh+4, zz+i+2.f*back.y, OAK_PLANKS);
+            setBlockAt(cur, xx+i+2.f*back.x, floorh+4, zz+3+2.f*back.y, OAK_PLANKS);
+            setBlockAt(cur, xx+i+2.f*back.x, floorh+4, zz-3+2.f*back.y, OAK_PLANKS);
+            setBlockAt(cur, xx+3+2.f*back.x, floorh+4, zz+i+2.f*back.y, OAK_PLANKS);
+            setBlockAt(cur, xx-3+2.f*back.x, floorh+4, zz+i+2.f*back.y, OAK_PLANKS);
         }
         for(int i = -2; i <= 2; i++) {
             for(int j = 0; j < 2; j++){
-                setBlockAt(xx+i+2.f*back.x, floorh+4+j, zz+2+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx+i+2.f*back.x, floorh+4+j, zz-2+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx+2+2.f*back.x, floorh+4+j, zz+i+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx-2+2.f*back.x, floorh+4+j, zz+i+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+i+2.f*back.x, floorh+4+j, zz+2+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+i+2.f*back.x, floorh+4+j, zz-2+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+2+2.f*back.x, floorh+4+j, zz+i+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx-2+2.f*back.x, floorh+4+j, zz+i+2.f*back.y, OAK_PLANKS);
             }
         }
         for(int i = -1; i <= 1; i++) {
             for(int j = 0; j < 2; j++){
-                setBlockAt(xx+i+2.f*back.x, floorh+5+j, zz+1+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx+i+2.f*back.x, floorh+5+j, zz-1+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx+1+2.f*back.x, floorh+5+j, zz+i+2.f*back.y, OAK_PLANKS);
-                setBlockAt(xx-1+2.f*back.x, floorh+5+j, zz+i+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+i+2.f*back.x, floorh+5+j, zz+1+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+i+2.f*back.x, floorh+5+j, zz-1+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx+1+2.f*back.x, floorh+5+j, zz+i+2.f*back.y, OAK_PLANKS);
+                setBlockAt(cur, xx-1+2.f*back.x, floorh+5+j, zz+i+2.f*back.y, OAK_PLANKS);
             }
         }
-        setBlockAt(xx+2.f*back.x, floorh+7, zz+2.f*back.y, OAK_PLANKS);
+        setBlockAt(cur, xx+2.f*back.x, floorh+7, zz+2.f*back.y, OAK_PLANKS);
         break;
     }
     case VILLAGE_LIBRARY: {
@@ -1013,7 +1345,7 @@ void Terrain::buildStructure(const Structure& s) {
             for(int j = -1; j <= 9; j++) {
                 for(int y = 0; y < 10; y++){
                      pp = glm::vec2(xx, zz) + perp*(float)i+back*(float)j;
-                    setBlockAt(pp.x, floorh+y, pp.y, EMPTY);
+                    setBlockAt(cur, pp.x, floorh+y, pp.y, EMPTY);
                 }
             }
         }
@@ -1021,332 +1353,341 @@ void Terrain::buildStructure(const Structure& s) {
             for(int i = -8+y; i <= 8-y; i++) {
                 for(int j = -1+y; j <= 9-y; j++) {
                     pp = glm::vec2(xx, zz) + perp*(float)i+back*(float)j;
-                    setBlockAt(pp.x, floorh-y-1, pp.y, baseBlock, isTransparent);
+                    setBlockAt(cur, pp.x, floorh-y-1, pp.y, baseBlock, isTransparent);
                 }
             }
         }
         //layer 1
         for(int i = -1; i <= 1; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         }
         for(int i = -2; i <= 2; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i+back;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         }
         for(int i = 2; i <= 8; i++) {
             for(int j = -7; j <= 7; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)j+back*(float)i;
-                setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+                setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
             }
         }
         //layer 2
         floorh++;
         pp = glm::vec2(xx, zz) + perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) + 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - perp*2.f + 4.f*back;
-        setBlockAt(pp.x, floorh, pp.y, BOOKSHELF);
+        setBlockAt(cur, pp.x, floorh, pp.y, BOOKSHELF);
         pp = glm::vec2(xx, zz) + perp*2.f + 4.f*back;
-        setBlockAt(pp.x, floorh, pp.y, BOOKSHELF);
+        setBlockAt(cur, pp.x, floorh, pp.y, BOOKSHELF);
         for(int i = 3; i <= 7; i++){
             pp = glm::vec2(xx, zz) - perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = 2; i <= 8; i++) {
             pp = glm::vec2(xx, zz) - perp*7.f + back*(float)i;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + perp*7.f + back*(float)i;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -7; i <= 7; i++){
             pp = glm::vec2(xx, zz) - perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = 3; i <= 5; i++){
             pp = glm::vec2(xx, zz) - perp*(float)i + 4.f*back;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
             pp = glm::vec2(xx, zz) + perp*(float)i + 4.f*back;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         }
         for(int i = 1; i <= 3; i++){
             pp = glm::vec2(xx, zz) - perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, BOOKSHELF);
+            setBlockAt(cur, pp.x, floorh, pp.y, BOOKSHELF);
             pp = glm::vec2(xx, zz) + perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, BOOKSHELF);
+            setBlockAt(cur, pp.x, floorh, pp.y, BOOKSHELF);
         }
         for(int i = 4; i <= 6; i++){
             pp = glm::vec2(xx, zz) - perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         pp = glm::vec2(xx, zz) - perp*6.f + 6.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         pp = glm::vec2(xx, zz) + perp*6.f + 6.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         //layer 3
         floorh++;
         pp = glm::vec2(xx, zz) + perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) + 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         for(int i = -1; i <= 1; i+= 2) {
             pp = glm::vec2(xx, zz) + 3.f*perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 4.f*perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + 5.f*perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, GLASS);
+            setBlockAt(cur, pp.x, floorh, pp.y, GLASS);
             pp = glm::vec2(xx, zz) + 6.f*perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -1; i <= 1; i+= 2) {
             pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + 3.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + 4.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + 5.f*back;
-            setBlockAt(pp.x, floorh, pp.y, GLASS);
+            setBlockAt(cur, pp.x, floorh, pp.y, GLASS);
             pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + 6.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -1; i <= 1; i+= 2) {
             pp = glm::vec2(xx, zz) + 1.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 2.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + 3.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 4.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, GLASS);
+            setBlockAt(cur, pp.x, floorh, pp.y, GLASS);
             pp = glm::vec2(xx, zz) + 5.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + 6.f*perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + 2.f*perp*(float)i + 7.f*back;
-            setBlockAt(pp.x, floorh, pp.y, BOOKSHELF);
+            setBlockAt(cur, pp.x, floorh, pp.y, BOOKSHELF);
         }
         pp = glm::vec2(xx, zz) + 8.f*back;
-        setBlockAt(pp.x, floorh, pp.y, GLASS);
+        setBlockAt(cur, pp.x, floorh, pp.y, GLASS);
         for(int i = -1; i <= 1; i+= 2) {
             pp = glm::vec2(xx, zz) + perp*3.f*(float)i + 4.f*back;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
             pp = glm::vec2(xx, zz) + perp*4.f*(float)i + 4.f*back;
-            setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+            setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         }
         //layer 4
         floorh++;
-        setBlockAt(xx, floorh, zz, COBBLESTONE);
+        setBlockAt(cur, xx, floorh, zz, COBBLESTONE);
         pp = glm::vec2(xx, zz) + perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - perp;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) + 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) - 2.f*perp + back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         for(int i = -1; i <= 1; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i + back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -6; i <= 6; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i + 2.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             pp = glm::vec2(xx, zz) + perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 3; j <= 7; j++) {
                 pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -2; i <= 2; i++) {
             for(int j = 3; j <= 4; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         pp = glm::vec2(xx, zz) - 3.f*perp + 4.f*back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         pp = glm::vec2(xx, zz) + 3.f*perp + 4.f*back;
-        setBlockAt(pp.x, floorh, pp.y, COBBLESTONE);
+        setBlockAt(cur, pp.x, floorh, pp.y, COBBLESTONE);
         //layer 5
         floorh++;
         for(int i = 3; i <= 6; i++){
             for(int j = -1; j <= 1; j+= 2){
                 pp = glm::vec2(xx, zz) + perp*(float)(i*j) + 2.f*back;
-                setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             }
         }
         for(int i = -6; i <= 6; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i + 8.f*back;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 3; j <= 7; j++) {
                 pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             }
         }
         pp = glm::vec2(xx, zz) - 2.f*perp + 2.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         pp = glm::vec2(xx, zz) + 2.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         pp = glm::vec2(xx, zz) + 3.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         pp = glm::vec2(xx, zz) + 2.f*perp + 2.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         //layer 6
         floorh++;
         for(int i = 2; i <= 8; i++) {
             for(int j = -1; j <= 1; j+= 2) {
                 pp = glm::vec2(xx, zz) + perp*(float)(i*j) + 2.f*back;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -8; i <= 8; i++) {
             for(int j = 8; j <= 9; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 3; j <= 7; j++) {
                 pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 4; j <= 8; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)(i*j) + back;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         pp = glm::vec2(xx, zz) + 2.f*back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         //layer 7
         floorh++;
         for(int i = -8; i <= 8; i++) {
             for(int j = 7; j <= 8; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
             pp = glm::vec2(xx, zz) + perp*(float)i + back*2.f;
-            setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 3; j <= 8; j++){
                 pp = glm::vec2(xx, zz) + perp*(float)(i*j) + back*3.f;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -1; i <= 1; i+= 2) {
             for(int j = 4; j <= 6; j++){
                 pp = glm::vec2(xx, zz) + 7.f*perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         pp = glm::vec2(xx, zz) - perp*3.f + back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         pp = glm::vec2(xx, zz) + perp*3.f + back;
-        setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+        setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
         //layer 8
         floorh++;
         for(int i = -8; i <= 8; i++) {
             for(int j = 6; j <= 7; j++){
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = 2; i <= 8; i++) {
             for(int j = -1; j <= 1; j+= 2){
                 for(int k = 3; k <= 4; k++) {
                     pp = glm::vec2(xx, zz) + perp*(float)(i*j) + back*(float)k;
-                    setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                    setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
                 }
             }
         }
         for(int i = 4; i <= 6; i++) {
             for(int j = -1; j <= 1; j+= 2) {
                 pp = glm::vec2(xx, zz) + 7.f*perp*(float)j + back*(float)i;
-                setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
             }
         }
         for(int i = -2; i <= 2; i++) {
             pp = glm::vec2(xx, zz) + perp*(float)i + back*2.f;
-            setBlockAt(pp.x, floorh, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh, pp.y, OAK_LOG);
         }
         //layer 9
         floorh++;
         for(int i = 4; i <= 6; i++) {
             for(int j = -8; j <= 8; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)j + back*(float)i;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         for(int i = -2; i <= 2; i++) {
             for(int j = 1; j <= 3; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh-1, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh-1, pp.y, OAK_PLANKS);
             }
         }
         pp = glm::vec2(xx, zz) + back;
-        setBlockAt(pp.x, floorh, pp.y, EMPTY);
+        setBlockAt(cur, pp.x, floorh, pp.y, EMPTY);
         pp = glm::vec2(xx, zz) + back*3.f;
-        setBlockAt(pp.x, floorh, pp.y, EMPTY);
+        setBlockAt(cur, pp.x, floorh, pp.y, EMPTY);
         pp = glm::vec2(xx, zz) + back*4.f;
-        setBlockAt(pp.x, floorh, pp.y, EMPTY);
+        setBlockAt(cur, pp.x, floorh, pp.y, EMPTY);
         //layer 10
         //floorh++;
         for(int i = -1; i <= 1; i++) {
             for(int j = 1; j <= 5; j++) {
                 pp = glm::vec2(xx, zz) + perp*(float)i + back*(float)j;
-                setBlockAt(pp.x, floorh, pp.y, OAK_PLANKS);
+                setBlockAt(cur, pp.x, floorh, pp.y, OAK_PLANKS);
             }
         }
         //pillars
         floorh = c->heightMap[xx-x][zz-z];
         for(int i = 0; i < 6; i++) {
             pp = glm::vec2(xx, zz) + perp*7.f + back*2.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) - perp*7.f + back*2.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) + perp*7.f + back*8.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) - perp*7.f + back*8.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
         }
         for(int i = 0; i < 7; i++) {
             pp = glm::vec2(xx, zz) + perp*3.f + back*2.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
             pp = glm::vec2(xx, zz) - perp*3.f + back*2.f;
-            setBlockAt(pp.x, floorh+i, pp.y, OAK_LOG);
+            setBlockAt(cur, pp.x, floorh+i, pp.y, OAK_LOG);
         }
         break;
     }
     default:
         break;
     }
+    return true;
 }
 
 bool Terrain::gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection,
                         float *out_dist, glm::ivec3 *out_blockHit,
                         Direction &out_dir) const
+{
+    BlockCursor cur(*this);
+    return gridMarch(cur, rayOrigin, rayDirection, out_dist, out_blockHit, out_dir);
+}
+
+bool Terrain::gridMarch(BlockCursor &cur, glm::vec3 rayOrigin, glm::vec3 rayDirection,
+                        float *out_dist, glm::ivec3 *out_blockHit,
+                        Direction &out_dir) const
 {
     std::map<Direction, glm::vec3> faces;
     faces[ZNEG] = glm::vec3(0.5, 0.5, 0);
@@ -1392,9 +1733,10 @@ bool Terrain::gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection,
         currCell = glm::ivec3(glm::floor(rayOrigin)) + offset;
         // If currCell contains something other than EMPTY, return
         // curr_t
-        if (hasChunkAt(currCell.x, currCell.z)) {
-            BlockType cellType = getBlockAt(currCell.x, currCell.y, currCell.z);
-            if(cellType != EMPTY && cellType != WATER && cellType != LAVA) {
+        Chunk* chunk = cur.chunkAt(currCell.x, currCell.z);
+        if (chunk) {
+            BlockType cellType = cur.get(currCell);
+            if(blockInfo(cellType).solid) {
                 *out_blockHit = currCell;
                 *out_dist = glm::min(maxLen, curr_t);
                 float mn = 2.f;
@@ -1408,6 +1750,27 @@ bool Terrain::gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection,
                 }
                 return true;
             }
+            //a section that's all air can't be hit, so jump to just before the ray leaves it
+            if(currCell.y >= 0 && currCell.y < 256 && chunk->sectionAir(currCell.y >> 4)) {
+                glm::vec3 sectionMin(currCell.x & ~15, currCell.y & ~15, currCell.z & ~15);
+                float exit_t = maxLen - curr_t;
+                for(int i = 0; i < 3; ++i) {
+                    if(rayDirection[i] != 0) {
+                        float bound = sectionMin[i] + (rayDirection[i] > 0 ? 16 : 0);
+                        exit_t = glm::min(exit_t, (bound - rayOrigin[i]) / rayDirection[i]);
+                    }
+                }
+                if(curr_t + exit_t >= maxLen) {
+                    *out_dist = maxLen;
+                    return false;
+                }
+                if(exit_t > 1.f) {
+                    exit_t -= 0.01f;
+                    curr_t += exit_t;
+                    rayOrigin += rayDirection * exit_t;
+                    currCell = glm::ivec3(glm::floor(rayOrigin));
+                }
+            }
         } else {
             *out_dist = glm::min(maxLen, curr_t);
             return false;
@@ -1419,20 +1782,293 @@ bool Terrain::gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection,
 
 std::vector<std::pair<int64_t, vec3Map>> Terrain::getChunkChanges() {
     std::vector<std::pair<int64_t, vec3Map>> ret;
-    m_chunks_mutex.lock();
-    for(auto& it: m_chunks){
-        ret.push_back(std::make_pair(it.first, it.second->m_changes));
+    m_chunks.forEach([&ret](int x, int z, Chunk* c) {
+        ret.push_back(std::make_pair(toKey(x, z), c->changes()));
+    });
+    //evicted chunks keep their changes here until they are regenerated
+    metaChangeData_mutex.lock();
+    for(auto &it: metaChangeData) {
+        vec3Map changes;
+        for(const metadata &md: it.second) {
+            changes[glm::ivec3(md.pos)] = md.type;
+        }
+        ret.push_back(std::make_pair(it.first, changes));
     }
-    m_chunks_mutex.unlock();
+    metaChangeData_mutex.unlock();
     return ret;
 }
 
-void Terrain::renderChange(Chunk *c, int x, int z) {
-    x%=16;
-    z%=16;
-    createVBOThread(c);
-    if(x == 15 && c->getNeighborChunk(XPOS)) createVBOThread(c->getNeighborChunk(XPOS));
-    if(x == 0 && c->getNeighborChunk(XNEG)) createVBOThread(c->getNeighborChunk(XNEG));
-    if(z == 15 && c->getNeighborChunk(ZPOS)) createVBOThread(c->getNeighborChunk(ZPOS));
-    if(z == 0 && c->getNeighborChunk(ZNEG)) createVBOThread(c->getNeighborChunk(ZNEG));
+std::vector<std::pair<glm::ivec3, BlockType>> Terrain::pendingChanges() {
+    std::vector<std::pair<glm::ivec3, BlockType>> ret;
+    metaChangeData_mutex.lock();
+    for(auto &it: metaChangeData) {
+        glm::ivec2 corner = toCoords(it.first);
+        for(const metadata &md: it.second) {
+            ret.emplace_back(glm::ivec3(corner.x, 0, corner.y) + glm::ivec3(md.pos), md.type);
+        }
+    }
+    metaChangeData_mutex.unlock();
+    return ret;
+}
+
+bool Terrain::markZoneGenerated(int x, int z) {
+    m_generatedTerrain_mutex.lock();
+    bool b = m_generatedTerrain.insert(toKey(x, z)).second;
+    m_generatedTerrain_mutex.unlock();
+    return b;
+}
+
+void Terrain::setMemoryBudget(size_t bytes) {
+    m_memoryBudget = bytes;
+}
+
+size_t Terrain::memoryBudget() const {
+    return m_memoryBudget;
+}
+
+void Terrain::setVRAMBudget(size_t bytes) {
+    m_vramBudget = bytes;
+}
+
+size_t Terrain::vramBudget() const {
+    return m_vramBudget;
+}
+
+int Terrain::evictChunks(const std::vector<glm::vec2> &centers, int keepRadius) {
+    struct Candidate {
+        int x, z;
+        Chunk* c;
+        size_t bytes;
+    };
+
+    m_evictTick++;
+    keepRadius = glm::max(keepRadius, MIN_KEEP_RADIUS);
+    Epoch::Guard g;
+
+    //stamp everything near a player, the rest can go
+    std::vector<Candidate> candidates;
+    size_t total = 0;
+    m_chunks.forEach([&](int x, int z, Chunk* c) {
+        size_t bytes = c->residentMemory();
+        total += bytes;
+        bool near = false;
+        for(const glm::vec2 &p: centers) {
+            if(glm::abs(x + 8 - p.x) <= keepRadius && glm::abs(z + 8 - p.y) <= keepRadius) {
+                near = true;
+                break;
+            }
+        }
+        if(near) c->lastUsed = m_evictTick;
+        else if(c->dataGen) candidates.push_back({x, z, c, bytes});
+    });
+    if(total <= m_memoryBudget) return 0;
+
+    //least recently used first
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.c->lastUsed < b.c->lastUsed;
+    });
+
+    int evicted = 0;
+    for(const Candidate &cd: candidates) {
+        if(total <= m_memoryBudget) break;
+        Chunk* c = cd.c;
+        //a queued worker still holds this chunk, try again next time
+        if(!c->claimEviction()) continue;
+        c->unlinkNeighbors();
+
+        //keep user changes, instantiateChunkAt replays them when the chunk comes back.
+        //A saved chunk carries its own changes, one that can't be saved is kept whole
+        bool saved = !c->unsaved || (m_regions && m_regions->save(cd.x, cd.z, c));
+        if(!saved) {
+            QByteArray data;
+            c->serialize(data);
+            m_evictedChunks_mutex.lock();
+            m_evictedChunks[toKey(cd.x, cd.z)] = qCompress(data);
+            m_evictedChunks_mutex.unlock();
+        }
+        vec3Map kept = saved ? vec3Map() : c->changes();
+        if(!kept.empty()) {
+            metaChangeData_mutex.lock();
+            std::vector<metadata> &changes = metaChangeData[toKey(cd.x, cd.z)];
+            for(auto &kv: kept) {
+                changes.emplace_back(kv.second, glm::vec3(kv.first));
+            }
+            metaChangeData_mutex.unlock();
+        }
+        if(m_arena) c->unbindVBOdata(*m_arena);
+        //out of the render set, and out of the meshed queue so the next draw doesn't touch it
+        int cell = drawCell(cd.x, cd.z);
+        if(cell >= 0 && m_drawGrid[cell] == c) {
+            m_drawGrid[cell] = nullptr;
+            if(inDrawRange(cell)) m_drawChunks--;
+        }
+        m_meshedChunks_mutex.lock();
+        m_meshedChunks.erase(std::remove(m_meshedChunks.begin(), m_meshedChunks.end(), c), m_meshedChunks.end());
+        m_meshedChunks_mutex.unlock();
+        if(c->uploadQueued) m_uploads.erase(std::remove(m_uploads.begin(), m_uploads.end(), c), m_uploads.end());
+
+        //the zone is no longer fully loaded, so it gets generated again when a player comes back
+        m_generatedTerrain_mutex.lock();
+        m_generatedTerrain.erase(toKey(64 * static_cast<int>(glm::floor(cd.x / 64.f)),
+                                       64 * static_cast<int>(glm::floor(cd.z / 64.f))));
+        m_generatedTerrain_mutex.unlock();
+
+        m_chunks.erase(cd.x, cd.z);
+        total -= cd.bytes;
+        evicted++;
+    }
+    if(evicted > 0) {
+        qDebug() << "evicted" << evicted << "chunks," << total / 1024 << "KB resident";
+        //their changes are only in the region files now, and a checkpoint can drop them from the log any time
+        syncChunks();
+    }
+    return evicted;
+}
+
+void Terrain::enablePersistence(const QString &dir, bool readOnly) {
+    m_regions = mkU<RegionStore>(dir, readOnly);
+}
+
+int Terrain::saveChunks() {
+    if(!m_regions || m_regions->readOnly()) return 0;
+    int saved = 0;
+    m_chunks.forEach([&](int x, int z, Chunk* c) {
+        //skip chunks still being generated
+        if(!c->dataGen || !c->unsaved) return;
+        c->unsaved = false;
+        if(m_regions->save(x, z, c)) saved++;
+        else c->unsaved = true;
+    });
+    return saved;
+}
+
+bool Terrain::syncChunks() {
+    return !m_regions || m_regions->sync();
+}
+
+// remesh just the sections the edit can show up in, right here, so the next draw
+// patches them in. Chunks that were never meshed go to the workers like before
+static void remeshNow(Terrain* t, Chunk* c, int sections) {
+    //held like a VBOWorker's so eviction waits for it, the network thread calls this too
+    if(!c->beginJob()) return;
+    bool meshed = c->remeshSections(sections);
+    if(meshed) t->chunkMeshed(c);
+    c->endJob();
+    if(!meshed) t->createVBOThread(c);
+}
+
+void Terrain::renderChange(Chunk *c, int x, int y, int z) {
+    //edits to chunks that aren't loaded have nothing to remesh
+    if(c == nullptr) return;
+    Epoch::Guard g;
+    x &= 15;
+    z &= 15;
+    int s = y >> 4;
+    //faces on a section's top and bottom layers are meshed with the section next to it
+    int sections = 1 << s;
+    if((y & 15) == 0 && s > 0) sections |= 1 << (s - 1);
+    if((y & 15) == 15 && s < 15) sections |= 1 << (s + 1);
+    remeshNow(this, c, sections);
+    if(x == 15 && c->getNeighborChunk(XPOS)) remeshNow(this, c->getNeighborChunk(XPOS), 1 << s);
+    if(x == 0 && c->getNeighborChunk(XNEG)) remeshNow(this, c->getNeighborChunk(XNEG), 1 << s);
+    if(z == 15 && c->getNeighborChunk(ZPOS)) remeshNow(this, c->getNeighborChunk(ZPOS), 1 << s);
+    if(z == 0 && c->getNeighborChunk(ZNEG)) remeshNow(this, c->getNeighborChunk(ZNEG), 1 << s);
+}
+
+void Terrain::updateVBOThread(Chunk* c) {
+    if(!c->beginJob()) return;
+    VBOWorker* vw = new VBOWorker(this, c, false);
+    VBOWorkers.start(vw, centerOf(c));
+}
+
+#define FILL_BENCH_CHUNKS 256
+#define GEN_BENCH_CHUNKS 8 //GEN_BENCH_CHUNKS x GEN_BENCH_CHUNKS chunks
+
+void chunkFillBench() {
+    //grass over dirt over stone at varying heights, the most common column
+    auto height = [](int xx, int zz) { return 60 + (7 * xx + 3 * zz) % 30; };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for(int i = 0; i < FILL_BENCH_CHUNKS; i++) {
+        Chunk c(nullptr);
+        for(int xx = 0; xx < 16; xx++) {
+            for(int zz = 0; zz < 16; zz++) {
+                int y = height(xx, zz) - 1;
+                c.setBlockAt(xx, y--, zz, GRASS_BLOCK);
+                for(; y > height(xx, zz) - 5; y--) c.setBlockAt(xx, y, zz, DIRT);
+                for(; y >= 0; y--) c.setBlockAt(xx, y, zz, STONE);
+            }
+        }
+    }
+    double blockMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for(int i = 0; i < FILL_BENCH_CHUNKS; i++) {
+        Chunk c(nullptr);
+        for(int xx = 0; xx < 16; xx++) {
+            for(int zz = 0; zz < 16; zz++) {
+                int h = height(xx, zz);
+                c.fillColumn(xx, zz, h - 1, h, GRASS_BLOCK);
+                c.fillColumn(xx, zz, h - 4, h - 1, DIRT);
+                c.fillColumn(xx, zz, 0, h - 4, STONE);
+            }
+        }
+    }
+    double columnMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    qDebug() << "per block setBlockAt:" << FILL_BENCH_CHUNKS / blockMs * 1000 << "chunks/sec,"
+             << "fillColumn:" << FILL_BENCH_CHUNKS / columnMs * 1000 << "chunks/sec";
+
+    //whole chunks, noise included
+    Terrain terrain(nullptr);
+    start = std::chrono::high_resolution_clock::now();
+    for(int x = 0; x < GEN_BENCH_CHUNKS; x++) {
+        for(int z = 0; z < GEN_BENCH_CHUNKS; z++) {
+            terrain.instantiateChunkAt(16 * x, 16 * z);
+        }
+    }
+    double genMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    qDebug() << "instantiateChunkAt:" << GEN_BENCH_CHUNKS * GEN_BENCH_CHUNKS / genMs * 1000 << "chunks/sec";
+}
+
+#define MESH_BENCH_CHUNKS 8 //meshes the inner MESH_BENCH_CHUNKS x MESH_BENCH_CHUNKS, the ring around them is only neighbors
+#define RENDER_DIST_CHUNKS (2 * 512 / 16) //MyGL draws 512 blocks in every direction
+
+void meshMemoryBench() {
+    Terrain terrain(nullptr);
+    for(int x = -1; x <= MESH_BENCH_CHUNKS; x++) {
+        for(int z = -1; z <= MESH_BENCH_CHUNKS; z++) {
+            terrain.instantiateChunkAt(16 * x, 16 * z);
+        }
+    }
+    int chunks = MESH_BENCH_CHUNKS * MESH_BENCH_CHUNKS;
+    for(bool greedy: {false, true}) {
+        Chunk::greedyMeshing = greedy;
+        long long verts = 0;
+        //the second pass is every chunk being remeshed, the scratch space and the chunks' own buffers are warm by then
+        for(int pass = 0; pass < 2; pass++) {
+            Chunk::meshAllocations = 0;
+            verts = 0;
+            for(int x = 0; x < MESH_BENCH_CHUNKS; x++) {
+                for(int z = 0; z < MESH_BENCH_CHUNKS; z++) {
+                    Chunk* c = terrain.getChunkAt(16 * x, 16 * z);
+                    c->createVBOdata();
+                    verts += c->vertexCount;
+                }
+            }
+            qDebug() << (greedy ? "greedy" : "naive") << (pass == 0 ? "first mesh:" : "remesh:")
+                     << double(Chunk::meshAllocations) / chunks << "mesh buffer allocations/chunk";
+        }
+        //every chunk is uploaded once when it loads, so VRAM and upload bytes for a full load are the same number
+        double scale = double(RENDER_DIST_CHUNKS * RENDER_DIST_CHUNKS) / (MESH_BENCH_CHUNKS * MESH_BENCH_CHUNKS);
+        //chunks used to upload their own 32 bit indices, now they share ChunkArena's quad indices
+        double indexBytes = verts / 4 * 6 * sizeof(GLuint) * scale;
+        double packed = verts * sizeof(PackedVertex) * scale;
+        double unpacked = verts * 3 * sizeof(glm::vec4) * scale + indexBytes;
+        qDebug() << (greedy ? "greedy:" : "naive:") << verts / chunks << "verts/chunk,"
+                 << "full render distance" << unpacked / (1 << 20) << "MB as 3 x vec4 with indices," << packed / (1 << 20)
+                 << "MB packed with shared indices (" << 100 * (1 - packed / unpacked) << "% less VRAM and upload,"
+                 << indexBytes / (1 << 20) << "MB of it indices)";
+    }
+    Chunk::greedyMeshing = false;
 }
@@ -4,7 +4,13 @@
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
 #include "chunk.h"
+#include "chunkmap.h"
+#include "chunkarena.h"
+#include "jobqueue.h"
+#include "region.h"
+#include "blockcursor.h"
 #include "scene/structure.h"
+#include "scene/camera.h"
 #include <array>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,6 +31,42 @@ struct metadata{
     }
 };
 
+// last frame's chunk drawing, for the debug window
+struct RenderStats {
+    int chunks;       //chunks drawn
+    int culled;       //chunks in range the visibility walk never reached
+    int occluded;     //chunks it reached whose meshed sections were all hidden
+    int reduced;      //chunks drawn with a reduced detail mesh, see Chunk::createLODdata
+    int drawCalls;    //GL draw calls they took
+    size_t arenaBytes; //geometry arena in use, of arenaCapacity
+    size_t arenaCapacity;
+    size_t uploadBytes; //mesh data written to the arena
+    int uploadsQueued;  //chunks still waiting for theirs
+    size_t vramBudget;  //arenaBytes is kept under this
+    int meshesEvicted;  //chunk meshes unbound to stay under it, since the start
+    int genQueued;      //chunks waiting to be generated
+    int meshQueued;     //and to be meshed
+    bool loading;       //any of those or an upload still to go
+    double loadMs;      //from that work showing up to all of it done, so far while loading
+};
+
+// mesh totals for the debug window, see Terrain::meshStats
+struct MeshStats {
+    int chunks;
+    long long vertices;
+    long long gpuBytes;
+    long long cpuBytes; //meshes not freed yet, they go once uploaded
+    double msPerMesh; //average createVBOdata time since the mode was last switched
+};
+
+// a column's surface as fillChunk lays it down, before caves or structures
+struct Ground {
+    int height;      //top block is height - 1
+    BiomeType biome;
+    bool shore;      //between the sea and the land, a chunk centered here is a BEACH
+};
+Ground groundAt(int x, int z);
+
 // Helper functions to convert (x, z) to and from hash map key
 int64_t toKey(int x, int z);
 glm::ivec2 toCoords(int64_t k);
@@ -38,13 +80,63 @@ class Terrain {
 private:
     // Stores every Chunk according to the location of its lower-left corner
     // in world space.
-    // We combine the X and Z coordinates of the Chunk's corner into one 64-bit int
-    // so that we can use them as a key for the map, as objects like std::pairs or
-    // glm::ivec2s are not hashable by default, so they cannot be used as keys.
-    std::unordered_map<int64_t, uPtr<Chunk>> m_chunks;
-    mutable std::mutex m_chunks_mutex;
+    // Lookups are lock free so the render thread never waits on generation threads.
+    ChunkMap m_chunks;
 
     OpenGLContext* mp_context;
+    // every bound chunk's geometry, made on the first draw
+    uPtr<ChunkArena> m_arena;
+    RenderStats m_renderStats;
+    // The render set: every generated chunk in draw range, kept between frames.
+    // It is rebuilt only when the range moves to another chunk and patched as chunks
+    // finish meshing or get evicted, so a frame only touches the chunks it can see.
+    // The grid is column major and has a one chunk margin around the range, chunks
+    // there keep their geometry so walking back and forth doesn't reupload it
+    int m_drawMinX, m_drawMinZ, m_drawW, m_drawD; //the range, in chunks
+    std::vector<Chunk*> m_drawGrid;
+    int m_drawChunks; //non null cells inside the range
+    // sections the camera might see per column of the range, one bit each,
+    // and the columns with any bit set
+    std::vector<uint16_t> m_visibleSections;
+    std::vector<int> m_reachedColumns;
+    // chunks meshed since the last draw, added to by any thread
+    std::mutex m_meshedChunks_mutex;
+    std::vector<Chunk*> m_meshedChunks;
+    // in range chunks to bind or patch, taken nearest the camera first
+    // until the frame's budget runs out so a burst of meshes can't hitch a frame
+    std::vector<Chunk*> m_uploads;
+    // The arena's in use bytes are kept under m_vramBudget by unbinding the
+    // chunks drawn longest ago. Their meshes are only on the GPU, so they are
+    // meshed again when the visibility walk reaches them
+    size_t m_vramBudget;
+    int m_frame; //draws so far, for Chunk::lastDrawn
+    // when the current stretch of generating, meshing and uploading began
+    std::chrono::steady_clock::time_point m_loadStart;
+    bool m_spawnLoaded; //the stretch at spawn finished
+
+    // updates the queue and loading times in m_renderStats, once a frame after everything was queued
+    void trackLoading();
+
+    // m_drawGrid index of the chunk at world space (x, z), -1 outside the grid
+    int drawCell(int x, int z) const;
+    // false for the margin
+    bool inDrawRange(int cell) const;
+    // moves the render set to a new range, binding what came into it and unbinding what left
+    void moveRenderSet(int minX, int maxX, int minZ, int maxZ);
+    // queues the chunks meshed since the last draw for upload
+    void takeMeshedChunks();
+    void queueUpload(Chunk* c);
+    // binds or patches queued chunks around eye within this frame's budget
+    void runUploads(glm::vec3 eye);
+    // meshes c at a reduced detail level on a worker, unless it's busy
+    void requestLOD(Chunk* c, int level);
+    // unbinds least recently drawn chunks until headroom more bytes fit in the budget.
+    // Never what was drawn last frame, so this can fall short
+    void trimGPUMeshes(size_t headroom);
+    size_t arenaBytes() const;
+    // fills m_visibleSections by walking from the camera's section through the faces
+    // each section connects, see SectionMesh::visibility
+    void findVisibleSections(glm::vec3 eye, const Frustum &frustum);
 
     //multithreading!
     //meta data, stores chunk changes until that chunk is loaded, after which it loads those changes in
@@ -55,6 +147,11 @@ private:
     std::mutex metaChangeData_mutex;
     std::map<int64_t, std::vector<metadata>> metaChangeData;
 
+    //evicted chunks that couldn't be saved, compressed from Chunk::serialize. Regenerating
+    //would lose what neighbors and mega structures stamped into them
+    std::mutex m_evictedChunks_mutex;
+    std::map<int64_t, QByteArray> m_evictedChunks;
+
     //generates mega structures
     std::mutex metaStructures_mutex;
     std::map<std::pair<int64_t, int>, StructureType> metaStructures; //marks the meta structure to prevent regeneration
@@ -62,11 +159,9 @@ private:
     std::mutex metaSubStructures_mutex; //prevent weird stuff from happening when we clear processed structures
     std::map<int64_t, std::vector<Structure>> metaSubStructures; //stores the structures generated by the metaStructure
 
-    QThreadPool terrainWorkers;
-    QThreadPool VBOWorkers;
-public:
-    Terrain(OpenGLContext *context);
-    ~Terrain();
+    // generation and meshing run nearest the player's view first, see JobQueue
+    JobQueue terrainWorkers;
+    JobQueue VBOWorkers;
 
     // We will designate every 64 x 64 area of the world's x-z plane
     // as one "terrain generation zone". Every time the player moves
@@ -74,17 +169,55 @@ public:
     // (i.e. its lower-left coordinates are not in this set), a new
     // 4 x 4 collection of Chunks is created to represent that area
     // of the world.
-    // The world that exists when the base code is run consists of exactly
-    // one 64 x 64 area with its lower-left corner at (0, 0).
-    // When milestone 1 has been implemented, the Player can move around the
-    // world to add more "terrain generation zone" IDs to this set.
-    // While only the 3 x 3 collection of terrain generation zones
-    // surrounding the Player should be rendered, the Chunks
-    // in the Terrain will never be deleted until the program is terminated.
+    // Once any chunk of a zone is evicted the zone leaves this set again,
+    // so a zone in the set always has all of its chunks loaded or queued.
+    std::mutex m_generatedTerrain_mutex;
     std::unordered_set<int64_t> m_generatedTerrain;
 
+    //eviction
+    size_t m_memoryBudget;
+    int m_evictTick;
+
+    //region files chunks are loaded from before generating, nullptr if the world isn't saved
+    uPtr<RegionStore> m_regions;
+
+    // base terrain for a fresh chunk, everything instantiateChunkAt does before structures
+    void fillChunk(Chunk* c, int x, int z);
+
+    friend class BlockCursor;
+public:
+    Terrain(OpenGLContext *context);
+    ~Terrain();
+
+    // Marks the terrain generation zone with lower-left corner (x, z) as generated.
+    // Returns false if it already was, otherwise the caller should generate its chunks.
+    bool markZoneGenerated(int x, int z);
+
+    // Chunks far from every player are dropped least recently used first
+    // once the terrain goes over this many bytes. Their m_changes are kept
+    // and replayed when instantiateChunkAt regenerates them from the seed.
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const;
+    // bytes of chunk geometry kept on the GPU, see m_vramBudget
+    void setVRAMBudget(size_t bytes);
+    size_t vramBudget() const;
+    // Evicts chunks more than keepRadius blocks from every center until under budget.
+    // Frees vbos, so call with the GL context current. Returns the number evicted.
+    int evictChunks(const std::vector<glm::vec2> &centers, int keepRadius);
+    // generation runs nearest whichever of these is closest, for the server where nothing is drawn
+    void setJobViews(const std::vector<glm::vec3> &eyes);
+
+    // Loads chunks from region files in dir before generating them.
+    // Unless readOnly, modified chunks are written back by saveChunks and on eviction.
+    void enablePersistence(const QString &dir, bool readOnly);
+    // writes every chunk that changed since it was loaded or last saved, returns how many
+    int saveChunks();
+    // flushes every region file written since the last call to the disk, false if one failed
+    bool syncChunks();
+
     // Instantiates a new Chunk and stores it in
-    // our chunk map at the given coordinates.
+    // our chunk map at the given coordinates, reading it from
+    // the world's region files if it was saved before.
     // Returns a pointer to the created Chunk.
     Chunk* instantiateChunkAt(int x, int z);
     //for generating surface level objects that require multiple chunks
@@ -93,12 +226,12 @@ public:
     // Do these world-space coordinates lie within
     // a Chunk that exists?
     bool hasChunkAt(int x, int z) const;
-    // Assuming a Chunk exists at these coords,
-    // return a mutable reference to it
-    uPtr<Chunk>& getChunkAt(int x, int z);
-    // Assuming a Chunk exists at these coords,
-    // return a const reference to it
-    const uPtr<Chunk>& getChunkAt(int x, int z) const;
+    // Return the Chunk at these coords, or nullptr if there is none.
+    // Chunks can be evicted from another thread, so only use it
+    // while pinned by an Epoch::Guard and look it up once instead
+    // of checking hasChunkAt first
+    Chunk* getChunkAt(int x, int z);
+    const Chunk* getChunkAt(int x, int z) const;
     // Given a world-space coordinate (which may have negative
     // values) return the block stored at that point in space.
     BlockType getBlockAt(int x, int y, int z) const;
@@ -109,15 +242,28 @@ public:
     void setBlockAt(int x, int y, int z, BlockType t);
     // like setblock, but checks a conditional before placing
     void setBlockAt(int x, int y, int z, BlockType t, bool(*con)(int,int,int,Chunk*));
+    // setBlockAt going through a cursor, for writing many nearby blocks
+    void setBlockAt(BlockCursor &cur, int x, int y, int z, BlockType t, bool(*con)(int,int,int,Chunk*) = nullptr);
     // setblock for changes made after terrain generation
     void changeBlockAt(int x, int y, int z, BlockType t);
     // gets all changed blocks in chunks
     std::vector<std::pair<int64_t, vec3Map>> getChunkChanges();
+    // world space changes waiting for their chunk to be loaded, these are in no chunk yet
+    std::vector<std::pair<glm::ivec3, BlockType>> pendingChanges();
+    // total bytes of block storage across loaded chunks, for the memory report
+    size_t blockMemoryUsage(int *out_chunks) const;
+    // switches Chunk::greedyMeshing, resets the mesh timers and remeshes every loaded chunk
+    void setGreedyMeshing(bool greedy);
+    // totals across meshed chunks, for comparing the two mesher modes
+    MeshStats meshStats() const;
+    RenderStats renderStats() const;
+    // queues c for the next draw to pick up its new mesh, from any thread
+    void chunkMeshed(Chunk* c);
 
     // Draws every Chunk that falls within the bounding box
-    // described by the min and max coords, using the provided
-    // ShaderProgram
-    void draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram);
+    // described by the min and max coords, inside the camera's frustum
+    // and not hidden behind solid terrain, using the provided ShaderProgram
+    void draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram, const Camera &camera);
 
     // Initializes the Chunks that store the 64 x 256 x 64 block scene you
     // see when the base code is run.
@@ -130,16 +276,22 @@ public:
     void createGroundThread(glm::vec2);
     //creates a vbo thread
     void createVBOThread(Chunk* c);
-    void renderChange(Chunk* c, int x, int z);
+    // remeshes only the sections whose blocks changed since the last mesh
+    void updateVBOThread(Chunk* c);
+    // call after setting a block, remeshes the sections it touches immediately
+    void renderChange(Chunk* c, int x, int y, int z);
 
     //processes the sub structures returned by generation functions into either meta data or directly into the chunk
     void processMegaStructure(const std::vector<Structure>& s);
 
-    //builds the structures
-    void buildStructure(const Structure&);
+    //builds the structures, false if the chunk it stands in isn't loaded
+    bool buildStructure(const Structure&);
 
     bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, float *out_dist,
                    glm::ivec3 *out_blockHit, Direction &out_dir) const;
+    // same, reusing the chunks cur already found for callers marching many rays
+    bool gridMarch(BlockCursor &cur, glm::vec3 rayOrigin, glm::vec3 rayDirection, float *out_dist,
+                   glm::ivec3 *out_blockHit, Direction &out_dir) const;
 
     //item entities
     std::mutex item_entities_mutex;
@@ -147,4 +299,9 @@ public:
     int item_entity_id;
 };
 
-
+// prints chunks/sec filling columns block by block against fillColumn, and for full generation
+void chunkFillBench();
+// prints mesh bytes across the full render distance for 48 byte vertices with their own indices and for
+// packed vertices on the shared quad indices, both mesher modes,
+// and how often meshing allocates on a first mesh and on a remesh
+void meshMemoryBench();
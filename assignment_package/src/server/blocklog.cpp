@@ -0,0 +1,181 @@
+#include "blocklog.h"
+#include <QDebug>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+static const char LOG_MAGIC[8] = {'M', 'M', 'B', 'L', 'K', 'L', 'O', 'G'};
+#define RECORD_SIZE 10
+
+// fnv-1a, only there to catch torn writes
+static uint32_t checksum(const char* data, size_t n) {
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < n; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return h;
+}
+
+static void appendRecord(QByteArray &out, int x, int y, int z, BlockType t) {
+    int32_t xz[2] = {x, z};
+    out.append(reinterpret_cast<const char*>(xz), sizeof(xz));
+    out.append(char(y));
+    out.append(char(t));
+}
+
+BlockLog::BlockLog(const QString &path)
+    : m_path(path), m_fd(-1), m_mutex(), m_wake(), m_batch(), m_batchCount(0),
+      m_commit(false), m_stop(false), m_checkpoint(nullptr), m_writer()
+{
+    QByteArray p = path.toLocal8Bit();
+    m_fd = ::open(p.constData(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(m_fd < 0) {
+        qDebug() << "could not open block log" << path << ", edits will not survive a crash";
+    }
+    else if(lseek(m_fd, 0, SEEK_END) == 0) {
+        if(write(m_fd, LOG_MAGIC, sizeof(LOG_MAGIC)) != sizeof(LOG_MAGIC)) {
+            qDebug() << "could not initialize block log" << path;
+        }
+        fdatasync(m_fd);
+    }
+    m_writer = std::thread(&BlockLog::run, this);
+}
+
+BlockLog::~BlockLog() {
+    m_mutex.lock();
+    m_stop = true;
+    m_mutex.unlock();
+    m_wake.notify_one();
+    m_writer.join();
+    if(m_fd >= 0) ::close(m_fd);
+}
+
+std::vector<BlockEdit> BlockLog::replay() {
+    std::vector<BlockEdit> edits;
+    if(m_fd < 0) return edits;
+    off_t size = lseek(m_fd, 0, SEEK_END);
+    QByteArray data(size, 0);
+    if(pread(m_fd, data.data(), size, 0) != size || size < off_t(sizeof(LOG_MAGIC))
+            || std::memcmp(data.constData(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        qDebug() << "block log" << m_path << "is unreadable, ignoring it";
+        return edits;
+    }
+    const char* p = data.constData() + sizeof(LOG_MAGIC);
+    const char* end = data.constData() + size;
+    while(end - p >= 8) {
+        uint32_t head[2];
+        std::memcpy(head, p, sizeof(head));
+        if(uint64_t(end - p - 8) < uint64_t(head[0]) * RECORD_SIZE) break;
+        const char* records = p + 8;
+        if(checksum(records, head[0] * RECORD_SIZE) != head[1]) break;
+        for(uint32_t i = 0; i < head[0]; i++) {
+            const char* r = records + i * RECORD_SIZE;
+            int32_t xz[2];
+            std::memcpy(xz, r, sizeof(xz));
+            edits.emplace_back(glm::ivec3(xz[0], static_cast<unsigned char>(r[8]), xz[1]),
+                               BlockType(static_cast<unsigned char>(r[9])));
+        }
+        p = records + head[0] * RECORD_SIZE;
+    }
+    //a crash mid batch leaves a torn tail, cut it off so new batches stay readable
+    if(p != end) {
+        qDebug() << "dropping" << (end - p) << "bytes of torn block log";
+        if(ftruncate(m_fd, p - data.constData()) != 0) qDebug() << "could not truncate block log";
+    }
+    return edits;
+}
+
+void BlockLog::append(int x, int y, int z, BlockType t) {
+    m_mutex.lock();
+    appendRecord(m_batch, x, y, z, t);
+    m_batchCount++;
+    m_mutex.unlock();
+}
+
+void BlockLog::commit() {
+    m_mutex.lock();
+    bool any = m_batchCount > 0;
+    m_commit = m_commit || any;
+    m_mutex.unlock();
+    if(any) m_wake.notify_one();
+}
+
+void BlockLog::checkpoint(std::function<bool(std::vector<BlockEdit>&)> saveWorld) {
+    m_mutex.lock();
+    m_checkpoint = saveWorld;
+    m_mutex.unlock();
+    m_wake.notify_one();
+}
+
+bool BlockLog::writeBatch(int fd, const QByteArray &records, int count) {
+    uint32_t head[2] = {uint32_t(count), checksum(records.constData(), records.size())};
+    QByteArray out(reinterpret_cast<const char*>(head), sizeof(head));
+    out.append(records);
+    return write(fd, out.constData(), out.size()) == out.size();
+}
+
+// swaps in a log holding only pending. Written to the side and renamed over,
+// so a crash leaves either the old log or the new one
+void BlockLog::rewrite(const std::vector<BlockEdit> &pending) {
+    QByteArray tmpPath = (m_path + ".tmp").toLocal8Bit();
+    int fd = ::open(tmpPath.constData(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(fd < 0) {
+        qDebug() << "checkpoint failed, keeping the old block log";
+        return;
+    }
+    QByteArray records;
+    for(const BlockEdit &e: pending) {
+        appendRecord(records, e.first.x, e.first.y, e.first.z, e.second);
+    }
+    bool ok = write(fd, LOG_MAGIC, sizeof(LOG_MAGIC)) == sizeof(LOG_MAGIC);
+    if(ok && !pending.empty()) ok = writeBatch(fd, records, pending.size());
+    ok = ok && fdatasync(fd) == 0;
+    QByteArray p = m_path.toLocal8Bit();
+    if(!ok || std::rename(tmpPath.constData(), p.constData()) != 0) {
+        qDebug() << "checkpoint failed, keeping the old block log";
+        ::close(fd);
+        return;
+    }
+    //make the rename itself durable
+    int slash = p.lastIndexOf('/');
+    int dir = ::open(slash < 0 ? "." : p.left(slash).constData(), O_RDONLY);
+    if(dir >= 0) {
+        fsync(dir);
+        ::close(dir);
+    }
+    if(m_fd >= 0) ::close(m_fd);
+    m_fd = fd;
+}
+
+void BlockLog::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_wake.wait(lock, [this]() { return m_commit || m_checkpoint || m_stop; });
+        bool stop = m_stop;
+        std::function<bool(std::vector<BlockEdit>&)> saveWorld = std::move(m_checkpoint);
+        m_checkpoint = nullptr;
+        m_commit = false;
+        QByteArray records;
+        records.swap(m_batch);
+        int count = m_batchCount;
+        m_batchCount = 0;
+        //appends keep going while we hit the disk
+        lock.unlock();
+
+        if(count > 0 && m_fd >= 0) {
+            if(!writeBatch(m_fd, records, count) || fdatasync(m_fd) != 0) {
+                qDebug() << "block log write failed," << count << "edits are not durable";
+            }
+        }
+        //everything before this point is in the log, so whatever the save misses is still recoverable
+        if(saveWorld) {
+            std::vector<BlockEdit> pending;
+            if(saveWorld(pending)) rewrite(pending);
+            else qDebug() << "world save isn't durable, keeping the old block log";
+        }
+
+        lock.lock();
+        if(stop) break;
+    }
+}
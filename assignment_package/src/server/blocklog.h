@@ -0,0 +1,58 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <vector>
+#include "glm_includes.h"
+#include "scene/chunk.h"
+
+typedef std::pair<glm::ivec3, BlockType> BlockEdit;
+
+// Write-ahead log of block edits for the server.
+// Client handler threads append edits to an in-memory batch, which never touches the disk.
+// Once per tick commit() hands the batch to a writer thread that appends it to the
+// log and fdatasyncs, so a crash loses at most the edits of the current tick.
+// checkpoint() saves the world on the writer thread and then starts a fresh log
+// holding only the edits that still aren't in any chunk.
+//
+// On disk: an 8 byte magic, then batches of
+// [uint32 count][uint32 checksum][count x (int32 x, int32 z, uint8 y, uint8 type)]
+// Replay stops at the first torn or corrupt batch.
+class BlockLog {
+private:
+    QString m_path;
+    int m_fd;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    QByteArray m_batch; //edits since the last commit
+    int m_batchCount;
+    bool m_commit, m_stop;
+    std::function<bool(std::vector<BlockEdit>&)> m_checkpoint;
+
+    std::thread m_writer;
+
+    void run();
+    bool writeBatch(int fd, const QByteArray &records, int count);
+    void rewrite(const std::vector<BlockEdit> &pending);
+public:
+    BlockLog(const QString &path);
+    // commits whatever is left and stops the writer
+    ~BlockLog();
+    BlockLog(const BlockLog&) = delete;
+    BlockLog& operator=(const BlockLog&) = delete;
+
+    // every committed edit in order, drops a torn tail. Call before appending
+    std::vector<BlockEdit> replay();
+
+    void append(int x, int y, int z, BlockType t);
+    // group commit, called once per server tick
+    void commit();
+    // saveWorld runs on the writer thread: it should save every chunk, fill in
+    // the edits that are only held in memory, which seed the new log, and return
+    // whether the saved chunks reached the disk. If not the old log stays
+    void checkpoint(std::function<bool(std::vector<BlockEdit>&)> saveWorld);
+};
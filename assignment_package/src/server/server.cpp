@@ -15,6 +15,14 @@ using namespace std;
 
 Server::Server(int s, int p) : m_terrain(nullptr), seed(s), port(p), setup(false), open(true), time(0){
     m_clients.setMaxThreadCount(MAX_CLIENTS);
+    m_terrain.enablePersistence(WORLD_DIR, false);
+    //edits that never made it into a saved chunk, they get applied as their chunks load
+    m_log = mkU<BlockLog>(QString(WORLD_DIR) + "/blocks.wal");
+    std::vector<BlockEdit> edits = m_log->replay();
+    for(const BlockEdit &e: edits) {
+        m_terrain.changeBlockAt(e.first.x, e.first.y, e.first.z, e.second);
+    }
+    if(!edits.empty()) qDebug() << "replayed" << edits.size() << "block edits";
     ServerConnectionWorker* sw = new ServerConnectionWorker(this);
     QThreadPool::globalInstance()->start(sw);
 }
@@ -25,8 +33,7 @@ void Server::generateTerrain(int x, int z) {
     int miny = glm::floor(z/64.f)*64;
     for(int dx = minx-192; dx <= minx+192; dx+=64) {
         for(int dy = miny-192; dy <= miny+192; dy+=64) {
-            if(m_terrain.m_generatedTerrain.find(toKey(dx, dy)) == m_terrain.m_generatedTerrain.end()){
-                m_terrain.m_generatedTerrain.insert(toKey(dx, dy));
+            if(m_terrain.markZoneGenerated(dx, dy)){
                 for(int ddx = dx; ddx < dx + 64; ddx+=16) {
                     for(int ddy = dy; ddy < dy + 64; ddy+=16) {
                         //qDebug() << "creating ground for " << ddx << ddy;
@@ -72,6 +79,8 @@ void Server::handle_client(int client_fd)
 }
 
 void Server::process_packet(Packet* packet, int sender) {
+    //runs on a client thread, keeps chunks we look up alive until we are done with them
+    Epoch::Guard g;
     switch(packet->type) {
     case PLAYER_JOIN: {
         PlayerJoinPacket* thispack = dynamic_cast<PlayerJoinPacket*>(packet);
@@ -219,6 +228,8 @@ void Server::process_packet(Packet* packet, int sender) {
         BlockChangePacket* thispack = dynamic_cast<BlockChangePacket*>(packet);
         glm::vec2 xz = toCoords(thispack->chunkPos);
         this->m_terrain.changeBlockAt(xz.x, thispack->yPos, xz.y, thispack->newBlock);
+        //logged after applying, so a checkpoint that misses the change still has it in the log
+        m_log->append(xz.x, thispack->yPos, xz.y, thispack->newBlock);
         broadcast_packet(mkU<BlockChangePacket>(thispack->chunkPos, thispack->yPos, thispack->newBlock).get(), 0);
         break;
     }
@@ -334,10 +345,43 @@ int Server::start()
 
 void Server::shutdown() {
     open = false;
+    qDebug() << "saved" << m_terrain.saveChunks() << "chunks";
+    m_log->commit();
 }
 
 void Server::tick() {
     time++;
+    //generation goes by the players, nearest one first, spawn when nobody's on
+    std::vector<glm::vec3> eyes;
+    m_players_mutex.lock();
+    for(auto &it: m_players) {
+        eyes.push_back(it.second.pos);
+    }
+    m_players_mutex.unlock();
+    if(eyes.empty()) eyes.push_back(m_terrain.worldSpawn);
+    m_terrain.setJobViews(eyes);
+    //nothing is drawn here, so only the terrain around players needs to stay loaded
+    if(time % 300 == 0) {
+        std::vector<glm::vec2> centers;
+        m_players_mutex.lock();
+        for(auto &it: m_players) {
+            centers.emplace_back(it.second.pos.x, it.second.pos.z);
+        }
+        m_players_mutex.unlock();
+        centers.emplace_back(m_terrain.worldSpawn.x, m_terrain.worldSpawn.z);
+        m_terrain.evictChunks(centers, 0);
+    }
+    //group commit this tick's block edits
+    m_log->commit();
+    //save the world and start a fresh log every 30 seconds
+    if(time % CHECKPOINT_TICKS == 0) {
+        m_log->checkpoint([this](std::vector<BlockEdit> &pending) {
+            m_terrain.saveChunks();
+            pending = m_terrain.pendingChanges();
+            //the new log drops whatever was just saved, so that has to be on disk first
+            return m_terrain.syncChunks();
+        });
+    }
 //    std::vector<int> itemsToRemove;
 //    for(auto& iter: m_terrain.item_entities) {
 //        iter.second.tick();
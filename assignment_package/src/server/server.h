@@ -6,9 +6,14 @@
 #include "scene/entity.h"
 #include "scene/player.h"
 #include "server/packet.h"
+#include "server/blocklog.h"
 
 #define BUFFER_SIZE 1024
 #define MAX_CLIENTS 10
+//region files of the hosted world, relative to the working directory
+#define WORLD_DIR "world"
+//ticks between checkpoints of the block log
+#define CHECKPOINT_TICKS 1800
 
 struct PlayerState {
     float phi, theta;
@@ -120,6 +125,8 @@ private:
     void generateTerrain(int x, int z);
 
     Terrain m_terrain;
+    //block edits since the last checkpoint
+    uPtr<BlockLog> m_log;
     std::mutex m_players_mutex;
     std::map<int, PlayerState> m_players;
     std::mutex m_entities_mutex;
@@ -143,6 +150,7 @@ public:
     bool setup, open;
 
     //shuts down the server, doesn't quite work yet
+    //saves modified chunks first
     void shutdown();
 
     //server tick
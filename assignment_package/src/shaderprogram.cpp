@@ -1,4 +1,7 @@
 #include "shaderprogram.h"
+#include "scene/chunk.h"
+#include "scene/chunkarena.h"
+#include "frameuniforms.h"
 #include <QFile>
 #include <QStringBuilder>
 #include <QTextStream>
@@ -8,10 +11,10 @@
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
     : vertShader(), fragShader(), prog(),
-      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1),
+      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1), attrPacked(-1), attrChunkPos(-1),
       unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1),
       unifEye(-1), unifDim(-1),
-      unifSampler2D(-1), unifWater(-1), unifTime(-1),
+      unifSampler2D(-1), unifWater(-1), unifTime(-1), unifTiles(-1), unifPacked(-1),
       context(context)
 {}
 
@@ -67,6 +70,8 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     attrNor = context->glGetAttribLocation(prog, "vs_Nor");
     attrCol = context->glGetAttribLocation(prog, "vs_Col");
     attrUV = context->glGetAttribLocation(prog, "vs_UV");
+    attrPacked = context->glGetAttribLocation(prog, "vs_Packed");
+    attrChunkPos = context->glGetAttribLocation(prog, "vs_ChunkPos");
     if(attrCol == -1) attrCol = context->glGetAttribLocation(prog, "vs_ColInstanced");
 
     attrPosOffset = context->glGetAttribLocation(prog, "vs_OffsetInstanced");
@@ -82,6 +87,11 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     unifWater = context->glGetUniformLocation(prog, "u_Type");
     unifSampler2D  = context->glGetUniformLocation(prog, "u_Texture");
     unifTime = context->glGetUniformLocation(prog, "uTime");
+    unifTiles = context->glGetUniformLocation(prog, "u_Tiles");
+    unifPacked = context->glGetUniformLocation(prog, "u_Packed");
+
+    GLuint frameBlock = context->glGetUniformBlockIndex(prog, "FrameData");
+    if(frameBlock != GL_INVALID_INDEX) context->glUniformBlockBinding(prog, frameBlock, FRAME_DATA_BINDING);
 
     context->printGLErrorLog();
 }
@@ -108,7 +118,17 @@ void ShaderProgram::setModelMatrix(const glm::mat4 &model)
     }
 
     if (unifModelInvTr != -1) {
-        glm::mat4 modelinvtr = glm::inverse(glm::transpose(model));
+        // entities and chunks are mostly just moved, and undoing a translation
+        // is negating it, so only a rotation or scale pays for the inverse
+        glm::mat4 modelinvtr(1.f);
+        if(model[0] == glm::vec4(1, 0, 0, 0) && model[1] == glm::vec4(0, 1, 0, 0) && model[2] == glm::vec4(0, 0, 1, 0)) {
+            modelinvtr[0][3] = -model[3][0];
+            modelinvtr[1][3] = -model[3][1];
+            modelinvtr[2][3] = -model[3][2];
+        }
+        else {
+            modelinvtr = glm::inverse(glm::transpose(model));
+        }
         // Pass a 4x4 matrix into a uniform variable in our shader
                         // Handle to the matrix variable on the GPU
         context->glUniformMatrix4fv(unifModelInvTr,
@@ -162,6 +182,7 @@ void ShaderProgram::setType(int type) {
 void ShaderProgram::draw(Drawable &d)
 {
     useMe();
+    unsigned attribs = 0;
 
     if (unifSampler2D != -1) {
         context->glUniform1i(unifSampler2D, 0);
@@ -181,39 +202,39 @@ void ShaderProgram::draw(Drawable &d)
     // meaning that glVertexAttribPointer associates vs_Pos
     // (referred to by attrPos) with that VBO
     if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
+        attribs |= 1 << attrPos;
         context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, NULL);
     }
 
     if (attrNor != -1 && d.bindNor()) {
-        context->glEnableVertexAttribArray(attrNor);
+        attribs |= 1 << attrNor;
         context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 0, NULL);
     }
 
     if (attrCol != -1 && d.bindCol()) {
-        context->glEnableVertexAttribArray(attrCol);
+        attribs |= 1 << attrCol;
         context->glVertexAttribPointer(attrCol, 4, GL_FLOAT, false, 0, NULL);
     }
 
     if (attrUV != -1 && d.bindUV()) {
-        context->glEnableVertexAttribArray(attrUV);
+        attribs |= 1 << attrUV;
         context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 0, NULL);
     }
 
+    //stays enabled after the draw, so the next one only toggles what differs
+    context->useVertexAttribs(attribs);
+
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
     context->printGLErrorLog();
 }
 
 void ShaderProgram::drawInterleaved(Drawable &d) {
     useMe();
+    unsigned attribs = 0;
 
     if(unifSampler2D != -1)
     {
@@ -236,38 +257,105 @@ void ShaderProgram::drawInterleaved(Drawable &d) {
     //qDebug() << attrPos << " " << attrNor << " " << attrCol;
     if (d.bindInter()) {
         if (attrPos != -1) {
-            context->glEnableVertexAttribArray(attrPos);
+            attribs |= 1 << attrPos;
             context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*) 0);
         }
         context->printGLErrorLog();
         if (attrNor != -1) {
-            context->glEnableVertexAttribArray(attrNor);
+            attribs |= 1 << attrNor;
             context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*) sizeof(glm::vec4));
         }
         context->printGLErrorLog();
         if (attrUV != -1) {
-            context->glEnableVertexAttribArray(attrUV);
+            attribs |= 1 << attrUV;
             context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*) (2*sizeof(glm::vec4)));
         }
         context->printGLErrorLog();
     }
 
+    //stays enabled after the draw, so the next one only toggles what differs
+    context->useVertexAttribs(attribs);
+
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
     context->printGLErrorLog();
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    context->printGLErrorLog();
+}
+
+int ShaderProgram::drawChunks(ChunkArena &arena) {
+    useMe();
+
+    if(unifSampler2D != -1)
+    {
+        context->glUniform1i(unifSampler2D, /*GL_TEXTURE*/0);
+    }
+    if(unifPacked != -1) context->glUniform1i(unifPacked, 1);
+    //positions come out of the arena in world space already
+    setModelMatrix(glm::mat4(1.f));
+
+    // integer attributes, so glVertexAttribIPointer keeps the bits instead of converting to float
+    unsigned attribs = 0;
+    context->glBindBuffer(GL_ARRAY_BUFFER, arena.vertices.buffer());
+    if (attrPacked != -1) {
+        attribs |= 1 << attrPacked;
+        context->glVertexAttribIPointer(attrPacked, 2, GL_UNSIGNED_INT, sizeof(PackedVertex), (void*) 0);
+        context->glVertexAttribDivisor(attrPacked, 0);
+    }
+    context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.quadIndexBuffer());
+    context->printGLErrorLog();
+
+    const std::vector<DrawElementsCommand> &cmds = arena.commands();
+    int opaque = arena.opaqueDraws();
+    int calls = 0;
+    if(context->multiDrawElementsIndirect) {
+        // one instance per draw, its baseInstance picks the chunk's origin
+        context->glBindBuffer(GL_ARRAY_BUFFER, arena.originBuffer());
+        if (attrChunkPos != -1) {
+            attribs |= 1 << attrChunkPos;
+            context->glVertexAttribIPointer(attrChunkPos, 2, GL_INT, sizeof(glm::ivec2), (void*) 0);
+            context->glVertexAttribDivisor(attrChunkPos, 1);
+        }
+        context->useVertexAttribs(attribs);
+        context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arena.commandBuffer());
+        //every opaque face first, then the clear ones blend over them
+        if(opaque > 0) {
+            context->multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*) 0, opaque, 0);
+            calls++;
+        }
+        if(int(cmds.size()) > opaque) {
+            context->multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*) (opaque * sizeof(DrawElementsCommand)),
+                                               cmds.size() - opaque, 0);
+            calls++;
+        }
+        context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        if (attrChunkPos != -1) context->glVertexAttribDivisor(attrChunkPos, 0);
+    }
+    else if(context->drawElementsBaseVertex) {
+        //no indirect draws, so a draw per chunk with its origin as a constant attribute
+        const std::vector<glm::ivec2> &origins = arena.origins();
+        context->useVertexAttribs(attribs);
+        for(const DrawElementsCommand &c: cmds) {
+            if (attrChunkPos != -1) context->glVertexAttribI4i(attrChunkPos, origins[c.baseInstance].x, origins[c.baseInstance].y, 0, 0);
+            context->drawElementsBaseVertex(GL_TRIANGLES, c.count, GL_UNSIGNED_SHORT, (void*) (c.firstIndex * sizeof(GLushort)), c.baseVertex);
+            calls++;
+        }
+    }
+    context->printGLErrorLog();
+
+    if(unifPacked != -1) context->glUniform1i(unifPacked, 0);
 
     context->printGLErrorLog();
+    context->countDraws(calls);
+    return calls;
 }
 
 void ShaderProgram::drawPostProcess(Drawable &d, int textureSlot)
 {
     useMe();
+    unsigned attribs = 0;
 
     // Set our "renderedTexture" sampler to user specified texture slot
     context->glUniform1i(unifSampler2D, textureSlot);
@@ -278,28 +366,29 @@ void ShaderProgram::drawPostProcess(Drawable &d, int textureSlot)
     // If so, it binds the appropriate buffers to each attribute.
 
     if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
+        attribs |= 1 << attrPos;
         context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, NULL);
     }
     if (attrUV != -1 && d.bindUV()) {
-        context->glEnableVertexAttribArray(attrUV);
+        attribs |= 1 << attrUV;
         context->glVertexAttribPointer(attrUV, 2, GL_FLOAT, false, 0, NULL);
     }
 
+    //stays enabled after the draw, so the next one only toggles what differs
+    context->useVertexAttribs(attribs);
+
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
-
     context->printGLErrorLog();
 }
 
 void ShaderProgram::drawInstanced(InstancedDrawable &d)
 {
     useMe();
+    unsigned attribs = 0;
 
     if(unifSampler2D != -1)
     {
@@ -320,46 +409,44 @@ void ShaderProgram::drawInstanced(InstancedDrawable &d)
     // meaning that glVertexAttribPointer associates vs_Pos
     // (referred to by attrPos) with that VBO
     if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
+        attribs |= 1 << attrPos;
         context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, NULL);
         context->glVertexAttribDivisor(attrPos, 0);
     }
 
     if (attrNor != -1 && d.bindNor()) {
-        context->glEnableVertexAttribArray(attrNor);
+        attribs |= 1 << attrNor;
         context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 0, NULL);
         context->glVertexAttribDivisor(attrNor, 0);
     }
 
     if (attrCol != -1 && d.bindCol()) {
-        context->glEnableVertexAttribArray(attrCol);
+        attribs |= 1 << attrCol;
         context->glVertexAttribPointer(attrCol, 3, GL_FLOAT, false, 0, NULL);
         context->glVertexAttribDivisor(attrCol, 1);
     }
 
     if (attrUV != -1 && d.bindUV()) {
-        context->glEnableVertexAttribArray(attrUV);
+        attribs |= 1 << attrUV;
         context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 0, NULL);
         context->glVertexAttribDivisor(attrUV, 1);
     }
 
     if (attrPosOffset != -1 && d.bindOffsetBuf()) {
-        context->glEnableVertexAttribArray(attrPosOffset);
+        attribs |= 1 << attrPosOffset;
         context->glVertexAttribPointer(attrPosOffset, 3, GL_FLOAT, false, 0, NULL);
         context->glVertexAttribDivisor(attrPosOffset, 1);
     }
 
+    //stays enabled after the draw, so the next one only toggles what differs
+    context->useVertexAttribs(attribs);
+
     // Bind the index buffer and then draw shapes from it.
     // This invokes the shader program, which accesses the vertex buffers.
     d.bindIdx();
     context->glDrawElementsInstanced(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0, d.instanceCount());
     context->printGLErrorLog();
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
-    if (attrPosOffset != -1) context->glDisableVertexAttribArray(attrPosOffset);
 
 }
 
@@ -426,6 +513,15 @@ void ShaderProgram::setEye(glm::vec3 eye)
 }
 
 
+void ShaderProgram::setTiles(const std::vector<glm::vec4> &tiles)
+{
+    useMe();
+
+    if (unifTiles != -1) {
+        context->glUniform4fv(unifTiles, tiles.size(), &tiles[0][0]);
+    }
+}
+
 void ShaderProgram::printShaderInfoLog(int shader)
 {
     int infoLogLen = 0;
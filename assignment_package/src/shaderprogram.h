@@ -7,6 +7,8 @@
 
 #include "drawable.h"
 
+class ChunkArena;
+
 
 class ShaderProgram
 {
@@ -19,6 +21,8 @@ public:
     int attrNor; // A handle for the "in" vec4 representing vertex normal in the vertex shader
     int attrCol; // A handle for the "in" vec4 representing vertex color in the vertex shader
     int attrUV;
+    int attrPacked; // A handle for the "in" uvec2 holding a whole PackedVertex, for chunks
+    int attrChunkPos; // A handle for the "in" ivec2 chunk origin, one per draw out of a ChunkArena
     int attrPosOffset; // A handle for a vec3 used only in the instanced rendering shader
 
     int unifModel; // A handle for the "uniform" mat4 representing model matrix in the vertex shader
@@ -32,6 +36,8 @@ public:
     int unifSampler2D; //A handle for the "uniform" sampler2D that will be used to read the texture containing the scene render
     int unifWater;
     int unifTime; //A handle for the "uniform" float representing the time in the shader
+    int unifTiles; //A handle for the "uniform" vec4 array of atlas tiles that chunk faces repeat
+    int unifPacked; //A handle for the "uniform" int that switches the vertex shader to vs_Packed
 
 public:
     ShaderProgram(OpenGLContext* context);
@@ -50,6 +56,8 @@ public:
     void draw(Drawable &d);
     // Draw the given object to our screen multiple times using instanced rendering
     void drawInterleaved(Drawable &d);
+    // Draw every chunk queued in the arena, returns how many GL draw calls that took
+    int drawChunks(ChunkArena &arena);
     void drawPostProcess(Drawable &d, int textureSlot);
     void drawInstanced(InstancedDrawable &d);
     // Utility function used in create()
@@ -65,6 +73,8 @@ public:
 
     void setDimensions(int w, int h);
     void setEye(glm::vec3 eye);
+    // atlas rects from blockTiles(), at most 64
+    void setTiles(const std::vector<glm::vec4> &tiles);
 
 private:
     OpenGLContext* context;   // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
@@ -7,24 +7,34 @@ SOURCES += \
     $$PWD/algo/seed.cpp \
     $$PWD/algo/worley.cpp \
     $$PWD/framebuffer.cpp \
+    $$PWD/frameuniforms.cpp \
     $$PWD/main.cpp \
     $$PWD/mainwindow.cpp \
     $$PWD/mygl.cpp \
     $$PWD/prism.cpp \
     $$PWD/quad.cpp \
     $$PWD/scene/biome.cpp \
+    $$PWD/scene/blockcursor.cpp \
+    $$PWD/scene/blockstorage.cpp \
+    $$PWD/scene/chunkarena.cpp \
+    $$PWD/scene/chunkmap.cpp \
     $$PWD/scene/cubedisplay.cpp \
+    $$PWD/scene/epoch.cpp \
     $$PWD/scene/font.cpp \
     $$PWD/scene/handitem.cpp \
+    $$PWD/scene/horizon.cpp \
     $$PWD/scene/icons.cpp \
     $$PWD/scene/inventory.cpp \
     $$PWD/scene/item.cpp \
+    $$PWD/scene/jobqueue.cpp \
     $$PWD/scene/crosshair.cpp \
     $$PWD/scene/itementity.cpp \
     $$PWD/scene/rectangle.cpp \
+    $$PWD/scene/region.cpp \
     $$PWD/scene/runnables.cpp \
     $$PWD/scene/structure.cpp \
     $$PWD/scene/transform.cpp \
+    $$PWD/server/blocklog.cpp \
     $$PWD/server/getip.cpp \
     $$PWD/server/packet.cpp \
     $$PWD/shaderprogram.cpp \
@@ -49,22 +59,33 @@ HEADERS += \
     $$PWD/algo/seed.h \
     $$PWD/algo/worley.h \
     $$PWD/framebuffer.h \
+    $$PWD/frameuniforms.h \
     $$PWD/mainwindow.h \
     $$PWD/mygl.h \
     $$PWD/prism.h \
     $$PWD/quad.h \
     $$PWD/scene/biome.h \
+    $$PWD/scene/blockcursor.h \
+    $$PWD/scene/blockregistry.h \
+    $$PWD/scene/blockstorage.h \
+    $$PWD/scene/chunkarena.h \
+    $$PWD/scene/chunkmap.h \
     $$PWD/scene/cubedisplay.h \
+    $$PWD/scene/epoch.h \
     $$PWD/scene/font.h \
     $$PWD/scene/handitem.h \
+    $$PWD/scene/horizon.h \
     $$PWD/scene/icons.h \
     $$PWD/scene/item.h \
+    $$PWD/scene/jobqueue.h \
     $$PWD/scene/crosshair.h \
     $$PWD/scene/itementity.h \
     $$PWD/scene/rectangle.h \
+    $$PWD/scene/region.h \
     $$PWD/scene/runnables.h \
     $$PWD/scene/structure.h \
     $$PWD/scene/transform.h \
+    $$PWD/server/blocklog.h \
     $$PWD/server/getip.h \
     $$PWD/server/packet.h \
     $$PWD/shaderprogram.h \